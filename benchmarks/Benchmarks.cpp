@@ -0,0 +1,579 @@
+/*
+ * Copyright (C) 2026 by agent
+ * agent@local
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+/**
+    @file
+    Implement the benchmarks for the pattern data, rendering and floss matching.
+    Each benchmark is run on a set of generated patterns, by default a small,
+    a medium and a large one. A different pattern can be used by setting the
+    KXSTITCH_BENCHMARK_PATTERN environment variable to a comma separated list
+    of width, height, colors, fractional density and backstitch density, for
+    example 500,400,60,0.25,0.1. The usual QTest options can be used to run
+    individual benchmarks or to select the measurement backend.
+    */
+
+
+#include "Benchmarks.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include <QDataStream>
+#include <QImage>
+#include <QPainter>
+#include <QPolygon>
+#include <QScopedPointer>
+#include <QtMath>
+#include <QtTest>
+
+#include "configuration.h"
+#include "FlossScheme.h"
+#include "Pattern.h"
+#include "PatternGenerator.h"
+#include "PatternSnapshot.h"
+#include "Rasterizer.h"
+#include "Renderer.h"
+#include "SchemeManager.h"
+
+
+class PatternParameters
+{
+public:
+    QByteArray  name;
+    int         width;
+    int         height;
+    int         colors;
+    double      fractionalDensity;
+    double      backstitchDensity;
+};
+
+
+const char *renderStitchesAsNames[] = {
+    "Stitches",
+    "BlackWhiteSymbols",
+    "ColorSymbols",
+    "ColorBlocks",
+    "ColorBlocksSymbols"
+};
+
+
+/**
+    Get the parameters of the patterns to benchmark.
+    @return a QList of PatternParameters, either the defaults or the single
+    pattern described by the KXSTITCH_BENCHMARK_PATTERN environment variable
+    */
+static QList<PatternParameters> patternParameters()
+{
+    QList<PatternParameters> parameters;
+    QList<QByteArray> values = qgetenv("KXSTITCH_BENCHMARK_PATTERN").split(',');
+
+    if (values.count() == 5) {
+        PatternParameters custom;
+        custom.width = values.at(0).toInt();
+        custom.height = values.at(1).toInt();
+        custom.colors = values.at(2).toInt();
+        custom.fractionalDensity = values.at(3).toDouble();
+        custom.backstitchDensity = values.at(4).toDouble();
+        custom.name = values.at(0) + 'x' + values.at(1);
+        parameters.append(custom);
+    } else {
+        parameters.append({"100x100", 100, 100, 20, 0.1, 0.05});
+        parameters.append({"400x300", 400, 300, 50, 0.2, 0.1});
+        parameters.append({"1000x1000", 1000, 1000, 100, 0.2, 0.1});
+    }
+
+    return parameters;
+}
+
+
+/**
+    Add the columns describing the pattern to the test data.
+    */
+static void addPatternColumns()
+{
+    QTest::addColumn<int>("width");
+    QTest::addColumn<int>("height");
+    QTest::addColumn<int>("colors");
+    QTest::addColumn<double>("fractionalDensity");
+    QTest::addColumn<double>("backstitchDensity");
+}
+
+
+/**
+    Describe the stitches in an area of cells in row order, so that patterns
+    can be compared independently of the order the cells are stored in.
+    @param stitches a reference to the StitchData
+    @param area a QRect of the cells to describe
+    @param offset a QPoint added to each cell of the area to find its stitches
+    @return a QByteArray describing the cells that have stitches
+    */
+static QByteArray cellContents(StitchData &stitches, const QRect &area, const QPoint &offset = QPoint())
+{
+    QByteArray contents;
+    QDataStream stream(&contents, QIODevice::WriteOnly);
+
+    for (int y = area.top() ; y <= area.bottom() ; ++y) {
+        for (int x = area.left() ; x <= area.right() ; ++x) {
+            StitchQueue *stitchQueue = stitches.stitchQueueAt(x + offset.x(), y + offset.y());
+
+            if (stitchQueue) {
+                stream << qint32(x) << qint32(y) << qint32(stitchQueue->count());
+
+                foreach (const Stitch *stitch, *stitchQueue) {
+                    stream << qint8(stitch->type) << qint32(stitch->colorIndex);
+                }
+            }
+        }
+    }
+
+    return contents;
+}
+
+
+/**
+    Describe all the cells, backstitches and knots of a pattern.
+    @param stitches a reference to the StitchData
+    @return a QByteArray describing the pattern
+    */
+static QByteArray patternContents(StitchData &stitches)
+{
+    QByteArray contents = cellContents(stitches, QRect(0, 0, stitches.width(), stitches.height()));
+    QDataStream stream(&contents, QIODevice::Append);
+
+    stream << qint32(stitches.width()) << qint32(stitches.height());
+
+    foreach (const Backstitch *backstitch, stitches.backstitches()) {
+        stream << backstitch->start << backstitch->end << qint32(backstitch->colorIndex);
+    }
+
+    foreach (const Knot *knot, stitches.knots()) {
+        stream << knot->position << qint32(knot->colorIndex);
+    }
+
+    return contents;
+}
+
+
+/**
+    Create the test data for the benchmarks that only depend on the pattern.
+    */
+void Benchmarks::patternData()
+{
+    addPatternColumns();
+
+    foreach (const PatternParameters &parameters, patternParameters()) {
+        QTest::newRow(parameters.name.constData()) << parameters.width << parameters.height << parameters.colors << parameters.fractionalDensity << parameters.backstitchDensity;
+    }
+}
+
+
+/**
+    Generate the pattern for the current test data row.
+    @return a pointer to the Pattern, the caller takes ownership
+    */
+Pattern *Benchmarks::createPattern() const
+{
+    QFETCH(int, width);
+    QFETCH(int, height);
+    QFETCH(int, colors);
+    QFETCH(double, fractionalDensity);
+    QFETCH(double, backstitchDensity);
+
+    return PatternGenerator(width, height, colors, fractionalDensity, backstitchDensity).generate();
+}
+
+
+void Benchmarks::addStitches_data()
+{
+    patternData();
+}
+
+
+void Benchmarks::addStitches()
+{
+    QFETCH(int, width);
+    QFETCH(int, height);
+    QFETCH(int, colors);
+
+    QBENCHMARK {
+        StitchData stitches;
+        stitches.resize(width, height);
+
+        for (int y = 0 ; y < height ; ++y) {
+            for (int x = 0 ; x < width ; ++x) {
+                stitches.addStitch(QPoint(x, y), Stitch::Full, (x / 4 + y / 4) % colors);
+            }
+        }
+    }
+}
+
+
+void Benchmarks::deleteStitches_data()
+{
+    patternData();
+}
+
+
+void Benchmarks::deleteStitches()
+{
+    QScopedPointer<Pattern> pattern(createPattern());
+    StitchData &stitches = pattern->stitches();
+
+    QBENCHMARK_ONCE {   // the stitches are gone after the first run
+        for (int y = 0 ; y < stitches.height() ; ++y) {
+            for (int x = 0 ; x < stitches.width() ; ++x) {
+                stitches.deleteStitch(QPoint(x, y), Stitch::Delete, -1);
+            }
+        }
+    }
+}
+
+
+void Benchmarks::extents_data()
+{
+    patternData();
+}
+
+
+void Benchmarks::extents()
+{
+    QScopedPointer<Pattern> pattern(createPattern());
+    QRect extents;
+
+    QBENCHMARK {
+        extents = pattern->stitches().extents();
+    }
+
+    QVERIFY(extents.isValid());
+}
+
+
+void Benchmarks::flossUsage_data()
+{
+    patternData();
+}
+
+
+void Benchmarks::flossUsage()
+{
+    QScopedPointer<Pattern> pattern(createPattern());
+    QMap<int, FlossUsage> usage;
+
+    QBENCHMARK {
+        usage = pattern->stitches().flossUsage();
+    }
+
+    QVERIFY(!usage.isEmpty());
+}
+
+
+void Benchmarks::mirror_data()
+{
+    patternData();
+}
+
+
+void Benchmarks::mirror()
+{
+    QScopedPointer<Pattern> pattern(createPattern());
+
+    QBENCHMARK {
+        pattern->stitches().mirror(Qt::Horizontal);
+    }
+}
+
+
+void Benchmarks::rotate_data()
+{
+    patternData();
+}
+
+
+void Benchmarks::rotate()
+{
+    QScopedPointer<Pattern> pattern(createPattern());
+
+    QBENCHMARK {
+        pattern->stitches().rotate(StitchData::Rotate90);
+    }
+}
+
+
+void Benchmarks::insertRemove_data()
+{
+    patternData();
+}
+
+
+void Benchmarks::insertRemove()
+{
+    QScopedPointer<Pattern> pattern(createPattern());
+    StitchData &stitches = pattern->stitches();
+    int width = stitches.width();
+    int height = stitches.height();
+    int rows = height / 10;         // enough to make the largest pattern sparse
+    int columns = width / 10;
+    QByteArray original = patternContents(stitches);
+
+    // the cells below and to the right of the inserted rows and columns move by the number inserted
+    QRect above(0, 0, width, height / 2);
+    QRect below(0, height / 2, width, height - height / 2);
+    QByteArray aboveContents = cellContents(stitches, above);
+    QByteArray belowContents = cellContents(stitches, below);
+
+    stitches.insertRows(height / 2, rows);
+    QCOMPARE(cellContents(stitches, above), aboveContents);
+    QCOMPARE(cellContents(stitches, below, QPoint(0, rows)), belowContents);
+    QVERIFY(cellContents(stitches, QRect(0, height / 2, width, rows)).isEmpty());
+
+    stitches.removeRows(height / 2, rows);
+    QCOMPARE(patternContents(stitches), original);
+
+    QRect left(0, 0, width / 2, height);
+    QRect right(width / 2, 0, width - width / 2, height);
+    QByteArray leftContents = cellContents(stitches, left);
+    QByteArray rightContents = cellContents(stitches, right);
+
+    stitches.insertColumns(width / 2, columns);
+    QCOMPARE(cellContents(stitches, left), leftContents);
+    QCOMPARE(cellContents(stitches, right, QPoint(columns, 0)), rightContents);
+    QVERIFY(cellContents(stitches, QRect(width / 2, 0, columns, height)).isEmpty());
+
+    stitches.removeColumns(width / 2, columns);
+    QCOMPARE(patternContents(stitches), original);
+
+    QBENCHMARK {    // the inserted rows and columns are empty, so removing them restores the pattern
+        stitches.insertRows(height / 2, 10);
+        stitches.removeRows(height / 2, 10);
+        stitches.insertColumns(width / 2, 10);
+        stitches.removeColumns(width / 2, 10);
+    }
+
+    QCOMPARE(patternContents(stitches), original);
+
+    // removing stitched rows and columns moves the following cells back, and
+    // inserting again reuses the removed rows and columns which must be empty
+    QRect remaining(0, height / 4 + rows, width, height - height / 4 - rows);
+    QByteArray remainingContents = cellContents(stitches, remaining);
+
+    stitches.removeRows(height / 4, rows);
+    QCOMPARE(cellContents(stitches, remaining, QPoint(0, -rows)), remainingContents);
+
+    stitches.insertRows(height / 4, rows);
+    QVERIFY(cellContents(stitches, QRect(0, height / 4, width, rows)).isEmpty());
+    QCOMPARE(cellContents(stitches, remaining), remainingContents);
+
+    remaining = QRect(width / 4 + columns, 0, width - width / 4 - columns, height);
+    remainingContents = cellContents(stitches, remaining);
+
+    stitches.removeColumns(width / 4, columns);
+    QCOMPARE(cellContents(stitches, remaining, QPoint(-columns, 0)), remainingContents);
+
+    stitches.insertColumns(width / 4, columns);
+    QVERIFY(cellContents(stitches, QRect(width / 4, 0, columns, height)).isEmpty());
+    QCOMPARE(cellContents(stitches, remaining), remainingContents);
+
+    QCOMPARE(stitches.width(), width);
+    QCOMPARE(stitches.height(), height);
+}
+
+
+void Benchmarks::serialize_data()
+{
+    patternData();
+}
+
+
+void Benchmarks::serialize()
+{
+    QScopedPointer<Pattern> pattern(createPattern());
+
+    QBENCHMARK {
+        QByteArray data;
+        QDataStream out(&data, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_4_0);
+        out << *pattern;
+
+        Pattern copy;
+        QDataStream in(data);
+        in.setVersion(QDataStream::Qt_4_0);
+        in >> copy;
+    }
+}
+
+
+/**
+    Create the test data for the large mostly empty canvases used for murals
+    and banners, each has a number of small stitched islands.
+    */
+void Benchmarks::sparseCanvas_data()
+{
+    QTest::addColumn<int>("width");
+    QTest::addColumn<int>("height");
+    QTest::addColumn<int>("islands");
+
+    QTest::newRow("2000x2000") << 2000 << 2000 << 20;
+    QTest::newRow("10000x10000") << 10000 << 10000 << 50;
+}
+
+
+void Benchmarks::sparseCanvas()
+{
+    QFETCH(int, width);
+    QFETCH(int, height);
+    QFETCH(int, islands);
+
+    qint64 usage = 0;
+
+    QBENCHMARK {
+        std::mt19937 random(1);
+
+        StitchData stitches;
+        stitches.resize(width, height);
+
+        for (int island = 0 ; island < islands ; ++island) {
+            int left = random() % (width - 31);
+            int top = random() % (height - 31);
+
+            for (int y = top ; y < top + 32 ; ++y) {
+                for (int x = left ; x < left + 32 ; ++x) {
+                    stitches.addStitch(QPoint(x, y), Stitch::Full, island % 10);
+                }
+            }
+        }
+
+        stitches.snapshot();
+
+        QByteArray data;
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream << stitches;
+
+        usage = stitches.memoryUsage();
+    }
+
+    QVERIFY(usage < qint64(64) * 1024 * 1024);
+}
+
+
+void Benchmarks::render_data()
+{
+    addPatternColumns();
+    QTest::addColumn<int>("renderStitchesAs");
+
+    foreach (const PatternParameters &parameters, patternParameters()) {
+        for (int renderStitchesAs = 0 ; renderStitchesAs < Configuration::EnumRenderer_RenderStitchesAs::COUNT ; ++renderStitchesAs) {
+            QByteArray name = parameters.name + ' ' + renderStitchesAsNames[renderStitchesAs];
+            QTest::newRow(name.constData()) << parameters.width << parameters.height << parameters.colors << parameters.fractionalDensity << parameters.backstitchDensity << renderStitchesAs;
+        }
+    }
+}
+
+
+void Benchmarks::render()
+{
+    QFETCH(int, renderStitchesAs);
+
+    QScopedPointer<Pattern> pattern(createPattern());
+    StitchData &stitches = pattern->stitches();
+
+    Renderer renderer;
+    renderer.setRenderStitchesAs(static_cast<Configuration::EnumRenderer_RenderStitchesAs::type>(renderStitchesAs));
+    renderer.setRenderBackstitchesAs(Configuration::EnumRenderer_RenderBackstitchesAs::ColorLines);
+    renderer.setRenderKnotsAs(Configuration::EnumRenderer_RenderKnotsAs::ColorBlocks);
+
+    // keep the image to a size that might be shown on a screen, larger patterns
+    // are rendered at smaller cell sizes as they would be when zoomed out
+    int cellSize = std::min(16, std::max(1, 2048 / std::max(stitches.width(), stitches.height())));
+    QImage image(stitches.width() * cellSize, stitches.height() * cellSize, QImage::Format_ARGB32_Premultiplied);
+
+    QBENCHMARK {
+        image.fill(Qt::white);
+
+        QPainter painter(&image);
+        painter.setRenderHint(QPainter::Antialiasing, true);
+        painter.setWindow(0, 0, stitches.width(), stitches.height());
+
+        renderer.render(&painter, pattern.data(), painter.window(), true, true, true, true, -1);
+    }
+}
+
+
+void Benchmarks::rasterize_data()
+{
+    patternData();
+}
+
+
+void Benchmarks::rasterize()
+{
+    QFETCH(int, width);
+    QFETCH(int, height);
+
+    QRect bounds(0, 0, width, height);
+    QPolygon star;
+
+    for (int i = 0 ; i < 10 ; ++i) {
+        double angle = i * M_PI / 5;
+        double radius = (i % 2) ? 0.2 : 0.5;
+        star.append(QPoint(int(width * (0.5 + radius * std::sin(angle))), int(height * (0.5 - radius * std::cos(angle)))));
+    }
+
+    QBENCHMARK {
+        Rasterizer rasterizer(bounds);
+        rasterizer.fillEllipse(bounds);
+        rasterizer.fillPolygon(star);
+        rasterizer.drawLine(bounds.topLeft(), bounds.bottomRight());
+        rasterizer.drawEllipse(bounds.adjusted(width / 4, height / 4, -width / 4, -height / 4));
+
+        StitchData stitches;
+        stitches.resize(width, height);
+        stitches.addStitches(rasterizer.spans(), Stitch::Full, 0);
+    }
+}
+
+
+void Benchmarks::matchFlossScheme_data()
+{
+    QTest::addColumn<int>("colors");
+
+    QTest::newRow("100 colors") << 100;
+    QTest::newRow("1000 colors") << 1000;
+}
+
+
+void Benchmarks::matchFlossScheme()
+{
+    QFETCH(int, colors);
+
+    FlossScheme *scheme = SchemeManager::scheme(Configuration::palette_DefaultScheme());
+
+    if (scheme == nullptr) {
+        QSKIP("The default floss scheme is not installed");
+    }
+
+    std::mt19937 random(1);
+    QList<QColor> sample;
+
+    for (int i = 0 ; i < colors ; ++i) {
+        quint32 rgb = random();
+        sample.append(QColor(qRed(rgb), qGreen(rgb), qBlue(rgb)));
+    }
+
+    QBENCHMARK {
+        foreach (const QColor &color, sample) {
+            scheme->convert(color);
+        }
+    }
+}
+
+
+QTEST_MAIN(Benchmarks)
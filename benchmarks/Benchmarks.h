@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2026 by agent
+ * agent@local
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+#ifndef Benchmarks_H
+#define Benchmarks_H
+
+
+#include <QObject>
+
+
+class Pattern;
+
+
+class Benchmarks : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void addStitches_data();
+    void addStitches();
+    void deleteStitches_data();
+    void deleteStitches();
+    void extents_data();
+    void extents();
+    void flossUsage_data();
+    void flossUsage();
+    void mirror_data();
+    void mirror();
+    void rotate_data();
+    void rotate();
+    void insertRemove_data();
+    void insertRemove();
+    void serialize_data();
+    void serialize();
+    void sparseCanvas_data();
+    void sparseCanvas();
+    void render_data();
+    void render();
+    void rasterize_data();
+    void rasterize();
+    void matchFlossScheme_data();
+    void matchFlossScheme();
+
+private:
+    void patternData();
+    Pattern *createPattern() const;
+};
+
+
+#endif // Benchmarks_H
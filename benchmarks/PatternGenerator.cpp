@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2026 by agent
+ * agent@local
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+/**
+    @file
+    Implement the PatternGenerator class used by the benchmarks to create
+    synthetic patterns.
+    The same parameters and seed always produce the same pattern, so results
+    can be compared between builds. Only the raw output of std::mt19937 is
+    used since the standard distributions are allowed to differ between
+    library implementations.
+    */
+
+
+#include "PatternGenerator.h"
+
+#include <algorithm>
+#include <random>
+
+#include <QColor>
+#include <QVector>
+
+#include "configuration.h"
+#include "DocumentFloss.h"
+#include "Floss.h"
+#include "FlossScheme.h"
+#include "Pattern.h"
+#include "SchemeManager.h"
+#include "SymbolLibrary.h"
+#include "SymbolManager.h"
+
+
+const Stitch::Type fractionalStitches[] = {
+    Stitch::TLQtr,
+    Stitch::TRQtr,
+    Stitch::BLQtr,
+    Stitch::BRQtr,
+    Stitch::BTHalf,
+    Stitch::TBHalf,
+    Stitch::TL3Qtr,
+    Stitch::TR3Qtr,
+    Stitch::BL3Qtr,
+    Stitch::BR3Qtr,
+    Stitch::TLSmallHalf,
+    Stitch::TRSmallHalf,
+    Stitch::BLSmallHalf,
+    Stitch::BRSmallHalf,
+    Stitch::TLSmallFull,
+    Stitch::TRSmallFull,
+    Stitch::BLSmallFull,
+    Stitch::BRSmallFull
+};
+
+
+const int backstitchDirections[][2] = {
+    {-2, -2},
+    {0, -2},
+    {2, -2},
+    {-2, 0},
+    {2, 0},
+    {-2, 2},
+    {0, 2},
+    {2, 2}
+};
+
+
+/**
+    Constructor.
+    @param width the width of the pattern in cells
+    @param height the height of the pattern in cells
+    @param colors the number of colors in the palette
+    @param fractionalDensity the proportion of cells, from 0.0 to 1.0, that
+    contain fractional stitches rather than a full stitch
+    @param backstitchDensity the number of backstitches per cell, a density
+    of 0.1 on a 100 x 100 pattern will add 1000 backstitches
+    @param knotDensity the number of french knots per cell
+    @param seed the seed of the random number generator
+    */
+PatternGenerator::PatternGenerator(int width, int height, int colors, double fractionalDensity, double backstitchDensity, double knotDensity, quint32 seed)
+    :   m_width(width),
+        m_height(height),
+        m_colors(std::max(1, colors)),
+        m_fractionalDensity(fractionalDensity),
+        m_backstitchDensity(backstitchDensity),
+        m_knotDensity(knotDensity),
+        m_seed(seed),
+        m_useScheme(true)
+{
+}
+
+
+/**
+    Set whether the palette flosses are chosen from the default floss scheme.
+    Without the scheme the colors are generated, so the pattern does not depend
+    on the floss schemes installed.
+    @param useScheme true to use the default floss scheme if it is installed,
+    false to always generate the colors
+    */
+void PatternGenerator::setUseScheme(bool useScheme)
+{
+    m_useScheme = useScheme;
+}
+
+
+/**
+    Generate a pattern.
+    The palette flosses are chosen from the default floss scheme if it is
+    installed and has not been disabled by setUseScheme(), otherwise the colors
+    are generated. Every cell
+    is stitched, colors are assigned in blocks of 4 x 4 cells to resemble an
+    imported image, and fractional cells have a second quarter stitch of
+    another color half of the time. Backstitches are one cell long in any of
+    the eight directions. French knots are placed on any of the cell corners,
+    edge centres or cell centres.
+    @return a pointer to the new Pattern, the caller takes ownership
+    */
+Pattern *PatternGenerator::generate() const
+{
+    std::mt19937 random(m_seed);
+    auto chance = [&random](double probability) {
+        return random() < probability * 4294967296.0;
+    };
+
+    Pattern *pattern = new Pattern;
+    FlossScheme *scheme = (m_useScheme) ? SchemeManager::scheme(pattern->palette().schemeName()) : nullptr;
+    SymbolLibrary *library = SymbolManager::library(pattern->palette().symbolLibrary());
+    QList<qint16> symbols = (library) ? library->indexes() : QList<qint16>();
+
+    for (int i = 0 ; i < m_colors ; ++i) {
+        QString name;
+        QColor color;
+
+        if (scheme && !scheme->flosses().isEmpty()) {
+            Floss *floss = scheme->flosses().at(random() % scheme->flosses().count());
+            name = floss->name();
+            color = floss->color();
+        } else {
+            int hue = random() % 360;
+            int saturation = 64 + random() % 192;
+            int value = 64 + random() % 192;
+            color = QColor::fromHsv(hue, saturation, value);
+            name = color.name();
+        }
+
+        DocumentFloss *documentFloss = new DocumentFloss(name, (i < symbols.count()) ? symbols.at(i) : qint16(i), Qt::SolidLine, Configuration::palette_StitchStrands(), Configuration::palette_BackstitchStrands());
+        documentFloss->setFlossColor(color);
+        pattern->palette().add(i, documentFloss);
+    }
+
+    StitchData &stitches = pattern->stitches();
+    stitches.resize(m_width, m_height);
+
+    int blockColumns = (m_width + 3) / 4;
+    int blockRows = (m_height + 3) / 4;
+    QVector<int> blockColors(blockColumns * blockRows);
+
+    for (int i = 0 ; i < blockColors.count() ; ++i) {
+        blockColors[i] = random() % m_colors;
+    }
+
+    int fractionalTypes = sizeof(fractionalStitches) / sizeof(fractionalStitches[0]);
+
+    for (int y = 0 ; y < m_height ; ++y) {
+        for (int x = 0 ; x < m_width ; ++x) {
+            int colorIndex = blockColors.at((y / 4) * blockColumns + (x / 4));
+
+            if (chance(m_fractionalDensity)) {
+                stitches.addStitch(QPoint(x, y), fractionalStitches[random() % fractionalTypes], colorIndex);
+
+                if (chance(0.5)) {
+                    Stitch::Type type = stitchMap[0][random() % 4];
+                    stitches.addStitch(QPoint(x, y), type, random() % m_colors);
+                }
+            } else {
+                stitches.addStitch(QPoint(x, y), Stitch::Full, colorIndex);
+            }
+        }
+    }
+
+    int backstitches = int(m_backstitchDensity * m_width * m_height);
+
+    for (int i = 0 ; i < backstitches ; ++i) {
+        int x = random() % (m_width + 1);   // separate statements keep the order of the random numbers fixed
+        int y = random() % (m_height + 1);
+        QPoint start(x * 2, y * 2);
+        int direction = random() % 8;
+        QPoint end = start + QPoint(backstitchDirections[direction][0], backstitchDirections[direction][1]);
+
+        end.setX(std::min(std::max(end.x(), 0), m_width * 2));
+        end.setY(std::min(std::max(end.y(), 0), m_height * 2));
+
+        if (end != start) {
+            stitches.addBackstitch(start, end, random() % m_colors);
+        }
+    }
+
+    int knots = int(m_knotDensity * m_width * m_height);
+
+    for (int i = 0 ; i < knots ; ++i) {
+        int x = random() % (m_width * 2 + 1);
+        int y = random() % (m_height * 2 + 1);
+        stitches.addFrenchKnot(QPoint(x, y), random() % m_colors);
+    }
+
+    stitches.takeChangedArea();     // there are no views to update
+
+    return pattern;
+}
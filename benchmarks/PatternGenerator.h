@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2026 by agent
+ * agent@local
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+#ifndef PatternGenerator_H
+#define PatternGenerator_H
+
+
+#include <QtGlobal>
+
+
+class Pattern;
+
+
+class PatternGenerator
+{
+public:
+    PatternGenerator(int, int, int, double, double, double knotDensity = 0.0, quint32 seed = 1);
+
+    void setUseScheme(bool);
+
+    Pattern *generate() const;
+
+private:
+    int     m_width;
+    int     m_height;
+    int     m_colors;
+    double  m_fractionalDensity;
+    double  m_backstitchDensity;
+    double  m_knotDensity;
+    quint32 m_seed;
+    bool    m_useScheme;
+};
+
+
+#endif // PatternGenerator_H
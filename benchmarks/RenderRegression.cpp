@@ -0,0 +1,438 @@
+/*
+ * Copyright (C) 2026 by agent
+ * agent@local
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+/**
+    @file
+    Implement the render regression tests that compare the output of the
+    Renderer with stored golden images.
+    The reference patterns are generated with fixed seeds and generated colors,
+    and any documents in the documents directory of the golden image directory
+    are added to them. Each reference is rendered at several cell sizes, which
+    cover the simplified levels of detail, and compared with the golden image
+    allowing a small tolerance for differences in antialiasing. The
+    multithreaded renderer must produce the same image as the single threaded
+    one. A missing golden image is a failure.
+
+    By default only the modes that do not draw symbols are rendered, stitches
+    as stitches and color blocks with backstitches as color lines and knots as
+    color blocks, since these do not depend on the installed symbol libraries
+    and fonts and their golden images belong in benchmarks/golden. Setting
+    KXSTITCH_RENDER_ALL_MODES=1 adds every other stitch, backstitch and knot
+    mode, the golden images for these have to be created on the machine
+    running the tests.
+
+    Running with KXSTITCH_UPDATE_GOLDEN=1 writes the golden images to the
+    golden directory of the build directory, or to KXSTITCH_GOLDEN_DIR if it
+    is set, to be reviewed and copied to the sources after an intended change
+    to the rendering. The golden image directory read can be changed with
+    KXSTITCH_GOLDEN_DIR and the directory the failed images are saved to with
+    KXSTITCH_RENDER_OUTPUT. The test is only registered with ctest once
+    benchmarks/golden exists, until then it is run directly to create them.
+
+    The render times are only checked when KXSTITCH_RENDER_TIMINGS is set to
+    the path of a timings file, as they depend on the machine and its load.
+    The fastest of several renders is compared with the time stored in the
+    file and the test fails if it is slower by more than the allowed margin,
+    as a fraction of the stored time, set with KXSTITCH_RENDER_TIME_MARGIN.
+    The file is written when the golden images are updated.
+    */
+
+
+#include "RenderRegression.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include <QDataStream>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QPainter>
+#include <QStandardPaths>
+#include <QtTest>
+
+#include "Document.h"
+#include "Pattern.h"
+#include "PatternGenerator.h"
+#include "Renderer.h"
+
+
+const char *stitchesAsNames[] = {
+    "Stitches",
+    "BlackWhiteSymbols",
+    "ColorSymbols",
+    "ColorBlocks",
+    "ColorBlocksSymbols"
+};
+
+
+const char *backstitchesAsNames[] = {
+    "ColorLines",
+    "BlackWhiteSymbols"
+};
+
+
+const char *knotsAsNames[] = {
+    "ColorBlocks",
+    "ColorBlocksSymbols",
+    "ColorSymbols",
+    "BlackWhiteSymbols"
+};
+
+
+const int cellSizes[] = {3, 5, 8, 16, 32};
+
+const int channelTolerance = 8;             // the difference in a color channel allowed for antialiasing
+const double pixelTolerance = 0.001;        // the fraction of the pixels allowed to differ
+const int timingRepeats = 5;
+const qint64 timingSlack = 2000000;         // nanoseconds allowed in addition to the margin for very short renders
+
+
+/**
+    Compare two images.
+    @param image a const reference to the first QImage
+    @param other a const reference to the second QImage
+    @return the fraction of the pixels that differ by more than the channel
+    tolerance, 1.0 if the images are different sizes
+    */
+static double imageDifference(const QImage &image, const QImage &other)
+{
+    if (image.size() != other.size()) {
+        return 1.0;
+    }
+
+    QImage first = image.convertToFormat(QImage::Format_ARGB32);
+    QImage second = other.convertToFormat(QImage::Format_ARGB32);
+    int differentPixels = 0;
+
+    for (int y = 0 ; y < first.height() ; ++y) {
+        const QRgb *firstLine = reinterpret_cast<const QRgb *>(first.constScanLine(y));
+        const QRgb *secondLine = reinterpret_cast<const QRgb *>(second.constScanLine(y));
+
+        for (int x = 0 ; x < first.width() ; ++x) {
+            QRgb a = firstLine[x];
+            QRgb b = secondLine[x];
+
+            if ((std::abs(qRed(a) - qRed(b)) > channelTolerance) ||
+                (std::abs(qGreen(a) - qGreen(b)) > channelTolerance) ||
+                (std::abs(qBlue(a) - qBlue(b)) > channelTolerance) ||
+                (std::abs(qAlpha(a) - qAlpha(b)) > channelTolerance)) {
+                differentPixels++;
+            }
+        }
+    }
+
+    return double(differentPixels) / (first.width() * first.height());
+}
+
+
+/**
+    Read a reference document.
+    @param fileName the name of the KXStitch file
+    @return a pointer to a copy of the documents Pattern, the caller takes
+    ownership, or nullptr if the file could not be read
+    */
+static Pattern *readPattern(const QString &fileName)
+{
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        return nullptr;
+    }
+
+    Document document;
+    QDataStream stream(&file);
+
+    try {
+        document.readKXStitch(stream);
+    } catch (...) {
+        return nullptr;
+    }
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_0);
+    out << *document.pattern();
+
+    Pattern *pattern = new Pattern;
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_4_0);
+    in >> *pattern;
+
+    return pattern;
+}
+
+
+/**
+    Isolate the configuration from the users settings, read the reference
+    patterns and the stored timings.
+    */
+void RenderRegression::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+
+    m_goldenPath = QString::fromLocal8Bit(qgetenv("KXSTITCH_GOLDEN_DIR"));
+    m_updatePath = m_goldenPath;
+
+    if (m_goldenPath.isEmpty()) {
+        m_goldenPath = QStringLiteral(KXSTITCH_GOLDEN_DIR);
+        m_updatePath = QStringLiteral(KXSTITCH_GOLDEN_UPDATE_DIR);
+    }
+
+    m_update = !qgetenv("KXSTITCH_UPDATE_GOLDEN").isEmpty();
+    m_allModes = !qgetenv("KXSTITCH_RENDER_ALL_MODES").isEmpty();
+    m_timingsPath = QString::fromLocal8Bit(qgetenv("KXSTITCH_RENDER_TIMINGS"));
+
+    bool ok;
+    m_timeMargin = qgetenv("KXSTITCH_RENDER_TIME_MARGIN").toDouble(&ok);
+
+    if (!ok) {
+        m_timeMargin = 0.5;
+    }
+
+    PatternGenerator mixed(16, 12, 12, 0.3, 0.3, 0.2, 1);
+    mixed.setUseScheme(false);
+    m_patterns.insert(QStringLiteral("mixed"), mixed.generate());
+
+    PatternGenerator imported(40, 30, 40, 0.05, 0.02, 0.01, 2);
+    imported.setUseScheme(false);
+    m_patterns.insert(QStringLiteral("imported"), imported.generate());
+
+    QDir documents(m_goldenPath + QStringLiteral("/documents"));
+
+    foreach (const QString &fileName, documents.entryList(QStringList(QStringLiteral("*.kxs")), QDir::Files, QDir::Name)) {
+        Pattern *pattern = readPattern(documents.filePath(fileName));
+
+        if (pattern == nullptr) {
+            QWARN(qPrintable(QStringLiteral("Unable to read the reference document %1").arg(fileName)));
+            continue;
+        }
+
+        delete m_patterns.value(QFileInfo(fileName).completeBaseName());
+        m_patterns.insert(QFileInfo(fileName).completeBaseName(), pattern);
+    }
+
+    if (!m_timingsPath.isEmpty() && !m_update) {
+        QFile timings(m_timingsPath);
+
+        if (timings.open(QIODevice::ReadOnly)) {
+            m_timings = QJsonDocument::fromJson(timings.readAll()).object();
+        } else {
+            QWARN(qPrintable(QStringLiteral("Unable to read the timings from %1").arg(m_timingsPath)));
+        }
+    }
+}
+
+
+/**
+    Save the timings when the golden images are being updated and a timings
+    file is set, and delete the reference patterns.
+    */
+void RenderRegression::cleanupTestCase()
+{
+    if (m_update && !m_timingsPath.isEmpty()) {
+        QFile timings(m_timingsPath);
+
+        if (timings.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            timings.write(QJsonDocument(m_timings).toJson());
+        } else {
+            QWARN("Unable to write the timings");
+        }
+    }
+
+    qDeleteAll(m_patterns);
+    m_patterns.clear();
+}
+
+
+/**
+    Create a row for each reference pattern, cell size and mode. Each mode is
+    rendered with the default modes of the other stitch types. Unless all the
+    modes are requested only the modes that do not draw symbols are used.
+    */
+void RenderRegression::render_data()
+{
+    QTest::addColumn<QString>("patternName");
+    QTest::addColumn<int>("cellSize");
+    QTest::addColumn<int>("stitchesAs");
+    QTest::addColumn<int>("backstitchesAs");
+    QTest::addColumn<int>("knotsAs");
+
+    foreach (const QString &patternName, m_patterns.keys()) {
+        QByteArray prefix = patternName.toUtf8();
+
+        for (int cellSize : cellSizes) {
+            QByteArray size = QByteArray::number(cellSize);
+
+            for (int stitchesAs = 0 ; stitchesAs < Configuration::EnumRenderer_RenderStitchesAs::COUNT ; ++stitchesAs) {
+                if (!m_allModes && (stitchesAs != Configuration::EnumRenderer_RenderStitchesAs::Stitches) && (stitchesAs != Configuration::EnumRenderer_RenderStitchesAs::ColorBlocks)) {
+                    continue;
+                }
+
+                QByteArray name = prefix + "-stitches-" + stitchesAsNames[stitchesAs] + '-' + size;
+                QTest::newRow(name.constData()) << patternName << cellSize << stitchesAs << int(Configuration::EnumRenderer_RenderBackstitchesAs::ColorLines) << int(Configuration::EnumRenderer_RenderKnotsAs::ColorBlocks);
+            }
+
+            if (!m_allModes) {
+                continue;
+            }
+
+            for (int backstitchesAs = 0 ; backstitchesAs < Configuration::EnumRenderer_RenderBackstitchesAs::COUNT ; ++backstitchesAs) {
+                QByteArray name = prefix + "-backstitches-" + backstitchesAsNames[backstitchesAs] + '-' + size;
+                QTest::newRow(name.constData()) << patternName << cellSize << int(Configuration::EnumRenderer_RenderStitchesAs::Stitches) << backstitchesAs << int(Configuration::EnumRenderer_RenderKnotsAs::ColorBlocks);
+            }
+
+            for (int knotsAs = 0 ; knotsAs < Configuration::EnumRenderer_RenderKnotsAs::COUNT ; ++knotsAs) {
+                QByteArray name = prefix + "-knots-" + knotsAsNames[knotsAs] + '-' + size;
+                QTest::newRow(name.constData()) << patternName << cellSize << int(Configuration::EnumRenderer_RenderStitchesAs::Stitches) << int(Configuration::EnumRenderer_RenderBackstitchesAs::ColorLines) << knotsAs;
+            }
+        }
+    }
+}
+
+
+/**
+    Render a row and compare it with the golden image and the stored timing.
+    */
+void RenderRegression::render()
+{
+    QFETCH(QString, patternName);
+    QFETCH(int, cellSize);
+    QFETCH(int, stitchesAs);
+    QFETCH(int, backstitchesAs);
+    QFETCH(int, knotsAs);
+
+    Pattern *pattern = m_patterns.value(patternName);
+    QString name = QString::fromUtf8(QTest::currentDataTag());
+    QString goldenFile = m_goldenPath + QLatin1Char('/') + name + QStringLiteral(".png");
+
+    auto renderStitchesAs = static_cast<Configuration::EnumRenderer_RenderStitchesAs::type>(stitchesAs);
+    auto renderBackstitchesAs = static_cast<Configuration::EnumRenderer_RenderBackstitchesAs::type>(backstitchesAs);
+    auto renderKnotsAs = static_cast<Configuration::EnumRenderer_RenderKnotsAs::type>(knotsAs);
+
+    qint64 time = 0;
+    QImage image = renderImage(pattern, cellSize, renderStitchesAs, renderBackstitchesAs, renderKnotsAs, false, (m_timingsPath.isEmpty()) ? nullptr : &time);
+
+    if (m_update) {
+        QVERIFY(QDir().mkpath(m_updatePath));
+        QVERIFY(image.save(m_updatePath + QLatin1Char('/') + name + QStringLiteral(".png")));
+        m_timings.insert(name, double(time));
+        return;
+    }
+
+    QImage golden(goldenFile);
+
+    if (golden.isNull()) {
+        QFAIL(qPrintable(QStringLiteral("There is no golden image %1, run with KXSTITCH_UPDATE_GOLDEN=1 to create it").arg(goldenFile)));
+    }
+
+    double difference = imageDifference(image, golden);
+
+    if (difference > pixelTolerance) {
+        QString saved = saveFailedImage(name, image);
+        QFAIL(qPrintable(QStringLiteral("%1% of the pixels differ from the golden image, the image was saved to %2").arg(difference * 100.0, 0, 'f', 2).arg(saved)));
+    }
+
+    QImage banded = renderImage(pattern, cellSize, renderStitchesAs, renderBackstitchesAs, renderKnotsAs, true, nullptr);
+
+    if (imageDifference(banded, image) > pixelTolerance) {
+        QString saved = saveFailedImage(name + QStringLiteral("-multithreaded"), banded);
+        QFAIL(qPrintable(QStringLiteral("The multithreaded render differs from the single threaded render, the image was saved to %1").arg(saved)));
+    }
+
+    if (m_timings.contains(name)) {
+        qint64 baseline = qint64(m_timings.value(name).toDouble());
+        qint64 limit = qint64(baseline * (1.0 + m_timeMargin)) + timingSlack;
+
+        QVERIFY2(time <= limit, qPrintable(QStringLiteral("The render took %1 ms, the baseline is %2 ms").arg(time / 1000000.0, 0, 'f', 3).arg(baseline / 1000000.0, 0, 'f', 3)));
+    }
+}
+
+
+/**
+    Render a pattern.
+    @param pattern a pointer to the Pattern to render
+    @param cellSize the size of a cell in pixels
+    @param stitchesAs the mode to render the stitches in
+    @param backstitchesAs the mode to render the backstitches in
+    @param knotsAs the mode to render the french knots in
+    @param multithreaded true if the large renders can be split into bands
+    @param time a pointer to a qint64 to return the time of the fastest render
+    in nanoseconds, or nullptr if the render is not timed
+    @return the rendered QImage
+    */
+QImage RenderRegression::renderImage(Pattern *pattern, int cellSize, Configuration::EnumRenderer_RenderStitchesAs::type stitchesAs, Configuration::EnumRenderer_RenderBackstitchesAs::type backstitchesAs, Configuration::EnumRenderer_RenderKnotsAs::type knotsAs, bool multithreaded, qint64 *time) const
+{
+    StitchData &stitches = pattern->stitches();
+
+    Renderer renderer;
+    renderer.setCellGrouping(10, 10);
+    renderer.setGridLineColors(QColor(Qt::lightGray), QColor(Qt::darkGray));
+    renderer.setLevelOfDetail(4, 6);
+    renderer.setMultithreaded(multithreaded);
+    renderer.setRenderStitchesAs(stitchesAs);
+    renderer.setRenderBackstitchesAs(backstitchesAs);
+    renderer.setRenderKnotsAs(knotsAs);
+
+    QImage image(stitches.width() * cellSize, stitches.height() * cellSize, QImage::Format_ARGB32_Premultiplied);
+    qint64 fastest = 0;
+
+    for (int repeat = 0 ; repeat < ((time) ? timingRepeats : 1) ; ++repeat) {
+        QElapsedTimer timer;
+        timer.start();
+
+        image.fill(Qt::white);
+
+        QPainter painter(&image);
+        painter.setRenderHint(QPainter::Antialiasing, true);
+        painter.setWindow(0, 0, stitches.width(), stitches.height());
+
+        renderer.render(&painter, pattern, painter.window(), true, true, true, true, -1);
+        painter.end();
+
+        qint64 elapsed = timer.nsecsElapsed();
+        fastest = (repeat == 0) ? elapsed : std::min(fastest, elapsed);
+    }
+
+    if (time) {
+        *time = fastest;
+    }
+
+    return image;
+}
+
+
+/**
+    Save an image that failed a comparison so it can be inspected.
+    @param name the name of the test row
+    @param image a const reference to the QImage
+    @return the name of the file saved
+    */
+QString RenderRegression::saveFailedImage(const QString &name, const QImage &image) const
+{
+    QString path = QString::fromLocal8Bit(qgetenv("KXSTITCH_RENDER_OUTPUT"));
+
+    if (path.isEmpty()) {
+        path = QDir::tempPath() + QStringLiteral("/kxstitch-render-regression");
+    }
+
+    QDir().mkpath(path);
+
+    QString fileName = path + QLatin1Char('/') + name + QStringLiteral(".png");
+    image.save(fileName);
+
+    return fileName;
+}
+
+
+QTEST_MAIN(RenderRegression)
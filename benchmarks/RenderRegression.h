@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2026 by agent
+ * agent@local
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+#ifndef RenderRegression_H
+#define RenderRegression_H
+
+
+#include <QImage>
+#include <QJsonObject>
+#include <QMap>
+#include <QObject>
+#include <QString>
+
+#include "configuration.h"
+
+
+class Pattern;
+
+
+class RenderRegression : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void render_data();
+    void render();
+
+private:
+    QImage renderImage(Pattern *, int, Configuration::EnumRenderer_RenderStitchesAs::type, Configuration::EnumRenderer_RenderBackstitchesAs::type, Configuration::EnumRenderer_RenderKnotsAs::type, bool, qint64 *) const;
+    QString saveFailedImage(const QString &, const QImage &) const;
+
+    QMap<QString, Pattern *>    m_patterns;
+    QString                     m_goldenPath;
+    QString                     m_updatePath;
+    QString                     m_timingsPath;
+    bool                        m_update;
+    bool                        m_allModes;
+    double                      m_timeMargin;
+    QJsonObject                 m_timings;
+};
+
+
+#endif // RenderRegression_H
@@ -0,0 +1,352 @@
+/*
+ * Copyright (C) 2026 by agent
+ * agent@local
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+/**
+    @file
+    Implement the kxstitch-replay tool that replays an editor session recorded
+    with the kxstitch --record option and reports the latency of the events.
+    The recorded document is opened in a MainWindow, using the offscreen
+    platform unless QT_QPA_PLATFORM is set, and the recorded editing state is
+    restored. Each event is then sent to the editor and timed until the
+    document updates and repaints it causes have been processed. The events
+    are sent as fast as possible unless the --realtime option is given.
+    The latency percentiles are reported for each type of event along with
+    the number of paint events and the time spent painting.
+    */
+
+
+#include <algorithm>
+#include <cmath>
+
+#include <QAction>
+#include <QActionGroup>
+#include <QApplication>
+#include <QClipboard>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QMap>
+#include <QMimeData>
+#include <QScopedPointer>
+#include <QScrollArea>
+#include <QScrollBar>
+#include <QTemporaryFile>
+#include <QTextStream>
+#include <QThread>
+#include <QUrl>
+#include <QVector>
+
+#include <KActionCollection>
+#include <KLocalizedString>
+
+#include "Document.h"
+#include "Editor.h"
+#include "Exceptions.h"
+#include "InputRecorder.h"
+#include "MainWindow.h"
+
+
+class ReplayApplication : public QApplication
+{
+public:
+    ReplayApplication(int &, char **);
+
+    virtual bool notify(QObject *, QEvent *) Q_DECL_OVERRIDE;
+
+    int     paintEvents;
+    qint64  paintTime;
+};
+
+
+/**
+    Constructor.
+    @param argc a reference to the argument count
+    @param argv a pointer to the arguments
+    */
+ReplayApplication::ReplayApplication(int &argc, char **argv)
+    :   QApplication(argc, argv),
+        paintEvents(0),
+        paintTime(0)
+{
+}
+
+
+/**
+    Deliver an event, timing the paint events.
+    @param receiver a pointer to the QObject receiving the event
+    @param e a pointer to the event
+    @return the result of delivering the event
+    */
+bool ReplayApplication::notify(QObject *receiver, QEvent *e)
+{
+    if (e->type() != QEvent::Paint) {
+        return QApplication::notify(receiver, e);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    bool result = QApplication::notify(receiver, e);
+
+    paintTime += timer.nsecsElapsed();
+    paintEvents++;
+
+    return result;
+}
+
+
+/**
+    Process the events queued by the last event, including the coalesced
+    document updates and the repaints they schedule.
+    */
+static void processPendingEvents()
+{
+    QCoreApplication::processEvents();
+    QCoreApplication::sendPostedEvents();
+}
+
+
+/**
+    Get the name used to group the latencies of an event.
+    @param event a const reference to the RecordedEvent
+    @return a QString of the name
+    */
+static QString eventName(const RecordedEvent &event)
+{
+    switch (event.type) {
+    case QEvent::MouseButtonPress:
+        return QStringLiteral("mouse press");
+
+    case QEvent::MouseButtonRelease:
+        return QStringLiteral("mouse release");
+
+    case QEvent::MouseButtonDblClick:
+        return QStringLiteral("mouse double click");
+
+    case QEvent::MouseMove:
+        return (event.buttons == Qt::NoButton) ? QStringLiteral("mouse hover") : QStringLiteral("mouse drag");
+
+    case QEvent::Wheel:
+        return QStringLiteral("wheel");
+
+    case QEvent::KeyPress:
+        return QStringLiteral("key press");
+
+    case QEvent::KeyRelease:
+        return QStringLiteral("key release");
+
+    default:
+        return event.action;
+    }
+}
+
+
+/**
+    Get a percentile of a set of latencies using the nearest rank.
+    @param sorted a const reference to the sorted latencies
+    @param percent the percentile required
+    @return the latency in nanoseconds
+    */
+static qint64 percentile(const QVector<qint64> &sorted, double percent)
+{
+    int rank = int(std::ceil(percent / 100.0 * sorted.count()));
+
+    return sorted.at(std::min(std::max(rank, 1), sorted.count()) - 1);
+}
+
+
+/**
+    Format a line of the report.
+    @param name the name of the events
+    @param latencies a reference to the latencies of the events, these will be sorted
+    @return a QString of the formatted line
+    */
+static QString reportLine(const QString &name, QVector<qint64> &latencies)
+{
+    std::sort(latencies.begin(), latencies.end());
+
+    QString line = name.leftJustified(24) + QString::number(latencies.count()).rightJustified(8);
+
+    foreach (qint64 latency, QVector<qint64>() << percentile(latencies, 50) << percentile(latencies, 90) << percentile(latencies, 99) << latencies.last()) {
+        line += QString::number(latency / 1000000.0, 'f', 3).rightJustified(10);
+    }
+
+    return line;
+}
+
+
+/**
+    Replay a recording and report the latencies.
+    @return 0 if the recording was replayed, 1 otherwise
+    */
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    ReplayApplication app(argc, argv);
+    KLocalizedString::setApplicationDomain("kxstitch");
+    app.setApplicationName(QStringLiteral("kxstitch"));     // use the configuration and the user interface of the application
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Replay an editor session recorded with kxstitch --record and report the latency of the events."));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("recording"), QStringLiteral("The recording to replay."));
+    parser.addOption(QCommandLineOption(QStringLiteral("realtime"), QStringLiteral("Send the events at the times they were recorded rather than as fast as possible.")));
+    parser.process(app);
+
+    if (parser.positionalArguments().count() != 1) {
+        parser.showHelp(1);
+    }
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    InputRecording recording;
+
+    try {
+        recording.read(parser.positionalArguments().first());
+    } catch (const InvalidFile &) {
+        err << "The file is not a kxstitch input recording" << endl;
+        return 1;
+    } catch (const InvalidFileVersion &e) {
+        err << "The recording version is not supported: " << e.version << endl;
+        return 1;
+    } catch (const FailedReadFile &e) {
+        err << "Failed to read the recording: " << e.status << endl;
+        return 1;
+    }
+
+    QTemporaryFile documentFile(QDir::tempPath() + QStringLiteral("/kxstitch-replay-XXXXXX.kxs"));
+
+    if (!documentFile.open()) {
+        err << "Failed to create the temporary document: " << documentFile.errorString() << endl;
+        return 1;
+    }
+
+    documentFile.write(recording.document);
+    documentFile.close();
+
+    QScopedPointer<MainWindow> window(new MainWindow(QUrl::fromLocalFile(documentFile.fileName())));
+    window->resize(recording.windowSize);
+    window->show();
+    processPendingEvents();
+
+    Editor *editor = window->editor();
+    QScrollArea *scrollArea = dynamic_cast<QScrollArea *>(editor->parentWidget()->parentWidget());
+    KActionCollection *actions = window->actionCollection();
+
+    for (auto i = recording.actionStates.constBegin() ; i != recording.actionStates.constEnd() ; ++i) {
+        QAction *action = actions->action(i.key());
+
+        // an exclusive group is set by triggering the checked action
+        if (action && (action->isChecked() != i.value()) && (i.value() || !(action->actionGroup() && action->actionGroup()->isExclusive()))) {
+            action->trigger();
+        }
+    }
+
+    editor->setZoomFactor(recording.zoomFactor);
+    processPendingEvents();
+
+    app.paintEvents = 0;
+    app.paintTime = 0;
+
+    QMap<QString, QVector<qint64>> latencies;
+    QVector<qint64> allLatencies;
+    bool realtime = parser.isSet(QStringLiteral("realtime"));
+
+    QElapsedTimer replayTimer;
+    replayTimer.start();
+    qint64 eventTime = 0;
+
+    foreach (const RecordedEvent &event, recording.events) {
+        if (realtime) {
+            qint64 wait = event.time - replayTimer.nsecsElapsed();
+
+            if (wait > 0) {
+                QThread::usleep(wait / 1000);
+            }
+        }
+
+        // restore the state that is not changed by the recorded events
+        DocumentPalette &palette = editor->document()->pattern()->palette();
+
+        if (palette.currentIndex() != event.colorIndex) {
+            palette.setCurrentIndex(event.colorIndex);
+        }
+
+        scrollArea->horizontalScrollBar()->setValue(event.scrollPosition.x());
+        scrollArea->verticalScrollBar()->setValue(event.scrollPosition.y());
+        processPendingEvents();
+
+        QElapsedTimer timer;
+
+        if (event.target == RecordedEvent::TargetAction) {
+            QAction *action = actions->action(event.action);
+
+            if (action == nullptr) {
+                continue;
+            }
+
+            if (!event.clipboard.isEmpty()) {
+                QMimeData *mimeData = new QMimeData;
+                mimeData->setData(QStringLiteral("application/kxstitch"), event.clipboard);
+                QApplication::clipboard()->setMimeData(mimeData);
+            }
+
+            if (action->isCheckable() && (action->isChecked() == event.checked) && !(action->actionGroup() && action->actionGroup()->isExclusive())) {
+                action->setChecked(!event.checked);     // the trigger toggles it back to the recorded state
+            }
+
+            timer.start();
+            action->trigger();
+        } else {
+            QScopedPointer<QEvent> e(event.createEvent());
+
+            if (e.isNull()) {
+                continue;
+            }
+
+            timer.start();
+            QApplication::sendEvent((event.target == RecordedEvent::TargetEditor) ? static_cast<QObject *>(editor) : scrollArea, e.data());
+        }
+
+        processPendingEvents();
+
+        qint64 latency = timer.nsecsElapsed();
+        latencies[eventName(event)].append(latency);
+        allLatencies.append(latency);
+        eventTime += latency;
+    }
+
+    qint64 replayTime = replayTimer.nsecsElapsed();
+
+    if (allLatencies.isEmpty()) {
+        err << "The recording has no events" << endl;
+        return 1;
+    }
+
+    out << "Events:      " << allLatencies.count() << endl;
+    out << "Replay time: " << QString::number(replayTime / 1000000.0, 'f', 3) << " ms" << endl;
+    out << "Event time:  " << QString::number(eventTime / 1000000.0, 'f', 3) << " ms" << endl;
+    out << "Paint time:  " << QString::number(app.paintTime / 1000000.0, 'f', 3) << " ms in " << app.paintEvents << " paint events" << endl;
+    out << endl;
+    out << QStringLiteral("Latency (ms)").leftJustified(24) << QStringLiteral("count").rightJustified(8) << QStringLiteral("p50").rightJustified(10) << QStringLiteral("p90").rightJustified(10) << QStringLiteral("p99").rightJustified(10) << QStringLiteral("max").rightJustified(10) << endl;
+
+    for (auto i = latencies.begin() ; i != latencies.end() ; ++i) {
+        out << reportLine(i.key(), i.value()) << endl;
+    }
+
+    out << reportLine(QStringLiteral("all"), allLatencies) << endl;
+
+    return 0;
+}
@@ -2,14 +2,21 @@
 
 BUILD_TYPE="Release"
 WITH_PROFILE=""
+WITH_BENCHMARKS=""
+WITH_RENDER_TESTS=""
 VERBOSE=""
 SILENCE_DEPRECATED="-DSILENCE_DEPRECATED=1"
 THREADS=`cat /proc/cpuinfo | grep processor | wc -l`
 
 readopt='getopts $opts opt;rc=$?;[ $rc$opt == 0? ]&&exit 1;[ $rc == 0 ]||{ shift $[OPTIND-1];false; }'
-opts=dhpsvn
+opts=bdhprsvn
 while eval $readopt
 do
+    if [ $opt == "b" ]
+    then
+        WITH_BENCHMARKS="-DWITH_BENCHMARKS=On"
+    fi
+
     if [ $opt == "d" ]
     then
         BUILD_TYPE="DebugFull"
@@ -25,6 +32,11 @@ do
         WITH_PROFILE="-DWITH_PROFILING=On"
     fi
 
+    if [ $opt == "r" ]
+    then
+        WITH_RENDER_TESTS="-DWITH_RENDER_TESTS=On"
+    fi
+
     if [ $opt == "s" ]
     then
         THREADS=1
@@ -49,10 +61,12 @@ fi
 
 if (${SHOW_HELP:=false})
 then
-    echo "Usage build.sh -dhpsvn"
+    echo "Usage build.sh -bdhprsvn"
+    echo "  -b : Build the benchmarks and the input replay tool"
     echo "  -d : Build with debugging enabled"
     echo "  -h : Show this help"
     echo "  -p : Build with profiling enabled"
+    echo "  -r : Build the render regression tests"
     echo "  -s : Build with single thread"
     echo "  -v : Build with verbose compiler output"
     echo "  -n : No silencing of deprecated declarations"
@@ -61,7 +75,7 @@ else
     mkdir build
     if [ -d "build" ]; then
         cd build
-        cmake -DCMAKE_INSTALL_PREFIX=`qtpaths --install-prefix` .. -DCMAKE_BUILD_TYPE=$BUILD_TYPE $WITH_PROFILE $SILENCE_DEPRECATED && make -j${THREADS} $VERBOSE && sudo make install
+        cmake -DCMAKE_INSTALL_PREFIX=`qtpaths --install-prefix` .. -DCMAKE_BUILD_TYPE=$BUILD_TYPE $WITH_PROFILE $WITH_BENCHMARKS $WITH_RENDER_TESTS $SILENCE_DEPRECATED && make -j${THREADS} $VERBOSE && sudo make install
     else
         echo "Unable to create build directory. Build aborted\n"
     fi
@@ -71,6 +71,18 @@ bool BackgroundImages::showBackgroundImage(QSharedPointer<BackgroundImage> backg
 }
 
 
+qint64 BackgroundImages::memoryUsage() const
+{
+    qint64 usage = 0;
+
+    for (const QSharedPointer<BackgroundImage> &backgroundImage : m_backgroundImages) {
+        usage += MemoryAccounting::imageUsage(backgroundImage->image());
+    }
+
+    return usage;
+}
+
+
 QDataStream &operator<<(QDataStream &stream, const BackgroundImages &backgroundImages)
 {
     stream << qint32(backgroundImages.version);
@@ -24,6 +24,9 @@
 #include <QRect>
 #include <QSharedPointer>
 
+// Application includes
+#include "MemoryAccounting.h"
+
 
 // Forward declaration of Qt classes
 class QDataStream;
@@ -45,7 +48,7 @@ class BackgroundImage;
  * to the BackgroundImage will ensure the BackgroundImage will be deleted
  * regardless of which object owns it or how many references there are to it.
  */
-class BackgroundImages
+class BackgroundImages : public MemoryAccountable
 {
 public:
     /**
@@ -102,6 +105,13 @@ public:
      */
     bool showBackgroundImage(QSharedPointer<BackgroundImage> backgroundImage, bool show);
 
+    /**
+     * Get the memory used by the pixels of the background images.
+     *
+     * @return the number of bytes used
+     */
+    virtual qint64 memoryUsage() const Q_DECL_OVERRIDE;
+
     /**
      * Operator to stream out the class instance to a QDataStream. This will
      * stream the instance of the BackgroundImage contained in the list.
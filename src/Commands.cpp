@@ -13,7 +13,6 @@
 
 #include <QApplication>
 #include <QClipboard>
-#include <QMimeData>
 
 #include <KLocalizedString>
 
@@ -24,9 +23,11 @@
 #include "FlossScheme.h"
 #include "MainWindow.h"
 #include "Palette.h"
+#include "PatternMimeData.h"
 #include "Preview.h"
 #include "SchemeManager.h"
 #include "StitchData.h"
+#include "Trace.h"
 
 
 FilePropertiesCommand::FilePropertiesCommand(Document *document)
@@ -63,6 +64,8 @@ ImportImageCommand::ImportImageCommand(Document *document)
 
 void ImportImageCommand::redo()
 {
+    TraceScope trace("command", "ImportImageCommand::redo");
+
     QUndoCommand::redo();
     m_document->editor()->readDocumentSettings();
     m_document->preview()->readDocumentSettings();
@@ -72,6 +75,8 @@ void ImportImageCommand::redo()
 
 void ImportImageCommand::undo()
 {
+    TraceScope trace("command", "ImportImageCommand::undo");
+
     QUndoCommand::undo();
     m_document->editor()->readDocumentSettings();
     m_document->preview()->readDocumentSettings();
@@ -88,17 +93,19 @@ PaintStitchesCommand::PaintStitchesCommand(Document *document)
 
 void PaintStitchesCommand::redo()
 {
+    TraceScope trace("command", "PaintStitchesCommand::redo");
+
     QUndoCommand::redo();
-    m_document->editor()->drawContents();
-    m_document->preview()->drawContents();
+    m_document->contentsChanged();
 }
 
 
 void PaintStitchesCommand::undo()
 {
+    TraceScope trace("command", "PaintStitchesCommand::undo");
+
     QUndoCommand::undo();
-    m_document->editor()->drawContents();
-    m_document->preview()->drawContents();
+    m_document->contentsChanged();
 }
 
 
@@ -111,17 +118,19 @@ PaintKnotsCommand::PaintKnotsCommand(Document *document)
 
 void PaintKnotsCommand::redo()
 {
+    TraceScope trace("command", "PaintKnotsCommand::redo");
+
     QUndoCommand::redo();
-    m_document->editor()->drawContents();
-    m_document->preview()->drawContents();
+    m_document->contentsChanged();
 }
 
 
 void PaintKnotsCommand::undo()
 {
+    TraceScope trace("command", "PaintKnotsCommand::undo");
+
     QUndoCommand::undo();
-    m_document->editor()->drawContents();
-    m_document->preview()->drawContents();
+    m_document->contentsChanged();
 }
 
 
@@ -134,17 +143,19 @@ DrawLineCommand::DrawLineCommand(Document *document)
 
 void DrawLineCommand::redo()
 {
+    TraceScope trace("command", "DrawLineCommand::redo");
+
     QUndoCommand::redo();
-    m_document->editor()->drawContents();
-    m_document->preview()->drawContents();
+    m_document->contentsChanged();
 }
 
 
 void DrawLineCommand::undo()
 {
+    TraceScope trace("command", "DrawLineCommand::undo");
+
     QUndoCommand::undo();
-    m_document->editor()->drawContents();
-    m_document->preview()->drawContents();
+    m_document->contentsChanged();
 }
 
 
@@ -157,17 +168,19 @@ EraseStitchesCommand::EraseStitchesCommand(Document *document)
 
 void EraseStitchesCommand::redo()
 {
+    TraceScope trace("command", "EraseStitchesCommand::redo");
+
     QUndoCommand::redo();
-    m_document->editor()->drawContents();
-    m_document->preview()->drawContents();
+    m_document->contentsChanged();
 }
 
 
 void EraseStitchesCommand::undo()
 {
+    TraceScope trace("command", "EraseStitchesCommand::undo");
+
     QUndoCommand::undo();
-    m_document->editor()->drawContents();
-    m_document->preview()->drawContents();
+    m_document->contentsChanged();
 }
 
 
@@ -180,17 +193,19 @@ DrawRectangleCommand::DrawRectangleCommand(Document *document)
 
 void DrawRectangleCommand::redo()
 {
+    TraceScope trace("command", "DrawRectangleCommand::redo");
+
     QUndoCommand::redo();
-    m_document->editor()->drawContents();
-    m_document->preview()->drawContents();
+    m_document->contentsChanged();
 }
 
 
 void DrawRectangleCommand::undo()
 {
+    TraceScope trace("command", "DrawRectangleCommand::undo");
+
     QUndoCommand::undo();
-    m_document->editor()->drawContents();
-    m_document->preview()->drawContents();
+    m_document->contentsChanged();
 }
 
 
@@ -203,17 +218,19 @@ FillRectangleCommand::FillRectangleCommand(Document *document)
 
 void FillRectangleCommand::redo()
 {
+    TraceScope trace("command", "FillRectangleCommand::redo");
+
     QUndoCommand::redo();
-    m_document->editor()->drawContents();
-    m_document->preview()->drawContents();
+    m_document->contentsChanged();
 }
 
 
 void FillRectangleCommand::undo()
 {
+    TraceScope trace("command", "FillRectangleCommand::undo");
+
     QUndoCommand::undo();
-    m_document->editor()->drawContents();
-    m_document->preview()->drawContents();
+    m_document->contentsChanged();
 }
 
 
@@ -227,17 +244,19 @@ DrawEllipseCommand::DrawEllipseCommand(Document *document)
 
 void DrawEllipseCommand::redo()
 {
+    TraceScope trace("command", "DrawEllipseCommand::redo");
+
     QUndoCommand::redo();
-    m_document->editor()->drawContents();
-    m_document->preview()->drawContents();
+    m_document->contentsChanged();
 }
 
 
 void DrawEllipseCommand::undo()
 {
+    TraceScope trace("command", "DrawEllipseCommand::undo");
+
     QUndoCommand::undo();
-    m_document->editor()->drawContents();
-    m_document->preview()->drawContents();
+    m_document->contentsChanged();
 }
 
 
@@ -250,17 +269,19 @@ FillEllipseCommand::FillEllipseCommand(Document *document)
 
 void FillEllipseCommand::redo()
 {
+    TraceScope trace("command", "FillEllipseCommand::redo");
+
     QUndoCommand::redo();
-    m_document->editor()->drawContents();
-    m_document->preview()->drawContents();
+    m_document->contentsChanged();
 }
 
 
 void FillEllipseCommand::undo()
 {
+    TraceScope trace("command", "FillEllipseCommand::undo");
+
     QUndoCommand::undo();
-    m_document->editor()->drawContents();
-    m_document->preview()->drawContents();
+    m_document->contentsChanged();
 }
 
 
@@ -273,17 +294,19 @@ FillPolygonCommand::FillPolygonCommand(Document *document)
 
 void FillPolygonCommand::redo()
 {
+    TraceScope trace("command", "FillPolygonCommand::redo");
+
     QUndoCommand::redo();
-    m_document->editor()->drawContents();
-    m_document->preview()->drawContents();
+    m_document->contentsChanged();
 }
 
 
 void FillPolygonCommand::undo()
 {
+    TraceScope trace("command", "FillPolygonCommand::undo");
+
     QUndoCommand::undo();
-    m_document->editor()->drawContents();
-    m_document->preview()->drawContents();
+    m_document->contentsChanged();
 }
 
 
@@ -327,6 +350,12 @@ void AddStitchCommand::undo()
 }
 
 
+qint64 AddStitchCommand::memoryUsage() const
+{
+    return (m_original) ? m_original->memoryUsage() : 0;
+}
+
+
 DeleteStitchCommand::DeleteStitchCommand(Document *document, const QPoint &cell, Stitch::Type type, int colorIndex, QUndoCommand *parent)
     :   QUndoCommand(i18n("Delete Stitches"), parent),
         m_document(document),
@@ -364,6 +393,12 @@ void DeleteStitchCommand::undo()
 }
 
 
+qint64 DeleteStitchCommand::memoryUsage() const
+{
+    return (m_original) ? m_original->memoryUsage() : 0;
+}
+
+
 AddBackstitchCommand::AddBackstitchCommand(Document *document, const QPoint &start, const QPoint &end, int colorIndex)
     :   QUndoCommand(i18n("Add Backstitch")),
         m_document(document),
@@ -377,16 +412,14 @@ AddBackstitchCommand::AddBackstitchCommand(Document *document, const QPoint &sta
 void AddBackstitchCommand::redo()
 {
     m_document->pattern()->stitches().addBackstitch(m_start, m_end, m_colorIndex);
-    m_document->editor()->drawContents();
-    m_document->preview()->drawContents();
+    m_document->contentsChanged();
 }
 
 
 void AddBackstitchCommand::undo()
 {
     delete m_document->pattern()->stitches().takeBackstitch(m_start, m_end, m_colorIndex);
-    m_document->editor()->drawContents();
-    m_document->preview()->drawContents();
+    m_document->contentsChanged();
 }
 
 
@@ -410,8 +443,7 @@ DeleteBackstitchCommand::~DeleteBackstitchCommand()
 void DeleteBackstitchCommand::redo()
 {
     m_backstitch = m_document->pattern()->stitches().takeBackstitch(m_start, m_end, m_colorIndex);
-    m_document->editor()->drawContents();
-    m_document->preview()->drawContents();
+    m_document->contentsChanged();
 }
 
 
@@ -419,8 +451,7 @@ void DeleteBackstitchCommand::undo()
 {
     m_document->pattern()->stitches().addBackstitch(m_backstitch);
     m_backstitch = nullptr;
-    m_document->editor()->drawContents();
-    m_document->preview()->drawContents();
+    m_document->contentsChanged();
 }
 
 
@@ -712,6 +743,8 @@ ResizeDocumentCommand::ResizeDocumentCommand(Document *document, int width, int
 
 void ResizeDocumentCommand::redo()
 {
+    TraceScope trace("command", "ResizeDocumentCommand::redo");
+
     m_originalWidth = m_document->pattern()->stitches().width();
     m_originalHeight = m_document->pattern()->stitches().height();
     QRect extents = m_document->pattern()->stitches().extents();
@@ -726,6 +759,8 @@ void ResizeDocumentCommand::redo()
 
 void ResizeDocumentCommand::undo()
 {
+    TraceScope trace("command", "ResizeDocumentCommand::undo");
+
     m_document->pattern()->stitches().resize(m_originalWidth, m_originalHeight);
     m_document->pattern()->stitches().movePattern(-m_xOffset, -m_yOffset);
 }
@@ -740,6 +775,8 @@ CropToPatternCommand::CropToPatternCommand(Document *document)
 
 void CropToPatternCommand::redo()
 {
+    TraceScope trace("command", "CropToPatternCommand::redo");
+
     m_originalWidth = m_document->pattern()->stitches().width();
     m_originalHeight = m_document->pattern()->stitches().height();
     QRect extents = m_document->pattern()->stitches().extents();
@@ -754,6 +791,8 @@ void CropToPatternCommand::redo()
 
 void CropToPatternCommand::undo()
 {
+    TraceScope trace("command", "CropToPatternCommand::undo");
+
     m_document->pattern()->stitches().resize(m_originalWidth, m_originalHeight);
     m_document->pattern()->stitches().movePattern(-m_xOffset, -m_yOffset);
     m_document->editor()->readDocumentSettings();
@@ -771,6 +810,8 @@ CropToSelectionCommand::CropToSelectionCommand(Document *document, const QRect &
 
 void CropToSelectionCommand::redo()
 {
+    TraceScope trace("command", "CropToSelectionCommand::redo");
+
     QList<Stitch::Type> maskStitches;
     maskStitches << Stitch::TLQtr << Stitch::TRQtr << Stitch::BLQtr << Stitch::BTHalf << Stitch::TL3Qtr << Stitch::BRQtr
                  << Stitch::TBHalf << Stitch::TR3Qtr << Stitch::BL3Qtr << Stitch::BR3Qtr << Stitch::Full << Stitch::TLSmallHalf
@@ -793,6 +834,8 @@ void CropToSelectionCommand::redo()
 
 void CropToSelectionCommand::undo()
 {
+    TraceScope trace("command", "CropToSelectionCommand::undo");
+
     QDataStream stream(&m_originalPattern, QIODevice::ReadOnly);
     stream >> m_document->pattern()->stitches();
     m_originalPattern.clear();
@@ -802,6 +845,12 @@ void CropToSelectionCommand::undo()
 }
 
 
+qint64 CropToSelectionCommand::memoryUsage() const
+{
+    return MemoryAccounting::byteArrayUsage(m_originalPattern);
+}
+
+
 InsertColumnsCommand::InsertColumnsCommand(Document *document, const QRect &selectionArea)
     :   QUndoCommand(i18n("Insert Columns")),
         m_document(document),
@@ -812,6 +861,8 @@ InsertColumnsCommand::InsertColumnsCommand(Document *document, const QRect &sele
 
 void InsertColumnsCommand::redo()
 {
+    TraceScope trace("command", "InsertColumnsCommand::redo");
+
     m_document->pattern()->stitches().insertColumns(m_selectionArea.left(), m_selectionArea.width());
 
     auto backgroundImageIterator = m_document->backgroundImages().backgroundImages();
@@ -831,6 +882,8 @@ void InsertColumnsCommand::redo()
 
 void InsertColumnsCommand::undo()
 {
+    TraceScope trace("command", "InsertColumnsCommand::undo");
+
     m_document->pattern()->stitches().removeColumns(m_selectionArea.left(), m_selectionArea.width());
 
     auto backgroundImageIterator = m_document->backgroundImages().backgroundImages();
@@ -858,6 +911,8 @@ InsertRowsCommand::InsertRowsCommand(Document *document, const QRect &selectionA
 
 void InsertRowsCommand::redo()
 {
+    TraceScope trace("command", "InsertRowsCommand::redo");
+
     m_document->pattern()->stitches().insertRows(m_selectionArea.top(), m_selectionArea.height());
 
     auto backgroundImageIterator = m_document->backgroundImages().backgroundImages();
@@ -877,6 +932,8 @@ void InsertRowsCommand::redo()
 
 void InsertRowsCommand::undo()
 {
+    TraceScope trace("command", "InsertRowsCommand::undo");
+
     m_document->pattern()->stitches().removeRows(m_selectionArea.top(), m_selectionArea.height());
 
     auto backgroundImageIterator = m_document->backgroundImages().backgroundImages();
@@ -907,6 +964,8 @@ ExtendPatternCommand::ExtendPatternCommand(Document *document, int top, int left
 
 void ExtendPatternCommand::redo()
 {
+    TraceScope trace("command", "ExtendPatternCommand::redo");
+
     StitchData &stitchData = m_document->pattern()->stitches();
     stitchData.resize(stitchData.width() + m_left + m_right, stitchData.height() + m_top + m_bottom);
     stitchData.movePattern(m_left, m_top);
@@ -924,6 +983,8 @@ void ExtendPatternCommand::redo()
 
 void ExtendPatternCommand::undo()
 {
+    TraceScope trace("command", "ExtendPatternCommand::undo");
+
     StitchData &stitchData = m_document->pattern()->stitches();
     stitchData.movePattern(-m_left, -m_top);
     stitchData.resize(stitchData.width() - m_left - m_right, stitchData.height() - m_top - m_bottom);
@@ -948,6 +1009,8 @@ CentrePatternCommand::CentrePatternCommand(Document *document)
 
 void CentrePatternCommand::redo()
 {
+    TraceScope trace("command", "CentrePatternCommand::redo");
+
     QRect extents = m_document->pattern()->stitches().extents();
 
     m_xOffset = ((m_document->pattern()->stitches().width() - extents.width()) / 2) - extents.left();
@@ -965,6 +1028,8 @@ void CentrePatternCommand::redo()
 
 void CentrePatternCommand::undo()
 {
+    TraceScope trace("command", "CentrePatternCommand::undo");
+
     if (m_xOffset || m_yOffset) {
         m_document->pattern()->stitches().movePattern(-m_xOffset, -m_yOffset);
 
@@ -1010,6 +1075,8 @@ ChangeSchemeCommand::ChangeSchemeCommand(Document *document, const QString &sche
 
 void ChangeSchemeCommand::redo()
 {
+    TraceScope trace("command", "ChangeSchemeCommand::redo");
+
     QDataStream stream(&m_originalPalette, QIODevice::WriteOnly);
     stream << m_document->pattern()->palette();
     m_document->pattern()->palette().setSchemeName(m_schemeName);
@@ -1022,6 +1089,8 @@ void ChangeSchemeCommand::redo()
 
 void ChangeSchemeCommand::undo()
 {
+    TraceScope trace("command", "ChangeSchemeCommand::undo");
+
     QDataStream stream(&m_originalPalette, QIODevice::ReadOnly);
     stream >> m_document->pattern()->palette();
     m_originalPalette.clear();
@@ -1032,6 +1101,12 @@ void ChangeSchemeCommand::undo()
 }
 
 
+qint64 ChangeSchemeCommand::memoryUsage() const
+{
+    return MemoryAccounting::byteArrayUsage(m_originalPalette);
+}
+
+
 EditorReadDocumentSettingsCommand::EditorReadDocumentSettingsCommand(Editor *editor)
     :   QUndoCommand(),
         m_editor(editor)
@@ -1081,6 +1156,8 @@ PaletteReplaceColorCommand::PaletteReplaceColorCommand(Document *document, int o
 
 void PaletteReplaceColorCommand::redo()
 {
+    TraceScope trace("command", "PaletteReplaceColorCommand::redo");
+
     if (m_stitches.count() || m_backstitches.count() || m_knots.count()) {
         // populated from a previous redo call
         // iterator over the existing pointers
@@ -1141,6 +1218,7 @@ void PaletteReplaceColorCommand::redo()
         }
     }
 
+    m_document->pattern()->stitches().invalidateSnapshot();   // the stitches were changed in place
     m_document->editor()->drawContents();
     m_document->preview()->drawContents();
     m_document->palette()->update();
@@ -1149,6 +1227,8 @@ void PaletteReplaceColorCommand::redo()
 
 void PaletteReplaceColorCommand::undo()
 {
+    TraceScope trace("command", "PaletteReplaceColorCommand::undo");
+
     QListIterator<Stitch *> stitchIterator(m_stitches);
 
     while (stitchIterator.hasNext()) {
@@ -1167,12 +1247,21 @@ void PaletteReplaceColorCommand::undo()
         knotIterator.next()->colorIndex = m_originalIndex;
     }
 
+    m_document->pattern()->stitches().invalidateSnapshot();
     m_document->editor()->drawContents();
     m_document->preview()->drawContents();
     m_document->palette()->update();
 }
 
 
+qint64 PaletteReplaceColorCommand::memoryUsage() const
+{
+    return MemoryAccounting::heapBlock(sizeof(QListData::Data) + m_stitches.count() * sizeof(Stitch *)) +
+           MemoryAccounting::heapBlock(sizeof(QListData::Data) + m_backstitches.count() * sizeof(Backstitch *)) +
+           MemoryAccounting::heapBlock(sizeof(QListData::Data) + m_knots.count() * sizeof(Knot *));
+}
+
+
 PaletteSwapColorCommand::PaletteSwapColorCommand(Document *document, int originalIndex, int swappedIndex)
     :   QUndoCommand(i18n("Swap Colors")),
         m_document(document),
@@ -1184,6 +1273,8 @@ PaletteSwapColorCommand::PaletteSwapColorCommand(Document *document, int origina
 
 void PaletteSwapColorCommand::redo()
 {
+    TraceScope trace("command", "PaletteSwapColorCommand::redo");
+
     m_document->pattern()->palette().swap(m_originalIndex, m_swappedIndex);
     m_document->editor()->drawContents();
     m_document->preview()->drawContents();
@@ -1193,6 +1284,8 @@ void PaletteSwapColorCommand::redo()
 
 void PaletteSwapColorCommand::undo()
 {
+    TraceScope trace("command", "PaletteSwapColorCommand::undo");
+
     redo();
 }
 
@@ -1226,44 +1319,42 @@ EditCutCommand::EditCutCommand(Document *document, const QRect &selectionArea, i
         m_colorMask(colorMask),
         m_stitchMasks(stitchMasks),
         m_excludeBackstitches(excludeBackstitches),
-        m_excludeKnots(excludeKnots),
-        m_originalPattern(nullptr)
+        m_excludeKnots(excludeKnots)
 {
 }
 
 
 EditCutCommand::~EditCutCommand()
 {
-    delete m_originalPattern;
 }
 
 
 void EditCutCommand::redo()
 {
-    m_originalPattern = m_document->pattern()->cut(m_selectionArea, m_colorMask, m_stitchMasks, m_excludeBackstitches, m_excludeKnots);
-
-    QByteArray data;
-    QDataStream stream(&data, QIODevice::WriteOnly);
-    stream << *m_originalPattern;
+    TraceScope trace("command", "EditCutCommand::redo");
 
-    QMimeData *mimeData = new QMimeData();
-    mimeData->setData(QStringLiteral("application/kxstitch"), data);
+    m_originalPattern = QSharedPointer<Pattern>(m_document->pattern()->cut(m_selectionArea, m_colorMask, m_stitchMasks, m_excludeBackstitches, m_excludeKnots));
 
-    QApplication::clipboard()->setMimeData(mimeData);
+    QApplication::clipboard()->setMimeData(new PatternMimeData(m_originalPattern));
 
-    m_document->editor()->drawContents();
-    m_document->preview()->drawContents();
+    m_document->contentsChanged();
 }
 
 
 void EditCutCommand::undo()
 {
-    m_document->pattern()->paste(m_originalPattern, m_selectionArea.topLeft(), true);
-    delete m_originalPattern;
-    m_originalPattern = nullptr;
+    TraceScope trace("command", "EditCutCommand::undo");
 
-    m_document->editor()->drawContents();
-    m_document->preview()->drawContents();
+    m_document->pattern()->paste(m_originalPattern.data(), m_selectionArea.topLeft(), true);
+    m_originalPattern.clear();  // the clipboard may still hold the pattern
+
+    m_document->contentsChanged();
+}
+
+
+qint64 EditCutCommand::memoryUsage() const
+{
+    return (m_originalPattern) ? m_originalPattern->stitches().memoryUsage() : 0;
 }
 
 
@@ -1277,32 +1368,51 @@ EditPasteCommand::EditPasteCommand(Document *document, Pattern *pattern, const Q
 }
 
 
+EditPasteCommand::EditPasteCommand(Document *document, const QSharedPointer<Pattern> &pattern, const QPoint &cell, bool merge, const QString &source)
+    :   QUndoCommand(source),
+        m_document(document),
+        m_pastePattern(pattern.data()),
+        m_sharedPattern(pattern),
+        m_cell(cell),
+        m_merge(merge)
+{
+}
+
+
 void EditPasteCommand::redo()
 {
-    QDataStream stream(&m_originalPattern, QIODevice::WriteOnly);
-    stream << *(m_document->pattern());
+    TraceScope trace("command", "EditPasteCommand::redo");
+
+    QRect pasteArea(m_cell, QSize(m_pastePattern->stitches().width(), m_pastePattern->stitches().height()));
+    m_originalPattern = m_document->pattern()->stitches().saveArea(QList<QRect>() << pasteArea);
+    m_originalPalette = m_document->pattern()->palette();   // shared until the paste adds any flosses
     m_document->pattern()->paste(m_pastePattern, m_cell, m_merge);
 
-    m_document->editor()->drawContents();
-    m_document->preview()->drawContents();
-    m_document->palette()->update();
+    m_document->contentsChanged();
 }
 
 
 void EditPasteCommand::undo()
 {
-    QDataStream stream(&m_originalPattern, QIODevice::ReadOnly);
-    m_document->pattern()->clear();
-    stream >> *(m_document->pattern());
+    TraceScope trace("command", "EditPasteCommand::undo");
+
+    m_document->pattern()->stitches().restoreArea(m_originalPattern);
+    m_document->pattern()->palette() = m_originalPalette;
     m_originalPattern.clear();
+    m_originalPalette = DocumentPalette();
 
-    m_document->editor()->drawContents();
-    m_document->preview()->drawContents();
+    m_document->contentsChanged();
     m_document->palette()->update();
 }
 
 
-MirrorSelectionCommand::MirrorSelectionCommand(Document *document, const QRect &selectionArea, int colorMask, const QList<Stitch::Type> &stitchMasks, bool excludeBackstitches, bool excludeKnots, Qt::Orientation orientation, bool copies, const QByteArray &originalPatternData, Pattern *invertedPattern, const QPoint &pasteCell, bool merge)
+qint64 EditPasteCommand::memoryUsage() const
+{
+    return m_pastePattern->stitches().memoryUsage() + MemoryAccounting::byteArrayUsage(m_originalPattern);
+}
+
+
+MirrorSelectionCommand::MirrorSelectionCommand(Document *document, const QRect &selectionArea, int colorMask, const QList<Stitch::Type> &stitchMasks, bool excludeBackstitches, bool excludeKnots, Qt::Orientation orientation, bool copies, Pattern *invertedPattern, const QPoint &pasteCell, bool merge)
     :   QUndoCommand(i18n("Mirror Selection")),
         m_document(document),
         m_selectionArea(selectionArea),
@@ -1312,7 +1422,6 @@ MirrorSelectionCommand::MirrorSelectionCommand(Document *document, const QRect &
         m_excludeKnots(excludeKnots),
         m_orientation(orientation),
         m_copies(copies),
-        m_originalPatternData(originalPatternData),
         m_invertedPattern(invertedPattern),
         m_pasteCell(pasteCell),
         m_merge(merge)
@@ -1328,29 +1437,39 @@ MirrorSelectionCommand::~MirrorSelectionCommand()
 
 void MirrorSelectionCommand::redo()
 {
+    TraceScope trace("command", "MirrorSelectionCommand::redo");
+
+    QRect pasteArea(m_pasteCell, QSize(m_invertedPattern->stitches().width(), m_invertedPattern->stitches().height()));
+    m_originalPatternData = m_document->pattern()->stitches().saveArea(QList<QRect>() << m_selectionArea << pasteArea);
+
     if (!m_copies) {
         delete m_document->pattern()->cut(m_selectionArea, m_colorMask, m_stitchMasks, m_excludeBackstitches, m_excludeKnots);
     }
 
     m_document->pattern()->paste(m_invertedPattern, m_pasteCell, m_merge);
 
-    m_document->editor()->drawContents();
-    m_document->preview()->drawContents();
+    m_document->contentsChanged();
 }
 
 
 void MirrorSelectionCommand::undo()
 {
-    m_document->pattern()->stitches().clear();
-    QDataStream stream(&m_originalPatternData, QIODevice::ReadOnly);
-    stream >> m_document->pattern()->stitches();
+    TraceScope trace("command", "MirrorSelectionCommand::undo");
 
-    m_document->editor()->drawContents();
-    m_document->preview()->drawContents();
+    m_document->pattern()->stitches().restoreArea(m_originalPatternData);
+    m_originalPatternData.clear();
+
+    m_document->contentsChanged();
 }
 
 
-RotateSelectionCommand::RotateSelectionCommand(Document *document, const QRect &selectionArea, int colorMask, const QList<Stitch::Type> &stitchMasks, bool excludeBackstitches, bool excludeKnots, StitchData::Rotation rotation, bool copies, const QByteArray &originalPatternData, Pattern *rotatedPattern, const QPoint &pasteCell, bool merge)
+qint64 MirrorSelectionCommand::memoryUsage() const
+{
+    return MemoryAccounting::byteArrayUsage(m_originalPatternData) + ((m_invertedPattern) ? m_invertedPattern->stitches().memoryUsage() : 0);
+}
+
+
+RotateSelectionCommand::RotateSelectionCommand(Document *document, const QRect &selectionArea, int colorMask, const QList<Stitch::Type> &stitchMasks, bool excludeBackstitches, bool excludeKnots, StitchData::Rotation rotation, bool copies, Pattern *rotatedPattern, const QPoint &pasteCell, bool merge)
     :   QUndoCommand(i18n("Rotate Selection")),
         m_document(document),
         m_selectionArea(selectionArea),
@@ -1360,7 +1479,6 @@ RotateSelectionCommand::RotateSelectionCommand(Document *document, const QRect &
         m_excludeKnots(excludeKnots),
         m_rotation(rotation),
         m_copies(copies),
-        m_originalPatternData(originalPatternData),
         m_rotatedPattern(rotatedPattern),
         m_pasteCell(pasteCell),
         m_merge(merge)
@@ -1376,25 +1494,35 @@ RotateSelectionCommand::~RotateSelectionCommand()
 
 void RotateSelectionCommand::redo()
 {
+    TraceScope trace("command", "RotateSelectionCommand::redo");
+
+    QRect pasteArea(m_pasteCell, QSize(m_rotatedPattern->stitches().width(), m_rotatedPattern->stitches().height()));
+    m_originalPatternData = m_document->pattern()->stitches().saveArea(QList<QRect>() << m_selectionArea << pasteArea);
+
     if (!m_copies) {
         delete m_document->pattern()->cut(m_selectionArea, m_colorMask, m_stitchMasks, m_excludeBackstitches, m_excludeKnots);
     }
 
     m_document->pattern()->paste(m_rotatedPattern, m_pasteCell, m_merge);
 
-    m_document->editor()->drawContents();
-    m_document->preview()->drawContents();
+    m_document->contentsChanged();
 }
 
 
 void RotateSelectionCommand::undo()
 {
-    m_document->pattern()->stitches().clear();
-    QDataStream stream(&m_originalPatternData, QIODevice::ReadOnly);
-    stream >> m_document->pattern()->stitches();
+    TraceScope trace("command", "RotateSelectionCommand::undo");
 
-    m_document->editor()->drawContents();
-    m_document->preview()->drawContents();
+    m_document->pattern()->stitches().restoreArea(m_originalPatternData);
+    m_originalPatternData.clear();
+
+    m_document->contentsChanged();
+}
+
+
+qint64 RotateSelectionCommand::memoryUsage() const
+{
+    return MemoryAccounting::byteArrayUsage(m_originalPatternData) + ((m_rotatedPattern) ? m_rotatedPattern->stitches().memoryUsage() : 0);
 }
 
 
@@ -1413,6 +1541,8 @@ AlphabetCommand::~AlphabetCommand()
 
 void AlphabetCommand::redo()
 {
+    TraceScope trace("command", "AlphabetCommand::redo");
+
     for (int i = 0 ; i < m_children.size() ; ++i) {
         m_children.at(i)->redo();
     }
@@ -1421,12 +1551,26 @@ void AlphabetCommand::redo()
 
 void AlphabetCommand::undo()
 {
+    TraceScope trace("command", "AlphabetCommand::undo");
+
     for (int i = m_children.size() - 1 ; i >= 0 ; --i) {
         m_children.at(i)->undo();
     }
 }
 
 
+qint64 AlphabetCommand::memoryUsage() const
+{
+    qint64 usage = MemoryAccounting::heapBlock(sizeof(QListData::Data) + m_children.count() * sizeof(QUndoCommand *));
+
+    foreach (const QUndoCommand *child, m_children) {
+        usage += MemoryAccounting::commandUsage(child);
+    }
+
+    return usage;
+}
+
+
 void AlphabetCommand::push(QUndoCommand *child)
 {
     m_children.append(child);
@@ -15,11 +15,13 @@
 
 #include <QPoint>
 #include <QRect>
+#include <QSharedPointer>
 #include <QString>
 #include <QUndoCommand>
 #include <QVariant>
 
 #include "DocumentPalette.h"
+#include "MemoryAccounting.h"
 #include "PrinterConfiguration.h"
 #include "Stitch.h"
 #include "StitchData.h"
@@ -190,7 +192,7 @@ private:
 };
 
 
-class AddStitchCommand : public QUndoCommand
+class AddStitchCommand : public QUndoCommand, public MemoryAccountable
 {
 public:
     AddStitchCommand(Document *, const QPoint &, Stitch::Type, int, QUndoCommand *);
@@ -199,6 +201,8 @@ public:
     virtual void redo() Q_DECL_OVERRIDE;
     virtual void undo() Q_DECL_OVERRIDE;
 
+    virtual qint64 memoryUsage() const Q_DECL_OVERRIDE;
+
 private:
     Document        *m_document;
     QPoint          m_cell;
@@ -208,7 +212,7 @@ private:
 };
 
 
-class DeleteStitchCommand : public QUndoCommand
+class DeleteStitchCommand : public QUndoCommand, public MemoryAccountable
 {
 public:
     DeleteStitchCommand(Document *, const QPoint &, Stitch::Type, int, QUndoCommand *);
@@ -217,6 +221,8 @@ public:
     virtual void redo() Q_DECL_OVERRIDE;
     virtual void undo() Q_DECL_OVERRIDE;
 
+    virtual qint64 memoryUsage() const Q_DECL_OVERRIDE;
+
 private:
     Document        *m_document;
     QPoint          m_cell;
@@ -477,7 +483,7 @@ private:
 };
 
 
-class CropToSelectionCommand : public QUndoCommand
+class CropToSelectionCommand : public QUndoCommand, public MemoryAccountable
 {
 public:
     CropToSelectionCommand(Document *, const QRect &);
@@ -486,6 +492,8 @@ public:
     void redo() Q_DECL_OVERRIDE;
     void undo() Q_DECL_OVERRIDE;
 
+    qint64 memoryUsage() const Q_DECL_OVERRIDE;
+
 private:
     Document    *m_document;
     QRect       m_selectionArea;
@@ -572,7 +580,7 @@ private:
 };
 
 
-class ChangeSchemeCommand : public QUndoCommand
+class ChangeSchemeCommand : public QUndoCommand, public MemoryAccountable
 {
 public:
     ChangeSchemeCommand(Document *, const QString &, QUndoCommand *parent = nullptr);
@@ -581,6 +589,8 @@ public:
     void redo() Q_DECL_OVERRIDE;
     void undo() Q_DECL_OVERRIDE;
 
+    qint64 memoryUsage() const Q_DECL_OVERRIDE;
+
 private:
     Document    *m_document;
     QString     m_schemeName;
@@ -616,7 +626,7 @@ private:
 };
 
 
-class PaletteReplaceColorCommand : public QUndoCommand
+class PaletteReplaceColorCommand : public QUndoCommand, public MemoryAccountable
 {
 public:
     PaletteReplaceColorCommand(Document *document, int, int);
@@ -625,6 +635,8 @@ public:
     void redo() Q_DECL_OVERRIDE;
     void undo() Q_DECL_OVERRIDE;
 
+    qint64 memoryUsage() const Q_DECL_OVERRIDE;
+
 private:
     Document    *m_document;
     int         m_originalIndex;
@@ -666,7 +678,7 @@ private:
 };
 
 
-class EditCutCommand : public QUndoCommand
+class EditCutCommand : public QUndoCommand, public MemoryAccountable
 {
 public:
     EditCutCommand(Document *document, const QRect &selectionArea, int colorMask, const QList<Stitch::Type> &stitchMasks, bool excludeBackstitches, bool excludeKnots);
@@ -675,6 +687,8 @@ public:
     void redo() Q_DECL_OVERRIDE;
     void undo() Q_DECL_OVERRIDE;
 
+    qint64 memoryUsage() const Q_DECL_OVERRIDE;
+
 private:
     Document            *m_document;
     QRect               m_selectionArea;
@@ -683,38 +697,45 @@ private:
     bool                m_excludeBackstitches;
     bool                m_excludeKnots;
 
-    Pattern             *m_originalPattern;
+    QSharedPointer<Pattern> m_originalPattern;
 };
 
 
-class EditPasteCommand : public QUndoCommand
+class EditPasteCommand : public QUndoCommand, public MemoryAccountable
 {
 public:
     EditPasteCommand(Document *document, Pattern *pattern, const QPoint &cell, bool merge, const QString &);
+    EditPasteCommand(Document *document, const QSharedPointer<Pattern> &pattern, const QPoint &cell, bool merge, const QString &);
     virtual ~EditPasteCommand() = default;
 
     void redo() Q_DECL_OVERRIDE;
     void undo() Q_DECL_OVERRIDE;
 
+    qint64 memoryUsage() const Q_DECL_OVERRIDE;
+
 private:
     Document    *m_document;
     Pattern     *m_pastePattern;
+    QSharedPointer<Pattern> m_sharedPattern;
     QPoint      m_cell;
     bool        m_merge;
 
-    QByteArray  m_originalPattern;
+    QByteArray      m_originalPattern;
+    DocumentPalette m_originalPalette;
 };
 
 
-class MirrorSelectionCommand : public QUndoCommand
+class MirrorSelectionCommand : public QUndoCommand, public MemoryAccountable
 {
 public:
-    MirrorSelectionCommand(Document *, const QRect &, int, const QList<Stitch::Type> &, bool, bool, Qt::Orientation, bool, const QByteArray &, Pattern *, const QPoint &, bool merge);
+    MirrorSelectionCommand(Document *, const QRect &, int, const QList<Stitch::Type> &, bool, bool, Qt::Orientation, bool, Pattern *, const QPoint &, bool merge);
     virtual ~MirrorSelectionCommand();
 
     virtual void redo() Q_DECL_OVERRIDE;
     virtual void undo() Q_DECL_OVERRIDE;
 
+    virtual qint64 memoryUsage() const Q_DECL_OVERRIDE;
+
 private:
     Document            *m_document;
     QRect               m_selectionArea;
@@ -731,15 +752,17 @@ private:
 };
 
 
-class RotateSelectionCommand : public QUndoCommand
+class RotateSelectionCommand : public QUndoCommand, public MemoryAccountable
 {
 public:
-    RotateSelectionCommand(Document *, const QRect &, int, const QList<Stitch::Type> &, bool, bool, StitchData::Rotation, bool, const QByteArray &, Pattern *, const QPoint &, bool);
+    RotateSelectionCommand(Document *, const QRect &, int, const QList<Stitch::Type> &, bool, bool, StitchData::Rotation, bool, Pattern *, const QPoint &, bool);
     virtual ~RotateSelectionCommand();
 
     void redo() Q_DECL_OVERRIDE;
     void undo() Q_DECL_OVERRIDE;
 
+    qint64 memoryUsage() const Q_DECL_OVERRIDE;
+
 private:
     Document                *m_document;
     QRect                   m_selectionArea;
@@ -756,7 +779,7 @@ private:
 };
 
 
-class AlphabetCommand : public QUndoCommand
+class AlphabetCommand : public QUndoCommand, public MemoryAccountable
 {
 public:
     explicit AlphabetCommand(Document *);
@@ -765,6 +788,8 @@ public:
     void redo() Q_DECL_OVERRIDE;
     void undo() Q_DECL_OVERRIDE;
 
+    qint64 memoryUsage() const Q_DECL_OVERRIDE;
+
     void push(QUndoCommand *);
     QUndoCommand *pop();
 
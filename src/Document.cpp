@@ -23,9 +23,11 @@
 #include "Floss.h"
 #include "FlossScheme.h"
 #include "Layers.h"
+#include "MemoryAccounting.h"
 #include "Palette.h"
 #include "Preview.h"
 #include "SchemeManager.h"
+#include "Trace.h"
 
 
 Document::Document()
@@ -34,12 +36,41 @@ Document::Document()
         m_preview(nullptr),
         m_pattern(nullptr)
 {
+    m_updateTimer.setSingleShot(true);
+    m_updateTimer.setInterval(0);
+    QObject::connect(&m_updateTimer, &QTimer::timeout, [this]() {
+        updateViews();
+    });
+
+    MemoryAccounting::add(this, i18n("Untitled"), i18n("Stitches"), [this]() {
+        return (m_pattern) ? m_pattern->stitches().memoryUsage() : 0;
+    });
+    MemoryAccounting::add(this, i18n("Untitled"), i18n("Undo stack"), [this]() {
+        return MemoryAccounting::undoStackUsage(m_undoStack);
+    });
+    MemoryAccounting::add(this, i18n("Untitled"), i18n("Background images"), [this]() {
+        return m_backgroundImages.memoryUsage();
+    });
+
     initialiseNew();
 }
 
 
+// a document holding only a copy of the properties and a pattern, which it takes ownership of,
+// used to render pages in worker threads without reading the document being edited
+Document::Document(const QMap<QString, QVariant> &properties, Pattern *pattern)
+    :   m_properties(properties),
+        m_editor(nullptr),
+        m_palette(nullptr),
+        m_preview(nullptr),
+        m_pattern(pattern)
+{
+}
+
+
 Document::~Document()
 {
+    MemoryAccounting::remove(this);
     delete m_pattern;
 }
 
@@ -135,6 +166,8 @@ QUndoStack &Document::undoStack()
 void Document::setUrl(const QUrl &url)
 {
     m_url = url;
+
+    MemoryAccounting::setGroup(this, url.fileName().isEmpty() ? url.toString() : url.fileName());
 }
 
 
@@ -162,6 +195,35 @@ void Document::addView(Preview *preview)
 }
 
 
+void Document::contentsChanged()
+{
+    // changes made while handling an event are combined and the views updated
+    // with just the changed cells and flosses when the event loop next runs
+    m_updateTimer.start();
+}
+
+
+void Document::updateViews()
+{
+    QRect cells = m_pattern->stitches().takeChangedArea();
+    QSet<int> flosses = m_pattern->palette().takeChangedFlosses();
+
+    if (cells.isValid()) {
+        if (m_editor) {
+            m_editor->drawContents(cells);
+        }
+
+        if (m_preview) {
+            m_preview->drawContents(cells);
+        }
+    }
+
+    if (!flosses.isEmpty() && m_palette) {
+        m_palette->update();
+    }
+}
+
+
 Editor *Document::editor() const
 {
     return m_editor;
@@ -206,6 +268,9 @@ void Document::setPrinterConfiguration(const PrinterConfiguration &printerConfig
 
 void Document::readKXStitch(QDataStream &stream)
 {
+    TraceScope trace("document", "Document::readKXStitch");
+    trace.addArgument("bytes", stream.device()->size());
+
     initialiseNew();
 
     char header[30];
@@ -304,6 +369,9 @@ void Document::readKXStitch(QDataStream &stream)
 
 void Document::readPCStitch(QDataStream &stream)
 {
+    TraceScope trace("document", "Document::readPCStitch");
+    trace.addArgument("bytes", stream.device()->size());
+
     initialiseNew();
 
     char header[23];
@@ -323,6 +391,12 @@ void Document::readPCStitch(QDataStream &stream)
 
 void Document::write(QDataStream &stream)
 {
+    TraceScope trace("document", "Document::write");
+    trace.addArgument("width", m_pattern->stitches().width());
+    trace.addArgument("height", m_pattern->stitches().height());
+    trace.addArgument("backstitches", m_pattern->stitches().backstitches().count());
+    trace.addArgument("knots", m_pattern->stitches().knots().count());
+
     stream.setVersion(QDataStream::Qt_4_0); // maintain consistancy in the qt types
     stream.writeRawData("KXStitchDoc", 11);
     stream << version;
@@ -337,6 +411,12 @@ void Document::write(QDataStream &stream)
 }
 
 
+QMap<QString, QVariant> Document::properties() const
+{
+    return m_properties;
+}
+
+
 QVariant Document::property(const QString &name) const
 {
     QVariant p;
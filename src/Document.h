@@ -14,6 +14,7 @@
 
 
 #include <QPolygon>
+#include <QTimer>
 #include <QUndoStack>
 #include <QUrl>
 
@@ -33,6 +34,7 @@ class Document
 {
 public:
     Document();
+    Document(const QMap<QString, QVariant> &, Pattern *);
     ~Document();
 
     void initialiseNew();
@@ -47,11 +49,13 @@ public:
     void addView(Editor *);
     void addView(Palette *);
     void addView(Preview *);
+    void contentsChanged();
 
     Editor *editor() const;
     Palette *palette() const;
     Preview *preview() const;
 
+    QMap<QString, QVariant> properties() const;
     QVariant property(const QString &) const;
     void setProperty(const QString &, const QVariant &);
 
@@ -68,6 +72,8 @@ private:
     void readPCStitch7File(QDataStream &);
     QString readPCStitchString(QDataStream &);
 
+    void updateViews();
+
     void readKXStitchV2File(QDataStream &);
     void readKXStitchV3File(QDataStream &);
     void readKXStitchV4File(QDataStream &);
@@ -87,6 +93,8 @@ private:
     Palette *m_palette;
     Preview *m_preview;
 
+    QTimer  m_updateTimer;
+
     BackgroundImages    m_backgroundImages;
     Pattern             *m_pattern;
     PrinterConfiguration    m_printerConfiguration;
@@ -36,6 +36,7 @@ public:
     QString                     m_symbolLibrary;
     int                         m_currentIndex;
     QMap<int, DocumentFloss *>  m_documentFlosses;
+    QSet<int>                   m_changedFlosses;
 };
 
 
@@ -52,7 +53,8 @@ DocumentPaletteData::DocumentPaletteData(const DocumentPaletteData &other)
     :   QSharedData(other),
         m_schemeName(other.m_schemeName),
         m_symbolLibrary(other.m_symbolLibrary),
-        m_currentIndex(other.m_currentIndex)
+        m_currentIndex(other.m_currentIndex),
+        m_changedFlosses(other.m_changedFlosses)
 {
     for (QMap<int, DocumentFloss*>::const_iterator i = other.m_documentFlosses.constBegin() ; i != other.m_documentFlosses.constEnd() ; ++i) {
         m_documentFlosses.insert(i.key(), new DocumentFloss(other.m_documentFlosses.value(i.key())));
@@ -202,8 +204,9 @@ void DocumentPalette::setSymbolLibrary(const QString &symbolLibrary)
     if (d->m_documentFlosses.count() <= indexes.count()) {
         d->m_symbolLibrary = symbolLibrary;
 
-        foreach (DocumentFloss *documentFloss, d->m_documentFlosses) {
-            documentFloss->setStitchSymbol(indexes.takeFirst());
+        for (QMap<int, DocumentFloss*>::const_iterator i = d->m_documentFlosses.constBegin() ; i != d->m_documentFlosses.constEnd() ; ++i) {
+            i.value()->setStitchSymbol(indexes.takeFirst());
+            d->m_changedFlosses.insert(i.key());
         }
     }
 }
@@ -218,6 +221,7 @@ void DocumentPalette::setCurrentIndex(int currentIndex)
 void DocumentPalette::add(int flossIndex, DocumentFloss *documentFloss)
 {
     d->m_documentFlosses.insert(flossIndex, documentFloss);
+    d->m_changedFlosses.insert(flossIndex);
 
     if (d->m_currentIndex == -1) {
         d->m_currentIndex = 0;
@@ -256,6 +260,7 @@ int DocumentPalette::add(const QColor &srcColor)
 DocumentFloss *DocumentPalette::remove(int flossIndex)
 {
     DocumentFloss *documentFloss = d->m_documentFlosses.take(flossIndex);
+    d->m_changedFlosses.insert(flossIndex);
 
     if (d->m_documentFlosses.count() == 0) {
         d->m_currentIndex = -1;
@@ -269,6 +274,7 @@ DocumentFloss *DocumentPalette::replace(int flossIndex, DocumentFloss *documentF
 {
     DocumentFloss *old = d->m_documentFlosses.take(flossIndex);
     d->m_documentFlosses.insert(flossIndex, documentFloss);
+    d->m_changedFlosses.insert(flossIndex);
     return old;
 }
 
@@ -278,6 +284,21 @@ void DocumentPalette::swap(int originalIndex, int swappedIndex)
     DocumentFloss *original = d->m_documentFlosses.take(originalIndex);
     d->m_documentFlosses.insert(originalIndex, d->m_documentFlosses.take(swappedIndex));
     d->m_documentFlosses.insert(swappedIndex, original);
+    d->m_changedFlosses.insert(originalIndex);
+    d->m_changedFlosses.insert(swappedIndex);
+}
+
+
+QSet<int> DocumentPalette::takeChangedFlosses()
+{
+    QSet<int> changedFlosses;
+
+    if (!d.constData()->m_changedFlosses.isEmpty()) {  // avoid detaching a shared palette if nothing has changed
+        changedFlosses = d->m_changedFlosses;
+        d->m_changedFlosses.clear();
+    }
+
+    return changedFlosses;
 }
 
 
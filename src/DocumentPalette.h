@@ -16,6 +16,7 @@
 #include <QDataStream>
 #include <QList>
 #include <QMap>
+#include <QSet>
 #include <QSharedDataPointer>
 #include <QStringList>
 
@@ -53,6 +54,8 @@ public:
     void swap(int, int);
     qint16 freeSymbol() const;
 
+    QSet<int> takeChangedFlosses();
+
     DocumentPalette &operator=(const DocumentPalette &);
     bool operator==(const DocumentPalette &) const;
     bool operator!=(const DocumentPalette &) const;
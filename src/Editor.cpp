@@ -13,7 +13,6 @@
 
 #include <QAction>
 #include <QApplication>
-#include <QBitmap>
 #include <QClipboard>
 #include <QContextMenuEvent>
 #include <QMenu>
@@ -41,11 +40,15 @@
 #include "LibraryPattern.h"
 #include "LibraryTreeWidgetItem.h"
 #include "MainWindow.h"
+#include "MemoryAccounting.h"
 #include "Palette.h"
+#include "PatternMimeData.h"
 #include "Preview.h"
+#include "Rasterizer.h"
 #include "Scale.h"
 #include "SchemeManager.h"
 #include "TextToolDlg.h"
+#include "Trace.h"
 #include "XKeyLock.h"
 
 
@@ -102,7 +105,7 @@ const Editor::toolCleanupCallPointer Editor::toolCleanupCallPointers[] = {
     &Editor::toolCleanupSelect,     // Select
     0,                              // Backstitch
     0,                              // Color Picker
-    0,                              // Paste
+    &Editor::toolCleanupPaste,      // Paste
     &Editor::toolCleanupMirror,     // Mirror
     &Editor::toolCleanupRotate      // Rotate
 };
@@ -209,6 +212,16 @@ Editor::Editor(QWidget *parent)
     setAcceptDrops(true);
     setFocusPolicy(Qt::StrongFocus);
     setMouseTracking(true);
+
+    MemoryAccounting::add(this, i18n("Views"), i18n("Editor cache"), [this]() {
+        return MemoryAccounting::imageUsage(m_cachedContents) + MemoryAccounting::imageUsage(m_pasteImage);
+    });
+}
+
+
+Editor::~Editor()
+{
+    MemoryAccounting::remove(this);
 }
 
 
@@ -266,6 +279,8 @@ void Editor::readDocumentSettings()
     m_renderer.setCellGrouping(m_cellHorizontalGrouping, m_cellVerticalGrouping);
     m_renderer.setGridLineWidths(Configuration::editor_ThinLineWidth(), Configuration::editor_ThickLineWidth());
     m_renderer.setGridLineColors(m_document->property(QStringLiteral("thinLineColor")).value<QColor>(), m_document->property(QStringLiteral("thickLineColor")).value<QColor>());
+    m_renderer.setLevelOfDetail(Configuration::renderer_SimplifiedStitchesCellSize(), Configuration::renderer_SimplifiedGridCellSize());
+    m_renderer.setMultithreaded(Configuration::renderer_Multithreaded());
 
     zoom(m_zoomFactor);
 
@@ -285,12 +300,23 @@ void Editor::drawContents(const QPoint &cell)
 }
 
 
-void Editor::drawContents(const QRect &cells)
+void Editor::drawContents(const QRect &area)
 {
     if (!updatesEnabled() || (m_document == nullptr) || m_cachedContents.isNull()) {
         return;
     }
 
+    QRect cells = area & visibleCells();    // cells that are scrolled into view later are drawn by moveEvent
+
+    if (cells.isEmpty()) {
+        return;
+    }
+
+    TraceScope trace("editor", "Editor::drawContents");
+    trace.addArgument("cells", cells.width() * cells.height());
+
+    m_pasteImage = QImage();    // render settings may have changed
+
     QPainter painter(&m_cachedContents);
     painter.setRenderHint(QPainter::Antialiasing, true);
     painter.setCompositionMode(QPainter::CompositionMode_Source);
@@ -312,7 +338,7 @@ void Editor::drawContents(const QRect &cells)
 
     painter.end();
 
-    update();
+    update(rectToContents(cells).adjusted(-2, -2, 2, 2));
 }
 
 
@@ -393,6 +419,18 @@ bool Editor::zoom(double factor)
 }
 
 
+double Editor::zoomFactor() const
+{
+    return m_zoomFactor;
+}
+
+
+void Editor::setZoomFactor(double factor)
+{
+    zoom(factor);
+}
+
+
 void Editor::zoomIn()
 {
     zoom(m_zoomFactor * 1.2);
@@ -481,18 +519,11 @@ void Editor::editCut()
 
 void Editor::editCopy()
 {
-    Pattern *pattern = m_document->pattern()->copy(m_selectionArea, (m_maskColor) ? m_document->pattern()->palette().currentIndex() : -1, maskStitches(), m_maskBackstitch, m_maskKnot);
+    QSharedPointer<Pattern> pattern(m_document->pattern()->copy(m_selectionArea, (m_maskColor) ? m_document->pattern()->palette().currentIndex() : -1, maskStitches(), m_maskBackstitch, m_maskKnot));
 
     toolCleanupSelect();
 
-    QByteArray data;
-    QDataStream stream(&data, QIODevice::WriteOnly);
-    stream << *pattern;
-
-    QMimeData *mimeData = new QMimeData();
-    mimeData->setData(QStringLiteral("application/kxstitch"), data);
-
-    QApplication::clipboard()->setMimeData(mimeData);
+    QApplication::clipboard()->setMimeData(new PatternMimeData(pattern));
 
     update();
 }
@@ -500,12 +531,12 @@ void Editor::editCopy()
 
 void Editor::editPaste()
 {
-    m_pasteData = QApplication::clipboard()->mimeData()->data(QStringLiteral("application/kxstitch"));
-    m_pastePattern = new Pattern;
-    QDataStream stream(&m_pasteData, QIODevice::ReadOnly);
-    stream >> *m_pastePattern;
+    m_clipboardPattern = PatternMimeData::fromMimeData(QApplication::clipboard()->mimeData());
 
-    pastePattern(ToolPaste);
+    if (m_clipboardPattern) {
+        m_pastePattern = m_clipboardPattern.data();
+        pastePattern(ToolPaste);
+    }
 }
 
 
@@ -521,6 +552,8 @@ void Editor::pastePattern(ToolMode toolMode)
         m_cellStart = m_cellTracking = m_cellEnd = contentsToCell(pos);
     }
 
+    m_pasteImage = QImage();
+
     update();
 }
 
@@ -529,8 +562,7 @@ void Editor::mirrorSelection()
 {
     m_orientation = static_cast<Qt::Orientation>(qobject_cast<QAction *>(sender())->data().toInt());
 
-    QDataStream stream(&m_pasteData, QIODevice::WriteOnly);
-    stream << m_document->pattern()->stitches();
+    m_pasteData = m_document->pattern()->stitches().saveArea(QList<QRect>() << m_selectionArea);
 
     if (m_makesCopies) {
         m_pastePattern = m_document->pattern()->copy(m_selectionArea, (m_maskColor) ? m_document->pattern()->palette().currentIndex() : -1, maskStitches(), m_maskBackstitch, m_maskKnot);
@@ -549,8 +581,7 @@ void Editor::rotateSelection()
 {
     m_rotation = static_cast<StitchData::Rotation>(qobject_cast<QAction *>(sender())->data().toInt());
 
-    QDataStream stream(&m_pasteData, QIODevice::WriteOnly);
-    stream << m_document->pattern()->stitches();
+    m_pasteData = m_document->pattern()->stitches().saveArea(QList<QRect>() << m_selectionArea);
 
     if (m_makesCopies) {
         m_pastePattern = m_document->pattern()->copy(m_selectionArea, (m_maskColor) ? m_document->pattern()->palette().currentIndex() : -1, maskStitches(), m_maskBackstitch, m_maskKnot);
@@ -783,13 +814,12 @@ void Editor::dragLeaveEvent(QDragLeaveEvent*)
 
 void Editor::dropEvent(QDropEvent *e)
 {
-    m_pasteData = e->mimeData()->data(QStringLiteral("application/kxstitch"));
-    m_pastePattern = new Pattern;
-    QDataStream stream(&m_pasteData, QIODevice::ReadOnly);
-    stream >> *m_pastePattern;
-    m_document->undoStack().push(new EditPasteCommand(m_document, m_pastePattern, contentsToCell(e->pos()), e->keyboardModifiers() & Qt::ShiftModifier, i18n("Drag")));
-    m_pastePattern = nullptr;
-    m_pasteData.clear();
+    QSharedPointer<Pattern> pattern = PatternMimeData::fromMimeData(e->mimeData());
+
+    if (pattern) {
+        m_document->undoStack().push(new EditPasteCommand(m_document, pattern, contentsToCell(e->pos()), e->keyboardModifiers() & Qt::ShiftModifier, i18n("Drag")));
+    }
+
     e->accept();
 }
 
@@ -968,9 +998,9 @@ void Editor::keyPressPaste(QKeyEvent *e)
     switch (e->key()) {
     case Qt::Key_Return:
     case Qt::Key_Enter:
-        m_document->undoStack().push(new EditPasteCommand(m_document, m_pastePattern, m_cellEnd, (e->modifiers() & Qt::ShiftModifier), i18n("Paste")));
+        m_document->undoStack().push(new EditPasteCommand(m_document, m_clipboardPattern, m_cellEnd, (e->modifiers() & Qt::ShiftModifier), i18n("Paste")));
         m_pastePattern = nullptr;
-        m_pasteData.clear();
+        m_clipboardPattern.clear();
         e->accept();
         selectTool(m_oldToolMode);
         break;
@@ -987,9 +1017,10 @@ void Editor::keyPressMirror(QKeyEvent *e)
     switch (e->key()) {
     case Qt::Key_Return:
     case Qt::Key_Enter:
-        m_document->undoStack().push(new MirrorSelectionCommand(m_document, m_selectionArea, (m_maskColor) ? m_document->pattern()->palette().currentIndex() : -1, maskStitches(), m_maskBackstitch, m_maskKnot, m_orientation, m_makesCopies, m_pasteData, m_pastePattern, m_cellEnd, (e->modifiers() & Qt::ShiftModifier)));
-        m_pastePattern = nullptr;
+        m_document->pattern()->stitches().restoreArea(m_pasteData); // the command repeats the cut
         m_pasteData.clear();
+        m_document->undoStack().push(new MirrorSelectionCommand(m_document, m_selectionArea, (m_maskColor) ? m_document->pattern()->palette().currentIndex() : -1, maskStitches(), m_maskBackstitch, m_maskKnot, m_orientation, m_makesCopies, m_pastePattern, m_cellEnd, (e->modifiers() & Qt::ShiftModifier)));
+        m_pastePattern = nullptr;
         e->accept();
         selectTool(m_oldToolMode);
         break;
@@ -1006,9 +1037,10 @@ void Editor::keyPressRotate(QKeyEvent *e)
     switch (e->key()) {
     case Qt::Key_Return:
     case Qt::Key_Enter:
-        m_document->undoStack().push(new RotateSelectionCommand(m_document, m_selectionArea, (m_maskColor) ? m_document->pattern()->palette().currentIndex() : -1, maskStitches(), m_maskBackstitch, m_maskKnot, m_rotation, m_makesCopies, m_pasteData, m_pastePattern, m_cellEnd, (e->modifiers() & Qt::ShiftModifier)));
-        m_pastePattern = nullptr;
+        m_document->pattern()->stitches().restoreArea(m_pasteData); // the command repeats the cut
         m_pasteData.clear();
+        m_document->undoStack().push(new RotateSelectionCommand(m_document, m_selectionArea, (m_maskColor) ? m_document->pattern()->palette().currentIndex() : -1, maskStitches(), m_maskBackstitch, m_maskKnot, m_rotation, m_makesCopies, m_pastePattern, m_cellEnd, (e->modifiers() & Qt::ShiftModifier)));
+        m_pastePattern = nullptr;
         e->accept();
         selectTool(m_oldToolMode);
         break;
@@ -1099,19 +1131,13 @@ void Editor::toolInitText()
         m_pastePattern->palette().add(currentIndex, new DocumentFloss(m_document->pattern()->palette().currentFloss()));
         m_pastePattern->stitches().resize(image.width(), image.height());
 
-        int stitchesAdded = 0;
+        Rasterizer rasterizer(image.rect());
+        rasterizer.addImage(image);
+        QVector<Span> spans = rasterizer.spans();
 
-        for (int row = 0 ; row < image.height() ; ++row) {
-            for (int col = 0 ; col < image.width() ; ++col) {
-                if (image.pixelIndex(col, row) == 1) {
-                    QPoint cell(col, row);
-                    m_pastePattern->stitches().addStitch(cell, Stitch::Full, currentIndex);
-                    ++stitchesAdded;
-                }
-            }
-        }
+        m_pastePattern->stitches().addStitches(spans, Stitch::Full, currentIndex);
 
-        if (stitchesAdded) {
+        if (!spans.isEmpty()) {
             pastePattern(ToolText);
         } else {
             delete m_pastePattern;
@@ -1156,15 +1182,20 @@ void Editor::toolCleanupSelect()
 }
 
 
+void Editor::toolCleanupPaste()
+{
+    m_pastePattern = nullptr;   // owned by m_clipboardPattern
+    m_clipboardPattern.clear();
+}
+
+
 void Editor::toolCleanupMirror()
 {
     delete m_pastePattern;
     m_pastePattern = nullptr;
 
     if (!m_pasteData.isEmpty()) {
-        m_document->pattern()->stitches().clear();
-        QDataStream stream(&m_pasteData, QIODevice::ReadOnly);
-        stream >> m_document->pattern()->stitches();
+        m_document->pattern()->stitches().restoreArea(m_pasteData);
         m_pasteData.clear();
     }
 
@@ -1178,9 +1209,7 @@ void Editor::toolCleanupRotate()
     m_pastePattern = nullptr;
 
     if (!m_pasteData.isEmpty()) {
-        m_document->pattern()->stitches().clear();
-        QDataStream stream(&m_pasteData, QIODevice::ReadOnly);
-        stream >> m_document->pattern()->stitches();
+        m_document->pattern()->stitches().restoreArea(m_pasteData);
         m_pasteData.clear();
     }
 
@@ -1273,6 +1302,10 @@ void Editor::paintEvent(QPaintEvent *e)
     static QPoint oldpos = pos();
     QRect dirtyRect = e->rect();
 
+    TraceScope trace("editor", "Editor::paintEvent");
+    trace.addArgument("width", dirtyRect.width());
+    trace.addArgument("height", dirtyRect.height());
+
     QPainter painter(this);
 
     painter.fillRect(dirtyRect, Qt::white);
@@ -1473,14 +1506,31 @@ void Editor::renderPasteImage(QPainter *painter, const QRect &)
         QRect outline(0, 0, m_pastePattern->stitches().width(), m_pastePattern->stitches().height());
         painter->drawRect(outline);
 
-        m_renderer.render(painter,
-                           m_pastePattern,  // the pattern data to render
-                           outline,         // update rectangle in cells
-                           false,           // don't render the grid
-                           true,            // render stitches
-                           true,            // render backstitches
-                           true,            // render knots
-                           -1);             // all colors
+        // the pattern is rendered once at the current zoom factor and then drawn at each new position
+        QTransform transform = painter->combinedTransform();
+        QSize imageSize(int(ceil(outline.width() * transform.m11())), int(ceil(outline.height() * transform.m22())));
+
+        if (m_pasteImage.size() != imageSize && !imageSize.isEmpty()) {
+            m_pasteImage = QImage(imageSize, QImage::Format_ARGB32_Premultiplied);
+            m_pasteImage.fill(Qt::transparent);
+
+            QPainter imagePainter(&m_pasteImage);
+            imagePainter.setWindow(outline);
+
+            m_renderer.render(&imagePainter,
+                               m_pastePattern,  // the pattern data to render
+                               outline,         // update rectangle in cells
+                               false,           // don't render the grid
+                               true,            // render stitches
+                               true,            // render backstitches
+                               true,            // render knots
+                               -1);             // all colors
+        }
+
+        QPoint origin = transform.map(QPointF(0, 0)).toPoint();
+        painter->resetTransform();
+        painter->setViewTransformEnabled(false);
+        painter->drawImage(origin, m_pasteImage);
     }
 
     painter->restore();
@@ -1496,7 +1546,6 @@ void Editor::mousePressEvent_Paint(QMouseEvent *e)
         m_activeCommand = new PaintKnotsCommand(m_document);
         new AddKnotCommand(m_document, m_cellStart, m_document->pattern()->palette().currentIndex(), m_activeCommand);
         m_document->undoStack().push(m_activeCommand);
-        drawContents(snapToCells(m_cellStart));
     } else {
         m_cellStart = m_cellTracking = m_cellEnd = contentsToCell(p);
         m_zoneStart = m_zoneTracking = m_zoneEnd = contentsToZone(p);
@@ -1504,7 +1553,6 @@ void Editor::mousePressEvent_Paint(QMouseEvent *e)
         m_activeCommand = new PaintStitchesCommand(m_document);
         new AddStitchCommand(m_document, m_cellStart, stitchType, m_document->pattern()->palette().currentIndex(), m_activeCommand);
         m_document->undoStack().push(m_activeCommand);
-        drawContents(m_cellStart);
     }
 }
 
@@ -1520,7 +1568,7 @@ void Editor::mouseMoveEvent_Paint(QMouseEvent *e)
             m_cellStart = m_cellTracking;
             QUndoCommand *cmd = new AddKnotCommand(m_document, m_cellStart, m_document->pattern()->palette().currentIndex(), m_activeCommand);
             cmd->redo();
-            drawContents(snapToCells(m_cellStart));
+            m_document->contentsChanged();
         }
     } else {
         m_cellTracking = contentsToCell(p);
@@ -1532,7 +1580,7 @@ void Editor::mouseMoveEvent_Paint(QMouseEvent *e)
             Stitch::Type stitchType = stitchMap[m_currentStitchType][m_zoneStart];
             QUndoCommand *cmd = new AddStitchCommand(m_document, m_cellStart, stitchType, m_document->pattern()->palette().currentIndex(), m_activeCommand);
             cmd->redo();
-            drawContents(m_cellStart);
+            m_document->contentsChanged();
         }
     }
 }
@@ -1541,7 +1589,6 @@ void Editor::mouseMoveEvent_Paint(QMouseEvent *e)
 void Editor::mouseReleaseEvent_Paint(QMouseEvent*)
 {
     m_activeCommand = nullptr;
-    m_preview->drawContents();
 }
 
 
@@ -1567,31 +1614,17 @@ void Editor::mouseMoveEvent_Draw(QMouseEvent *e)
 
 void Editor::mouseReleaseEvent_Draw(QMouseEvent*)
 {
-    int bitmapWidth = m_document->pattern()->stitches().width();
-    int bitmapHeight = m_document->pattern()->stitches().height();
-    bool useFractionals = Configuration::toolShapes_UseFractionals();
-
-    if (useFractionals) {
-        bitmapWidth *= 2;
-        bitmapHeight *= 2;
+    if (Configuration::toolShapes_UseFractionals()) {
         m_cellStart *= 2;
         m_cellEnd *= 2;
     }
 
     if (m_cellStart != m_cellEnd) {
-        QBitmap canvas(bitmapWidth, bitmapHeight);
-        QPainter painter;
-
-        canvas.fill(Qt::color0);
-        painter.begin(&canvas);
-        painter.setRenderHint(QPainter::Antialiasing, false);
-        painter.setRenderHint(QPainter::Qt4CompatiblePainting, true);
-        painter.setPen(QPen(Qt::color1));
-        painter.drawLine(m_cellStart, m_cellEnd);
-        painter.end();
+        Rasterizer rasterizer(shapeBounds());
+        rasterizer.drawLine(m_cellStart, m_cellEnd);
 
         QUndoCommand *cmd = new DrawLineCommand(m_document);
-        processBitmap(cmd, canvas);
+        processSpans(cmd, rasterizer.spans());
 
         m_document->undoStack().push(cmd);
     }
@@ -1620,7 +1653,7 @@ void Editor::mousePressEvent_Erase(QMouseEvent *e)
             if (Knot *knot = m_document->pattern()->stitches().findKnot(m_cellStart, (m_maskColor) ? m_document->pattern()->palette().currentIndex() : -1)) {
                 cmd = new DeleteKnotCommand(m_document, knot->position, knot->colorIndex, m_activeCommand);
                 cmd->redo();
-                drawContents(snapToCells(m_cellStart));
+                m_document->contentsChanged();
             }
         } else {
             m_cellStart = m_cellTracking = m_cellEnd = contentsToCell(p);
@@ -1629,7 +1662,7 @@ void Editor::mousePressEvent_Erase(QMouseEvent *e)
             if (Stitch *stitch = m_document->pattern()->stitches().findStitch(m_cellStart, m_maskStitch ? stitchMap[m_currentStitchType][m_zoneStart] : Stitch::Delete, m_maskColor ? m_document->pattern()->palette().currentIndex() : -1)) {
                 cmd = new DeleteStitchCommand(m_document, m_cellStart, m_maskStitch ? stitchMap[m_currentStitchType][m_zoneStart] : Stitch::Delete, stitch->colorIndex, m_activeCommand);
                 cmd->redo();
-                drawContents(cellToRect(m_cellStart).adjusted(-1, -1, 1, 1));
+                m_document->contentsChanged();
             }
         }
     }
@@ -1656,7 +1689,7 @@ void Editor::mouseMoveEvent_Erase(QMouseEvent *e)
                 if (Knot *knot = m_document->pattern()->stitches().findKnot(m_cellStart, (m_maskColor) ? m_document->pattern()->palette().currentIndex() : -1)) {
                     cmd = new DeleteKnotCommand(m_document, knot->position, knot->colorIndex, m_activeCommand);
                     cmd->redo();
-                    drawContents(snapToCells(m_cellStart));
+                    m_document->contentsChanged();
                 }
             }
         } else {
@@ -1670,7 +1703,7 @@ void Editor::mouseMoveEvent_Erase(QMouseEvent *e)
                 if (Stitch *stitch = m_document->pattern()->stitches().findStitch(m_cellStart, m_maskStitch ? stitchMap[m_currentStitchType][m_zoneStart] : Stitch::Delete, m_maskColor ? m_document->pattern()->palette().currentIndex() : -1)) {
                     cmd = new DeleteStitchCommand(m_document, m_cellStart, m_maskStitch ? stitchMap[m_currentStitchType][m_zoneStart] : Stitch::Delete, stitch->colorIndex, m_activeCommand);
                     cmd->redo();
-                    drawContents(cellToRect(m_cellStart).adjusted(-1, -1, 1, 1));
+                    m_document->contentsChanged();
                 }
             }
         }
@@ -1805,31 +1838,17 @@ void Editor::mouseMoveEvent_Ellipse(QMouseEvent *e)
 
 void Editor::mouseReleaseEvent_Ellipse(QMouseEvent*)
 {
-    int bitmapWidth = m_document->pattern()->stitches().width();
-    int bitmapHeight = m_document->pattern()->stitches().height();
-    bool useFractionals = Configuration::toolShapes_UseFractionals();
-
-    if (useFractionals) {
-        bitmapWidth *= 2;
-        bitmapHeight *= 2;
+    if (Configuration::toolShapes_UseFractionals()) {
         m_cellStart *= 2;
         m_cellEnd *= 2;
     }
 
     if (m_cellStart != m_cellEnd) {
-        QBitmap canvas(bitmapWidth, bitmapHeight);
-        QPainter painter;
-
-        canvas.fill(Qt::color0);
-        painter.begin(&canvas);
-        painter.setRenderHint(QPainter::Antialiasing, !Configuration::toolShapes_UseFractionals());
-        painter.setPen(QPen(Qt::color1));
-        painter.setBrush(Qt::NoBrush);
-        painter.drawEllipse(m_rubberBand);
-        painter.end();
+        Rasterizer rasterizer(shapeBounds());
+        rasterizer.drawEllipse(QRect(m_cellStart, m_cellEnd).normalized());
 
         QUndoCommand *cmd = new DrawEllipseCommand(m_document);
-        processBitmap(cmd, canvas);
+        processSpans(cmd, rasterizer.spans());
 
         m_document->undoStack().push(cmd);
     }
@@ -1860,31 +1879,17 @@ void Editor::mouseMoveEvent_FillEllipse(QMouseEvent *e)
 
 void Editor::mouseReleaseEvent_FillEllipse(QMouseEvent*)
 {
-    int bitmapWidth = m_document->pattern()->stitches().width();
-    int bitmapHeight = m_document->pattern()->stitches().height();
-    bool useFractionals = Configuration::toolShapes_UseFractionals();
-
-    if (useFractionals) {
-        bitmapWidth *= 2;
-        bitmapHeight *= 2;
+    if (Configuration::toolShapes_UseFractionals()) {
         m_cellStart *= 2;
         m_cellEnd *= 2;
     }
 
     if (m_cellStart != m_cellEnd) {
-        QBitmap canvas(bitmapWidth, bitmapHeight);
-        QPainter painter;
-
-        canvas.fill(Qt::color0);
-        painter.begin(&canvas);
-        painter.setRenderHint(QPainter::Antialiasing, !useFractionals);
-        painter.setPen(QPen(Qt::color1));
-        painter.setBrush(Qt::color1);
-        painter.drawEllipse(QRect(m_cellStart, m_cellEnd).normalized());
-        painter.end();
+        Rasterizer rasterizer(shapeBounds());
+        rasterizer.fillEllipse(QRect(m_cellStart, m_cellEnd).normalized());
 
         QUndoCommand *cmd = new FillEllipseCommand(m_document);
-        processBitmap(cmd, canvas);
+        processSpans(cmd, rasterizer.spans());
 
         m_document->undoStack().push(cmd);
     }
@@ -1916,13 +1921,7 @@ void Editor::mouseMoveEvent_FillPolygon(QMouseEvent *e)
 
 void Editor::mouseReleaseEvent_FillPolygon(QMouseEvent *e)
 {
-    int bitmapWidth = m_document->pattern()->stitches().width();
-    int bitmapHeight = m_document->pattern()->stitches().height();
-    bool useFractionals = Configuration::toolShapes_UseFractionals();
-
-    if (useFractionals) {
-        bitmapWidth *= 2;
-        bitmapHeight *= 2;
+    if (Configuration::toolShapes_UseFractionals()) {
         m_cellStart *= 2;
         m_cellEnd *= 2;
     }
@@ -1930,26 +1929,17 @@ void Editor::mouseReleaseEvent_FillPolygon(QMouseEvent *e)
     m_cellEnd = contentsToCell(e->pos());
 
     if ((m_cellEnd == m_polygon.point(0)) && (m_polygon.count() > 2)) {
-        QBitmap canvas(bitmapWidth, bitmapHeight);
-        QPainter painter;
-
-        if (useFractionals) {
+        if (Configuration::toolShapes_UseFractionals()) {
             for (int i = 0 ; i < m_polygon.size() ; ++i) {
                 m_polygon[i] *= 2;
             }
         }
 
-        canvas.fill(Qt::color0);
-        painter.begin(&canvas);
-        painter.setRenderHint(QPainter::Antialiasing, false);
-        painter.setRenderHint(QPainter::Qt4CompatiblePainting, true);
-        painter.setPen(QPen(Qt::color1));
-        painter.setBrush(Qt::color1);
-        painter.drawPolygon(m_polygon);
-        painter.end();
+        Rasterizer rasterizer(shapeBounds());
+        rasterizer.fillPolygon(m_polygon);
 
         QUndoCommand *cmd = new FillPolygonCommand(m_document);
-        processBitmap(cmd, canvas);
+        processSpans(cmd, rasterizer.spans());
 
         m_document->undoStack().push(cmd);
 
@@ -2137,17 +2127,18 @@ void Editor::mouseMoveEvent_Paste(QMouseEvent *e)
     m_cellTracking = contentsToCell(p) - m_pasteOffset;
 
     if (m_cellTracking != m_cellEnd) {
+        update(pasteImageRect(m_cellEnd));
         m_cellEnd = m_cellTracking;
-        update();
+        update(pasteImageRect(m_cellEnd));
     }
 }
 
 
 void Editor::mouseReleaseEvent_Paste(QMouseEvent *e)
 {
-    m_document->undoStack().push(new EditPasteCommand(m_document, m_pastePattern, contentsToCell(e->pos()) - m_pasteOffset, (e->modifiers() & Qt::ShiftModifier), i18n("Paste")));
-    m_pasteData.clear();
+    m_document->undoStack().push(new EditPasteCommand(m_document, m_clipboardPattern, contentsToCell(e->pos()) - m_pasteOffset, (e->modifiers() & Qt::ShiftModifier), i18n("Paste")));
     m_pastePattern = nullptr;
+    m_clipboardPattern.clear();
     setCursor(Qt::ArrowCursor);
     selectTool(m_oldToolMode);
 }
@@ -2167,8 +2158,9 @@ void Editor::mouseMoveEvent_Mirror(QMouseEvent *e)
 
 void Editor::mouseReleaseEvent_Mirror(QMouseEvent *e)
 {
-    m_document->undoStack().push(new MirrorSelectionCommand(m_document, m_selectionArea, (m_maskColor) ? m_document->pattern()->palette().currentIndex() : -1, maskStitches(), m_maskBackstitch, m_maskKnot, m_orientation, m_makesCopies, m_pasteData, m_pastePattern, contentsToCell(e->pos()) - m_pasteOffset, (e->modifiers() & Qt::ShiftModifier)));
+    m_document->pattern()->stitches().restoreArea(m_pasteData); // the command repeats the cut
     m_pasteData.clear();
+    m_document->undoStack().push(new MirrorSelectionCommand(m_document, m_selectionArea, (m_maskColor) ? m_document->pattern()->palette().currentIndex() : -1, maskStitches(), m_maskBackstitch, m_maskKnot, m_orientation, m_makesCopies, m_pastePattern, contentsToCell(e->pos()) - m_pasteOffset, (e->modifiers() & Qt::ShiftModifier)));
     m_pastePattern = nullptr;
     setCursor(Qt::ArrowCursor);
     selectTool(m_oldToolMode);
@@ -2189,9 +2181,10 @@ void Editor::mouseMoveEvent_Rotate(QMouseEvent *e)
 
 void Editor::mouseReleaseEvent_Rotate(QMouseEvent *e)
 {
-    m_document->undoStack().push(new RotateSelectionCommand(m_document, m_selectionArea, (m_maskColor) ? m_document->pattern()->palette().currentIndex() : -1, maskStitches(), m_maskBackstitch, m_maskKnot, m_rotation, m_makesCopies, m_pasteData, m_pastePattern, contentsToCell(e->pos()) - m_pasteOffset, (e->modifiers() & Qt::ShiftModifier)));
-    m_pastePattern = nullptr;
+    m_document->pattern()->stitches().restoreArea(m_pasteData); // the command repeats the cut
     m_pasteData.clear();
+    m_document->undoStack().push(new RotateSelectionCommand(m_document, m_selectionArea, (m_maskColor) ? m_document->pattern()->palette().currentIndex() : -1, maskStitches(), m_maskBackstitch, m_maskKnot, m_rotation, m_makesCopies, m_pastePattern, contentsToCell(e->pos()) - m_pasteOffset, (e->modifiers() & Qt::ShiftModifier)));
+    m_pastePattern = nullptr;
     setCursor(Qt::ArrowCursor);
     selectTool(m_oldToolMode);
 }
@@ -2250,20 +2243,74 @@ QRect Editor::rectToContents(const QRect &rect) const
 }
 
 
-void Editor::processBitmap(QUndoCommand *parent, const QBitmap &canvas)
+/**
+    Get the area that the shape tools can draw in.
+    This is the pattern size in cells, or in half cells if fractionals are being used.
+    @return a QRect of the drawable area
+    */
+QRect Editor::shapeBounds() const
+{
+    int width = m_document->pattern()->stitches().width();
+    int height = m_document->pattern()->stitches().height();
+
+    if (Configuration::toolShapes_UseFractionals()) {
+        width *= 2;
+        height *= 2;
+    }
+
+    return QRect(0, 0, width, height);
+}
+
+
+/**
+    Get the area of the widget covered by the paste image and its outline.
+    @param cell the cell at the top left of the paste pattern
+    @return a QRect in widget coordinates, this includes a margin for rounding and the outline pen
+    */
+QRect Editor::pasteImageRect(const QPoint &cell) const
+{
+    if (m_pastePattern == nullptr) {
+        return rect();
+    }
+
+    QRect cells(cell, QSize(m_pastePattern->stitches().width(), m_pastePattern->stitches().height()));
+
+    return rectToContents(cells).adjusted(-2, -2, 2, 2);
+}
+
+
+/**
+    Add stitches for the spans generated by one of the shape tools.
+    @param parent the command that the AddStitchCommands will be added to
+    @param spans a QVector of Span in cells, or half cells if fractionals are being used
+    */
+void Editor::processSpans(QUndoCommand *parent, const QVector<Span> &spans)
 {
-    QImage image = canvas.toImage();
     int colorIndex = m_document->pattern()->palette().currentIndex();
+    bool useFractionals = Configuration::toolShapes_UseFractionals();
+
+    foreach (const Span &span, spans) {
+        if (useFractionals) {
+            // both quarters of a cell covered by the span are added with a single command
+            int row = span.row / 2;
+            int zone = (span.row % 2) * 2;
+
+            for (int column = span.left / 2 ; column <= span.right / 2 ; ++column) {
+                int type = 0;
 
-    for (int y = 0 ; y < image.height() ; y++) {
-        for (int x = 0 ; x < image.width() ; x++) {
-            if (image.pixelIndex(x, y) == 1) {
-                if (Configuration::toolShapes_UseFractionals()) {
-                    int zone = (y % 2) * 2 + (x % 2);
-                    new AddStitchCommand(m_document, QPoint(x / 2, y / 2), stitchMap[0][zone], colorIndex, parent);
-                } else {
-                    new AddStitchCommand(m_document, QPoint(x, y), Stitch::Full, colorIndex, parent);
+                if (column * 2 >= span.left) {
+                    type |= stitchMap[0][zone];
                 }
+
+                if (column * 2 + 1 <= span.right) {
+                    type |= stitchMap[0][zone + 1];
+                }
+
+                new AddStitchCommand(m_document, QPoint(column, row), static_cast<Stitch::Type>(type), colorIndex, parent);
+            }
+        } else {
+            for (int column = span.left ; column <= span.right ; ++column) {
+                new AddStitchCommand(m_document, QPoint(column, span.row), Stitch::Full, colorIndex, parent);
             }
         }
     }
@@ -13,6 +13,7 @@
 #define Editor_H
 
 
+#include <QSharedPointer>
 #include <QStack>
 #include <QWidget>
 
@@ -31,6 +32,7 @@ class Pattern;
 class Preview;
 class Renderer;
 class Scale;
+class Span;
 
 
 class Editor : public QWidget
@@ -68,7 +70,7 @@ public:
     };
 
     explicit Editor(QWidget*);
-    virtual ~Editor() = default;
+    virtual ~Editor();
 
     void setDocument(Document*);
     Document *document();
@@ -77,6 +79,9 @@ public:
 
     void readDocumentSettings();
 
+    double zoomFactor() const;
+    void setZoomFactor(double);
+
     Scale *horizontalScale();
     Scale *verticalScale();
 
@@ -177,6 +182,7 @@ private:
     void toolCleanupPolygon();
     void toolCleanupAlphabet();
     void toolCleanupSelect();
+    void toolCleanupPaste();
     void toolCleanupMirror();
     void toolCleanupRotate();
 
@@ -264,7 +270,9 @@ private:
     QRect polygonToCells(const QPolygon&) const;
     QRect rectToContents(const QRect&) const;
 
-    void processBitmap(QUndoCommand*, const QBitmap&);
+    QRect shapeBounds() const;
+    QRect pasteImageRect(const QPoint&) const;
+    void processSpans(QUndoCommand*, const QVector<Span>&);
     QRect visibleCells();
     QList<Stitch::Type> maskStitches() const;
 
@@ -331,8 +339,10 @@ private:
 
     QByteArray  m_pasteData;
     Pattern     *m_pastePattern;
+    QSharedPointer<Pattern> m_clipboardPattern;
 
     QImage      m_cachedContents;
+    QImage      m_pasteImage;
 
     QStack<QPoint>  m_cursorStack;
     QMap<int, int>  m_cursorCommands;
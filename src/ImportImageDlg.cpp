@@ -23,6 +23,7 @@
 #include "SchemeManager.h"
 #include "SymbolManager.h"
 #include "SymbolLibrary.h"
+#include "Trace.h"
 
 
 const uchar alphaData[] = {
@@ -356,6 +357,8 @@ void ImportImageDlg::calculateSizes()
 
 void ImportImageDlg::createImageMap()
 {
+    TraceScope trace("import", "ImportImageDlg::createImageMap");
+
     FlossScheme *scheme = SchemeManager::scheme(ui.FlossScheme->currentText());
     m_colorMap = *(scheme->createImageMap());
 }
@@ -363,6 +366,8 @@ void ImportImageDlg::createImageMap()
 
 void ImportImageDlg::renderPixmap()
 {
+    TraceScope trace("import", "ImportImageDlg::renderPixmap");
+
     QPixmap alpha;
     alpha.loadFromData(alphaData, 143);
 
@@ -387,6 +392,8 @@ void ImportImageDlg::renderPixmap()
     int width = m_convertedImage.columns();
     int height = m_convertedImage.rows();
     int pixelCount = width * height;
+    trace.addArgument("width", width);
+    trace.addArgument("height", height);
 
     QProgressDialog progress(i18n("Rendering preview"), i18n("Cancel"), 0, pixelCount, this);
     progress.setWindowModality(Qt::WindowModal);
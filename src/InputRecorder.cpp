@@ -0,0 +1,443 @@
+/*
+ * Copyright (C) 2026 by agent
+ * agent@local
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+/**
+    @file
+    Implement the InputRecorder class used to record an editing session so it
+    can be replayed to measure the latency of the editor.
+    A recording starts with the window size, the zoom factor, the state of the
+    checkable editing actions and the document as it was saved by
+    Document::write. This is followed by the mouse, wheel and key events sent
+    to the editor and the editing actions triggered, each with the time it
+    was received, the current palette index and the scroll bar positions.
+    Actions that open dialogs, such as the file and palette actions, are not
+    recorded since they can not be replayed without user interaction.
+    */
+
+
+#include "InputRecorder.h"
+
+#include <QAction>
+#include <QApplication>
+#include <QClipboard>
+#include <QDebug>
+#include <QKeyEvent>
+#include <QMimeData>
+#include <QMouseEvent>
+#include <QScrollArea>
+#include <QScrollBar>
+#include <QWheelEvent>
+
+#include <KActionCollection>
+#include <KLocalizedString>
+
+#include <cstring>
+
+#include "Document.h"
+#include "Editor.h"
+#include "Exceptions.h"
+#include "MainWindow.h"
+
+
+const char *replayableActions[] = {
+    "edit_",
+    "makesCopies",
+    "mirror",
+    "rotate",
+    "mask",
+    "view_",
+    "stitch",
+    "tool",
+    "render",
+    "colorHighlight",
+    "formatScalesAs"
+};
+
+
+/**
+    Constructor.
+    */
+RecordedEvent::RecordedEvent()
+    :   time(0),
+        target(TargetEditor),
+        type(QEvent::None),
+        button(Qt::NoButton),
+        buttons(Qt::NoButton),
+        modifiers(Qt::NoModifier),
+        key(0),
+        autoRepeat(false),
+        checked(false),
+        colorIndex(-1)
+{
+}
+
+
+/**
+    Create the input event to be sent when replaying.
+    @return a pointer to the new QEvent, the caller takes ownership, or nullptr
+    if this is a triggered action
+    */
+QEvent *RecordedEvent::createEvent() const
+{
+    switch (type) {
+    case QEvent::MouseButtonPress:
+    case QEvent::MouseButtonRelease:
+    case QEvent::MouseButtonDblClick:
+    case QEvent::MouseMove:
+        return new QMouseEvent(static_cast<QEvent::Type>(type), QPointF(position), static_cast<Qt::MouseButton>(button), Qt::MouseButtons(QFlag(buttons)), Qt::KeyboardModifiers(QFlag(modifiers)));
+
+    case QEvent::Wheel:
+        return new QWheelEvent(QPointF(position), QPointF(position), QPoint(), angleDelta, angleDelta.y(), Qt::Vertical, Qt::MouseButtons(QFlag(buttons)), Qt::KeyboardModifiers(QFlag(modifiers)));
+
+    case QEvent::KeyPress:
+    case QEvent::KeyRelease:
+        return new QKeyEvent(static_cast<QEvent::Type>(type), key, Qt::KeyboardModifiers(QFlag(modifiers)), text, autoRepeat);
+
+    default:
+        return nullptr;
+    }
+}
+
+
+/**
+    Stream out a RecordedEvent.
+    @param stream a reference to the QDataStream to write to
+    @param event a const reference to the RecordedEvent
+    @return a reference to the QDataStream
+    */
+QDataStream &operator<<(QDataStream &stream, const RecordedEvent &event)
+{
+    stream << qint32(event.version);
+    stream << event.time;
+    stream << event.target;
+    stream << event.type;
+    stream << event.position;
+    stream << event.button;
+    stream << event.buttons;
+    stream << event.modifiers;
+    stream << event.key;
+    stream << event.text;
+    stream << event.autoRepeat;
+    stream << event.angleDelta;
+    stream << event.action;
+    stream << event.checked;
+    stream << event.clipboard;
+    stream << event.colorIndex;
+    stream << event.scrollPosition;
+
+    return stream;
+}
+
+
+/**
+    Stream in a RecordedEvent.
+    @param stream a reference to the QDataStream to read from
+    @param event a reference to the RecordedEvent
+    @return a reference to the QDataStream
+    */
+QDataStream &operator>>(QDataStream &stream, RecordedEvent &event)
+{
+    qint32 version;
+
+    stream >> version;
+
+    switch (version) {
+    case 100:
+        stream >> event.time;
+        stream >> event.target;
+        stream >> event.type;
+        stream >> event.position;
+        stream >> event.button;
+        stream >> event.buttons;
+        stream >> event.modifiers;
+        stream >> event.key;
+        stream >> event.text;
+        stream >> event.autoRepeat;
+        stream >> event.angleDelta;
+        stream >> event.action;
+        stream >> event.checked;
+        stream >> event.clipboard;
+        stream >> event.colorIndex;
+        stream >> event.scrollPosition;
+        break;
+
+    default:
+        throw InvalidFileVersion(QString(i18n("Recorded event version %1", version)));
+        break;
+    }
+
+    return stream;
+}
+
+
+/**
+    Constructor.
+    */
+InputRecording::InputRecording()
+    :   zoomFactor(1.0)
+{
+}
+
+
+/**
+    Read a recording from a file.
+    A recording that was not closed cleanly, for example because the application
+    crashed, is read up to the last complete event.
+    @param fileName the name of the file to read
+    */
+void InputRecording::read(const QString &fileName)
+{
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        throw FailedReadFile(file.errorString());
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    char header[13];
+
+    if ((stream.readRawData(header, 13) != 13) || (strncmp(header, "KXStitchInput", 13) != 0)) {
+        throw InvalidFile();
+    }
+
+    qint32 fileVersion;
+    stream >> fileVersion;
+
+    switch (fileVersion) {
+    case 100:
+        stream >> windowSize;
+        stream >> zoomFactor;
+        stream >> actionStates;
+        stream >> document;
+
+        if (stream.status() != QDataStream::Ok) {
+            throw FailedReadFile(stream.status());
+        }
+
+        events.clear();
+
+        while (!stream.atEnd()) {
+            RecordedEvent event;
+            stream >> event;
+
+            if (stream.status() != QDataStream::Ok) {
+                break;
+            }
+
+            events.append(event);
+        }
+
+        break;
+
+    default:
+        throw InvalidFileVersion(QString(i18n("Input recording version %1", fileVersion)));
+        break;
+    }
+}
+
+
+/**
+    Test if an action can be recorded and replayed.
+    @param name the name of the action in the action collection
+    @return true if the action only changes the editor or edits the pattern
+    without opening a dialog, false otherwise
+    */
+bool InputRecording::isReplayable(const QString &name)
+{
+    for (const char *prefix : replayableActions) {
+        if (name.startsWith(QLatin1String(prefix))) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/**
+    Constructor.
+    Opens the recording file and writes the current state of the window and
+    the document. Recording stops when the window is destroyed.
+    @param window a pointer to the MainWindow to record, this becomes the parent
+    @param fileName the name of the file to write the recording to, any existing
+    file will be overwritten
+    */
+InputRecorder::InputRecorder(MainWindow *window, const QString &fileName)
+    :   QObject(window),
+        m_editor(window->editor()),
+        m_scrollArea(dynamic_cast<QScrollArea *>(m_editor->parentWidget()->parentWidget())),
+        m_file(fileName)
+{
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Unable to open the input recording" << fileName;
+        return;
+    }
+
+    QByteArray document;
+    QDataStream documentStream(&document, QIODevice::WriteOnly);
+    m_editor->document()->write(documentStream);
+
+    QMap<QString, bool> actionStates;
+
+    foreach (QAction *action, window->actionCollection()->actions()) {
+        if (InputRecording::isReplayable(action->objectName())) {
+            if (action->isCheckable()) {
+                actionStates.insert(action->objectName(), action->isChecked());
+            }
+
+            connect(action, &QAction::triggered, this, [=](bool checked) {recordAction(action, checked);});
+        }
+    }
+
+    m_stream.setDevice(&m_file);
+    m_stream.setVersion(QDataStream::Qt_5_0);
+    m_stream.writeRawData("KXStitchInput", 13);
+    m_stream << qint32(InputRecording::version);
+    m_stream << window->size();
+    m_stream << m_editor->zoomFactor();
+    m_stream << actionStates;
+    m_stream << document;
+
+    // filters are called in the reverse order of installation, so these see
+    // the wheel events before the editor filter consumes them
+    m_editor->installEventFilter(this);
+    m_scrollArea->installEventFilter(this);
+
+    m_timer.start();
+}
+
+
+/**
+    Destructor.
+    Closes the recording file.
+    */
+InputRecorder::~InputRecorder()
+{
+    m_file.close();
+}
+
+
+/**
+    Test if the recording file was opened.
+    @return true if events are being recorded, false otherwise
+    */
+bool InputRecorder::isRecording() const
+{
+    return m_file.isOpen();
+}
+
+
+/**
+    Record the input events sent to the editor and the wheel events sent to
+    the scroll area, the events are not filtered out.
+    @param object a pointer to the object the event is sent to
+    @param e a pointer to the event
+    @return false to let the event be handled normally
+    */
+bool InputRecorder::eventFilter(QObject *object, QEvent *e)
+{
+    RecordedEvent event;
+    event.target = (object == m_editor) ? RecordedEvent::TargetEditor : RecordedEvent::TargetScrollArea;
+    event.type = e->type();
+
+    switch (e->type()) {
+    case QEvent::MouseButtonPress:
+    case QEvent::MouseButtonRelease:
+    case QEvent::MouseButtonDblClick:
+    case QEvent::MouseMove: {
+        if (object != m_editor) {
+            return false;
+        }
+
+        QMouseEvent *mouseEvent = static_cast<QMouseEvent *>(e);
+        event.position = mouseEvent->pos();
+        event.button = mouseEvent->button();
+        event.buttons = mouseEvent->buttons();
+        event.modifiers = mouseEvent->modifiers();
+        break;
+    }
+
+    case QEvent::Wheel: {
+        QWheelEvent *wheelEvent = static_cast<QWheelEvent *>(e);
+        event.position = wheelEvent->pos();
+        event.buttons = wheelEvent->buttons();
+        event.modifiers = wheelEvent->modifiers();
+        event.angleDelta = wheelEvent->angleDelta();
+        break;
+    }
+
+    case QEvent::KeyPress:
+    case QEvent::KeyRelease: {
+        if (object != m_editor) {
+            return false;
+        }
+
+        QKeyEvent *keyEvent = static_cast<QKeyEvent *>(e);
+        event.key = keyEvent->key();
+        event.modifiers = keyEvent->modifiers();
+        event.text = keyEvent->text();
+        event.autoRepeat = keyEvent->isAutoRepeat();
+        break;
+    }
+
+    default:
+        return false;
+    }
+
+    record(event);
+
+    return false;
+}
+
+
+/**
+    Record a triggered action. When pasting, the pattern on the clipboard is
+    recorded with it.
+    @param action a pointer to the QAction triggered
+    @param checked the new checked state of a checkable action
+    */
+void InputRecorder::recordAction(QAction *action, bool checked)
+{
+    RecordedEvent event;
+    event.target = RecordedEvent::TargetAction;
+    event.action = action->objectName();
+    event.checked = checked;
+
+    if (event.action == QLatin1String("edit_paste")) {
+        const QMimeData *mimeData = QApplication::clipboard()->mimeData();
+
+        if (mimeData) {
+            event.clipboard = mimeData->data(QStringLiteral("application/kxstitch"));
+        }
+    }
+
+    record(event);
+}
+
+
+/**
+    Add the time and the editor state to an event and write it to the recording.
+    @param event a reference to the RecordedEvent
+    */
+void InputRecorder::record(RecordedEvent &event)
+{
+    if (!m_file.isOpen()) {
+        return;
+    }
+
+    event.time = m_timer.nsecsElapsed();
+    event.colorIndex = m_editor->document()->pattern()->palette().currentIndex();
+    event.scrollPosition = QPoint(m_scrollArea->horizontalScrollBar()->value(), m_scrollArea->verticalScrollBar()->value());
+
+    m_stream << event;
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2026 by agent
+ * agent@local
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+#ifndef InputRecorder_H
+#define InputRecorder_H
+
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QPoint>
+#include <QSize>
+#include <QString>
+
+
+class QAction;
+class QEvent;
+class QScrollArea;
+
+class Editor;
+class MainWindow;
+
+
+class RecordedEvent
+{
+public:
+    enum Target {
+        TargetEditor,
+        TargetScrollArea,
+        TargetAction
+    };
+
+    RecordedEvent();
+
+    QEvent *createEvent() const;
+
+    static const int version = 100;
+
+    qint64      time;               // nanoseconds since the recording started
+    qint32      target;
+    qint32      type;               // the QEvent::Type of an input event
+    QPoint      position;
+    qint32      button;
+    qint32      buttons;
+    qint32      modifiers;
+    qint32      key;
+    QString     text;
+    bool        autoRepeat;
+    QPoint      angleDelta;
+    QString     action;             // the name of a triggered action
+    bool        checked;
+    QByteArray  clipboard;          // the pattern on the clipboard when pasting
+    qint32      colorIndex;         // the current palette index before the event
+    QPoint      scrollPosition;     // the scroll bar values before the event
+};
+
+
+QDataStream &operator<<(QDataStream &, const RecordedEvent &);
+QDataStream &operator>>(QDataStream &, RecordedEvent &);
+
+
+class InputRecording
+{
+public:
+    InputRecording();
+
+    void read(const QString &);
+
+    static bool isReplayable(const QString &);
+
+    static const int version = 100;
+
+    QSize                   windowSize;
+    double                  zoomFactor;
+    QMap<QString, bool>     actionStates;
+    QByteArray              document;
+    QList<RecordedEvent>    events;
+};
+
+
+class InputRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    InputRecorder(MainWindow *, const QString &);
+    virtual ~InputRecorder();
+
+    bool isRecording() const;
+
+protected:
+    virtual bool eventFilter(QObject *, QEvent *) Q_DECL_OVERRIDE;
+
+private:
+    void recordAction(QAction *, bool);
+    void record(RecordedEvent &);
+
+    Editor          *m_editor;
+    QScrollArea     *m_scrollArea;
+    QFile           m_file;
+    QDataStream     m_stream;
+    QElapsedTimer   m_timer;
+};
+
+
+#endif // InputRecorder_H
@@ -14,6 +14,7 @@
 #include <QDataStream>
 #include <QFile>
 #include <QFileInfo>
+#include <QMap>
 #include <QProgressDialog>
 
 #include <KLocalizedString>
@@ -22,23 +23,45 @@
 #include <stdlib.h>
 
 #include "LibraryPattern.h"
+#include "MemoryAccounting.h"
 
 
 LibraryFile::LibraryFile(const QString &path)
     :   m_read(false),
-        m_path(path)
+        m_unsupported(false),
+        m_path(path),
+        m_liveBytes(0),
+        m_deadBytes(0)
 {
     m_exists = QFile::exists(localFile());
+
+    MemoryAccounting::add(this, i18n("Libraries"), i18n("Pattern library %1", m_path), [this]() {
+        qint64 usage = MemoryAccounting::heapBlock(sizeof(QListData::Data) + m_libraryPatterns.count() * sizeof(LibraryPattern *));
+
+        foreach (const LibraryPattern *libraryPattern, m_libraryPatterns) {
+            usage += libraryPattern->memoryUsage();
+        }
+
+        return usage;
+    });
 }
 
 
+/**
+    Destructor.
+    The file is compacted if any patterns have had their key or baseline changed, or if more
+    of the file is taken up by deleted patterns than current ones. Files in an unsupported format
+    are left as they are.
+    */
 LibraryFile::~LibraryFile()
 {
-    if (hasChanged()) {
+    if (!m_unsupported && (hasChanged() || m_deadBytes > m_liveBytes)) {
         writeFile();
     }
 
     qDeleteAll(m_libraryPatterns);
+
+    MemoryAccounting::remove(this);
 }
 
 
@@ -54,18 +77,34 @@ bool LibraryFile::isWritable() const
 }
 
 
+/**
+    Add a pattern to the library, the pattern is appended to the end of the file.
+    @param libraryPattern a pointer to the LibraryPattern, the LibraryFile takes ownership
+    */
 void LibraryFile::addPattern(LibraryPattern *libraryPattern)
 {
+    if (!m_read) {
+        readFile();
+    }
+
     m_libraryPatterns.append(libraryPattern);
-    writeFile();
+    appendRecord(PatternRecord, libraryPattern);
 }
 
 
+/**
+    Delete a pattern from the library, a marker is appended to the end of the file to show that
+    the pattern has been deleted.
+    @param libraryPattern a pointer to the LibraryPattern, this will be deleted
+    */
 void LibraryFile::deletePattern(LibraryPattern *libraryPattern)
 {
     if (m_libraryPatterns.removeOne(libraryPattern)) {
+        if (m_records.contains(libraryPattern)) {
+            appendRecord(DeletedRecord, libraryPattern);
+        }
+
         delete libraryPattern;
-        writeFile();
     }
 }
 
@@ -106,9 +145,9 @@ void LibraryFile::readFile()
             QDataStream stream(&file);
             char header[11];
             stream.readRawData(header, 11);
+            qint16 version = LibraryFile::version;
 
             if (strncmp(header, "KXStitchLib", 11) == 0) {
-                qint16 version;
                 qint32 count;
                 qint32 key;         // version 1 of library format
                 qint32 modifier;    // version 1 of library format
@@ -180,15 +219,73 @@ void LibraryFile::readFile()
 
                     break;
 
+                case 102: {
+                    // the records are read up to the pattern data which is skipped, the patterns are
+                    // read from the file when they are needed
+                    QMap<qint64, LibraryPattern *> patterns;
+
+                    while (!file.atEnd() && ok) {
+                        qint64 recordOffset = file.pos();
+                        qint8 type;
+                        qint64 deletedOffset;
+                        qint32 size;
+                        qint32 height;
+                        QString schemeName;
+                        QString symbolLibrary;
+                        stream >> type;
+
+                        if (type == PatternRecord) {
+                            stream >> key >> modifier >> baseline >> height >> schemeName >> symbolLibrary >> size;
+                            qint64 dataOffset = file.pos();
+
+                            if (stream.status() == QDataStream::Ok && size >= 0 && dataOffset + size <= file.size() && file.seek(dataOffset + size)) {
+                                patterns.insert(recordOffset, new LibraryPattern(localFile(), dataOffset, size, height, schemeName, symbolLibrary, key, Qt::KeyboardModifiers(modifier), baseline));
+                                m_records.insert(patterns.value(recordOffset), Record{recordOffset, file.pos() - recordOffset});
+                                m_liveBytes += file.pos() - recordOffset;
+                            } else {
+                                ok = false;
+                            }
+                        } else if (type == DeletedRecord) {
+                            stream >> deletedOffset;
+
+                            if (stream.status() == QDataStream::Ok && patterns.contains(deletedOffset)) {
+                                LibraryPattern *deleted = patterns.take(deletedOffset);
+                                qint64 deletedSize = m_records.take(deleted).size;
+                                m_liveBytes -= deletedSize;
+                                m_deadBytes += deletedSize + file.pos() - recordOffset;
+                                delete deleted;
+                            } else {
+                                ok = false;
+                            }
+                        } else {
+                            ok = false;
+                        }
+                    }
+
+                    if (!ok) {
+                        KMessageBox::error(nullptr, i18n("Failed to read a pattern from the library %1.\n%2", localFile(), file.errorString()), i18n("Failed to read library."));
+                    }
+
+                    m_libraryPatterns.append(patterns.values());
+                    break;
+                }
+
                 default:
-                    // not supported
-                    // throw exception
+                    // not supported, the file is left untouched rather than being replaced by an empty library
+                    ok = false;
+                    m_unsupported = true;
+                    KMessageBox::error(nullptr, i18n("The library %1 uses an unsupported format version %2 and will not be changed.", localFile(), version), i18n("Failed to read library."));
                     break;
                 }
             }
 
             file.close();
             m_read = true;
+
+            // convert older libraries to the current format so they open quickly next time
+            if (ok && version < LibraryFile::version && isWritable()) {
+                writeFile();
+            }
         } else {
             KMessageBox::error(nullptr, i18n("The file %1\ncould not be opened for reading.\n%2", localFile(), file.errorString()), i18n("Error opening file"));
         }
@@ -196,20 +293,50 @@ void LibraryFile::readFile()
 }
 
 
+/**
+    Write the library file.
+    This writes a record for each of the current patterns, removing the records of any deleted
+    patterns and the markers of their deletion. Each record gives the key, modifiers, baseline,
+    height, scheme name, symbol library and size of the pattern followed by the encoded pattern,
+    so that opening a library only needs to read the records up to the pattern data.
+    */
 void LibraryFile::writeFile()
 {
+    if (m_unsupported) {
+        KMessageBox::sorry(nullptr, i18n("The library %1 uses an unsupported format and can not be changed.", localFile()));
+        return;
+    }
+
+    // encode all the patterns first, patterns not yet decoded are read from the existing file
+    QList<QByteArray> encodedPatterns;
+
+    foreach (LibraryPattern *libraryPattern, m_libraryPatterns) {
+        QByteArray data;
+        QDataStream dataStream(&data, QIODevice::WriteOnly);
+        dataStream << *libraryPattern->pattern();
+        encodedPatterns.append(data);
+    }
+
     QFile file(localFile());
 
     if (file.open(QIODevice::WriteOnly)) { // truncates the file
         QDataStream stream(&file);
         stream.writeRawData("KXStitchLib", 11);
         stream << qint16(version);
-        stream << qint32(m_libraryPatterns.count());
-        QListIterator<LibraryPattern *> iterator(m_libraryPatterns);
 
-        while (iterator.hasNext()) {
-            LibraryPattern *libraryPattern = iterator.next();
-            stream << *libraryPattern;
+        m_records.clear();
+        m_liveBytes = 0;
+        m_deadBytes = 0;
+
+        for (int i = 0 ; i < m_libraryPatterns.count() ; ++i) {
+            LibraryPattern *libraryPattern = m_libraryPatterns.at(i);
+            const QByteArray &data = encodedPatterns.at(i);
+            qint64 recordOffset = file.pos();
+
+            writePatternRecord(stream, libraryPattern, data);
+
+            m_records.insert(libraryPattern, Record{recordOffset, file.pos() - recordOffset});
+            m_liveBytes += file.pos() - recordOffset;
         }
 
         file.close();
@@ -220,6 +347,85 @@ void LibraryFile::writeFile()
 }
 
 
+/**
+    Append a record to the end of the library file.
+    If the file does not exist or is in an older format the whole file is written instead.
+    @param type PatternRecord to append the pattern or DeletedRecord to mark the pattern as deleted
+    @param libraryPattern a pointer to the LibraryPattern
+    */
+void LibraryFile::appendRecord(LibraryFile::RecordType type, LibraryPattern *libraryPattern)
+{
+    QFile file(localFile());
+
+    if (!file.open(QIODevice::ReadWrite)) {
+        KMessageBox::error(nullptr, i18n("The file %1\ncould not be opened for writing.\n%2", localFile(), file.errorString()), i18n("Error opening file"));
+        return;
+    }
+
+    QDataStream stream(&file);
+    char header[11] = {0};
+    qint16 fileVersion = 0;
+
+    if (file.size() >= headerSize) {
+        stream.readRawData(header, 11);
+        stream >> fileVersion;
+    }
+
+    if (strncmp(header, "KXStitchLib", 11) != 0 || fileVersion != version) {
+        file.close();
+        writeFile();
+        return;
+    }
+
+    file.seek(file.size());
+    qint64 recordOffset = file.pos();
+
+    if (type == PatternRecord) {
+        QByteArray data;
+        QDataStream dataStream(&data, QIODevice::WriteOnly);
+        dataStream << *libraryPattern->pattern();
+
+        writePatternRecord(stream, libraryPattern, data);
+
+        m_records.insert(libraryPattern, Record{recordOffset, file.pos() - recordOffset});
+        m_liveBytes += file.pos() - recordOffset;
+    } else {
+        Record deleted = m_records.take(libraryPattern);
+
+        stream << qint8(DeletedRecord);
+        stream << deleted.offset;
+
+        m_liveBytes -= deleted.size;
+        m_deadBytes += deleted.size + file.pos() - recordOffset;
+    }
+
+    file.close();
+    m_read = true;
+}
+
+
+/**
+    Write a pattern record.
+    The record holds the values needed to list the pattern, index its character and render its
+    thumbnail without decoding it, followed by the encoded pattern.
+    @param stream a reference to the QDataStream to write to
+    @param libraryPattern a pointer to the LibraryPattern
+    @param data a const reference to a QByteArray containing the encoded pattern
+    */
+void LibraryFile::writePatternRecord(QDataStream &stream, LibraryPattern *libraryPattern, const QByteArray &data)
+{
+    stream << qint8(PatternRecord);
+    stream << libraryPattern->key();
+    stream << qint32(libraryPattern->modifiers());
+    stream << libraryPattern->baseline();
+    stream << libraryPattern->height();
+    stream << libraryPattern->schemeName();
+    stream << libraryPattern->symbolLibrary();
+    stream << qint32(data.size());
+    stream.writeRawData(data.constData(), data.size());
+}
+
+
 QString LibraryFile::localFile() const
 {
     QFileInfo path(m_path);
@@ -13,11 +13,14 @@
 #define LibraryFile_H
 
 
+#include <QHash>
 #include <QList>
 #include <QString>
 
 
 class LibraryPattern;
+class QByteArray;
+class QDataStream;
 
 
 class LibraryFile
@@ -36,19 +39,34 @@ public:
     LibraryPattern *next();
 
 private:
+    enum RecordType {PatternRecord = 1, DeletedRecord = 2};
+
+    class Record
+    {
+    public:
+        qint64  offset;
+        qint64  size;
+    };
+
     void readFile();
     void writeFile();
+    void appendRecord(LibraryFile::RecordType, LibraryPattern *);
+    static void writePatternRecord(QDataStream &, LibraryPattern *, const QByteArray &);
     bool hasChanged();
 
-    static const int version = 100;
+    static const int version = 102;    // changed to append only records with deleted markers
+    static const int headerSize = 13;
 
     bool            m_exists;
     bool            m_read;
+    bool            m_unsupported;  // the file is in a format that can not be read, it is never written
     QString         m_path;
     QList<LibraryPattern *> m_libraryPatterns;
     int         m_current;
 
-
+    QHash<const LibraryPattern *, Record>   m_records;  // the records in the file for each pattern
+    qint64          m_liveBytes;    // size of the records of current patterns
+    qint64          m_deadBytes;    // size of the records of deleted patterns and the deleted markers
 };
 
 
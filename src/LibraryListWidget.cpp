@@ -14,8 +14,10 @@
 #include <QApplication>
 #include <QBitmap>
 #include <QDrag>
+#include <QFutureWatcher>
 #include <QMimeData>
 #include <QMouseEvent>
+#include <QPaintEvent>
 #include <QPainter>
 
 #include "LibraryListWidgetItem.h"
@@ -118,3 +120,72 @@ void LibraryListWidget::mouseMoveEvent(QMouseEvent *e)
         e->ignore();
     }
 }
+
+
+/**
+    Request the thumbnails of any items about to be painted before painting the view.
+    */
+void LibraryListWidget::paintEvent(QPaintEvent *e)
+{
+    requestVisibleThumbnails();
+    QListWidget::paintEvent(e);
+}
+
+
+/**
+    Request the thumbnails for the items within the visible area of the view that have not
+    been requested yet. Thumbnails not found in the cache are rendered in worker threads and
+    set when they are finished.
+    */
+void LibraryListWidget::requestVisibleThumbnails()
+{
+    QRect visibleRect = viewport()->rect();
+
+    for (int i = 0 ; i < count() ; ++i) {
+        LibraryListWidgetItem *libraryListWidgetItem = static_cast<LibraryListWidgetItem *>(item(i));
+
+        if (libraryListWidgetItem->thumbnailRequested() || !visualItemRect(libraryListWidgetItem).intersects(visibleRect)) {
+            continue;
+        }
+
+        QFuture<QImage> future = libraryListWidgetItem->requestThumbnail();
+
+        if (future.isCanceled()) {
+            continue;   // the icon was found in the cache
+        }
+
+        QString key = libraryListWidgetItem->thumbnailKey();
+        QFutureWatcher<QImage> *watcher = new QFutureWatcher<QImage>(this);
+
+        connect(watcher, &QFutureWatcher<QImage>::finished, this, [this, watcher, libraryListWidgetItem, key]() {
+            thumbnailRendered(libraryListWidgetItem, key, watcher->result());
+            watcher->deleteLater();
+        });
+
+        watcher->setFuture(future);
+    }
+}
+
+
+/**
+    Set the icon of an item when its thumbnail has been rendered.
+    The item may have been deleted or reused for another pattern while the thumbnail was being
+    rendered, so it is checked that the item is still in the list and still wants the thumbnail.
+    @param listWidgetItem a pointer to the QListWidgetItem the thumbnail was requested for
+    @param key the key of the thumbnail
+    @param image a const reference to the rendered QImage
+    */
+void LibraryListWidget::thumbnailRendered(QListWidgetItem *listWidgetItem, const QString &key, const QImage &image)
+{
+    for (int i = 0 ; i < count() ; ++i) {
+        if (item(i) == listWidgetItem) {
+            LibraryListWidgetItem *libraryListWidgetItem = static_cast<LibraryListWidgetItem *>(listWidgetItem);
+
+            if (libraryListWidgetItem->thumbnailKey() == key) {
+                libraryListWidgetItem->setIcon(QIcon(QPixmap::fromImage(image)));
+            }
+
+            break;
+        }
+    }
+}
@@ -39,8 +39,12 @@ protected:
     virtual void dragLeaveEvent(QDragLeaveEvent *) Q_DECL_OVERRIDE;
     virtual void mousePressEvent(QMouseEvent *) Q_DECL_OVERRIDE;
     virtual void mouseMoveEvent(QMouseEvent *) Q_DECL_OVERRIDE;
+    virtual void paintEvent(QPaintEvent *) Q_DECL_OVERRIDE;
 
 private:
+    void requestVisibleThumbnails();
+    void thumbnailRendered(QListWidgetItem *, const QString &, const QImage &);
+
     Renderer    m_renderer;
 
     QPoint  m_startDrag;
@@ -11,16 +11,27 @@
 
 #include "LibraryListWidgetItem.h"
 
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
 #include <QPainter>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtConcurrent>
 
 #include "LibraryPattern.h"
 #include "Pattern.h"
 #include "Renderer.h"
+#include "SchemeManager.h"
 #include "StitchData.h"
+#include "SymbolManager.h"
 
 #include "configuration.h"
 
 
+static const int thumbnailSize = 256;
+
+
 LibraryListWidgetItem::LibraryListWidgetItem(QListWidget *listWidget, LibraryPattern *libraryPattern)
     :   QListWidgetItem(listWidget)
 {
@@ -28,42 +39,140 @@ LibraryListWidgetItem::LibraryListWidgetItem(QListWidget *listWidget, LibraryPat
 }
 
 
+/**
+    Set the library pattern shown by the item.
+    The icon is not created until the item is shown, see requestThumbnail().
+    @param libraryPattern a pointer to the LibraryPattern
+    */
 void LibraryListWidgetItem::setLibraryPattern(LibraryPattern *libraryPattern)
 {
-    static Renderer *renderer = nullptr;
+    m_libraryPattern = libraryPattern;
+    m_thumbnailRequested = false;
+    m_thumbnailKey.clear();
+    setIcon(QIcon());
+}
+
+
+LibraryPattern *LibraryListWidgetItem::libraryPattern()
+{
+    return m_libraryPattern;
+}
+
+
+bool LibraryListWidgetItem::thumbnailRequested() const
+{
+    return m_thumbnailRequested;
+}
+
+
+QString LibraryListWidgetItem::thumbnailKey() const
+{
+    return m_thumbnailKey;
+}
+
+
+/**
+    Request the icon for the item.
+    Thumbnails are cached on disk named by a hash of the encoded pattern, so they are found
+    again whichever library or position the pattern is in. If the thumbnail is in the cache the
+    icon is set immediately, otherwise the pattern is rendered in a worker thread which also
+    saves it to the cache. The grid line settings are part of the key, so changing them renders
+    new thumbnails rather than using ones drawn with the old grid.
+    @return a QFuture for the rendered image, this will be canceled if the icon was set from
+    the cache
+    */
+QFuture<QImage> LibraryListWidgetItem::requestThumbnail()
+{
+    m_thumbnailRequested = true;
 
-    if (renderer == nullptr) {
-        renderer = new Renderer();
-        renderer->setRenderStitchesAs(Configuration::EnumRenderer_RenderStitchesAs::Stitches);
-        renderer->setRenderBackstitchesAs(Configuration::EnumRenderer_RenderBackstitchesAs::ColorLines);
-        renderer->setRenderKnotsAs(Configuration::EnumRenderer_RenderKnotsAs::ColorBlocks);
+    QByteArray data = m_libraryPattern->encodedPattern();
+
+    // the renderer reads the grid settings from the configuration when it is created
+    Renderer renderer;
+    renderer.setRenderStitchesAs(Configuration::EnumRenderer_RenderStitchesAs::Stitches);
+    renderer.setRenderBackstitchesAs(Configuration::EnumRenderer_RenderBackstitchesAs::ColorLines);
+    renderer.setRenderKnotsAs(Configuration::EnumRenderer_RenderKnotsAs::ColorBlocks);
+
+    QByteArray gridSettings;
+    QDataStream gridStream(&gridSettings, QIODevice::WriteOnly);
+    gridStream  << qint32(Configuration::editor_CellHorizontalGrouping())
+                << qint32(Configuration::editor_CellVerticalGrouping())
+                << Configuration::editor_ThinLineColor()
+                << Configuration::editor_ThickLineColor()
+                << qint32(Configuration::editor_ThinLineWidth())
+                << qint32(Configuration::editor_ThickLineWidth());
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(data);
+    hash.addData(gridSettings);
+    m_thumbnailKey = QString::fromLatin1("%1-%2").arg(QString::fromLatin1(hash.result().toHex())).arg(thumbnailSize);
+
+    QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    QString cachePath;
+
+    if (!cacheDir.isEmpty()) {
+        cacheDir += QLatin1String("/library-thumbnails");
+        cachePath = QString::fromLatin1("%1/%2.png").arg(cacheDir).arg(m_thumbnailKey);
+
+        QImage image;
+
+        if (image.load(cachePath)) {
+            setIcon(QIcon(QPixmap::fromImage(image)));
+            return QFuture<QImage>();
+        }
+
+        QDir().mkpath(cacheDir);
     }
 
-    m_libraryPattern = libraryPattern;
+    // schemes and symbol libraries are loaded on first use, make sure that happens in this thread,
+    // the names are taken from the library index so the pattern is only decoded by the worker
+    SchemeManager::scheme(m_libraryPattern->schemeName());
+    SymbolManager::library(m_libraryPattern->symbolLibrary());
+
+    return QtConcurrent::run(&LibraryListWidgetItem::renderThumbnail, renderer, data, cachePath);
+}
+
 
-    StitchData &stitches = libraryPattern->pattern()->stitches();
-    int cellSize = 256 / std::max(stitches.width(), stitches.height());
-    QPixmap pixmap(stitches.width() * cellSize, stitches.height() * cellSize);
-    pixmap.fill(Qt::white);
+/**
+    Render a thumbnail of a pattern, this is called in a worker thread.
+    @param renderer a Renderer set up with the settings used in the cache key
+    @param data a const reference to a QByteArray containing the encoded pattern
+    @param cachePath the path to save the thumbnail to, this may be empty
+    @return a QImage of the thumbnail
+    */
+QImage LibraryListWidgetItem::renderThumbnail(Renderer renderer, const QByteArray &data, const QString &cachePath)
+{
+    Pattern pattern;
+    QDataStream stream(data);
+    stream >> pattern;
 
-    QPainter painter(&pixmap);
+    StitchData &stitches = pattern.stitches();
+    int cellSize = thumbnailSize / std::max(1, std::max(stitches.width(), stitches.height()));
+    QImage image(std::max(1, stitches.width() * cellSize), std::max(1, stitches.height() * cellSize), QImage::Format_RGB32);
+    image.fill(Qt::white);
+
+    QPainter painter(&image);
     painter.setRenderHint(QPainter::Antialiasing, true);
     painter.setWindow(0, 0, stitches.width(), stitches.height());
 
-    renderer->render(&painter,
-                     libraryPattern->pattern(),
-                     pixmap.rect(),
-                     true,
-                     true,
-                     true,
-                     true,
-                     -1);
+    renderer.render(&painter,
+                    &pattern,
+                    image.rect(),
+                    true,
+                    true,
+                    true,
+                    true,
+                    -1);
 
-    setIcon(QIcon(pixmap));
-}
+    painter.end();
 
+    if (!cachePath.isEmpty()) {
+        QSaveFile file(cachePath);    // another item may be saving the same thumbnail
 
-LibraryPattern *LibraryListWidgetItem::libraryPattern()
-{
-    return m_libraryPattern;
+        if (file.open(QIODevice::WriteOnly) && image.save(&file, "PNG")) {
+            file.commit();
+        }
+    }
+
+    return image;
 }
@@ -13,11 +13,15 @@
 #define LibraryListWidgetItem_H
 
 
+#include <QFuture>
+#include <QImage>
 #include <QListWidgetItem>
+#include <QString>
 
 
 class LibraryPattern;
 class QListWidget;
+class Renderer;
 
 
 class LibraryListWidgetItem : public QListWidgetItem
@@ -28,8 +32,16 @@ public:
     void setLibraryPattern(LibraryPattern *libraryPattern);
     LibraryPattern *libraryPattern();
 
+    bool thumbnailRequested() const;
+    QString thumbnailKey() const;
+    QFuture<QImage> requestThumbnail();
+
 private:
-    LibraryPattern *m_libraryPattern;
+    static QImage renderThumbnail(Renderer, const QByteArray &, const QString &);
+
+    LibraryPattern  *m_libraryPattern;
+    bool            m_thumbnailRequested;
+    QString         m_thumbnailKey;
 };
 
 
@@ -278,6 +278,7 @@ void LibraryManagerDlg::patternProperties()
     if (dialog->exec()) {
         libraryPattern->setKeyModifiers(dialog->key(), dialog->modifiers());
         libraryPattern->setBaseline(dialog->baseline());
+        static_cast<LibraryTreeWidgetItem *>(ui.LibraryTree->currentItem())->invalidateIndex();
     }
 
     delete dialog;
@@ -11,14 +11,19 @@
 
 #include "LibraryPattern.h"
 
+#include <QFile>
 #include <QListWidget>
 
 #include "KeycodeLineEdit.h"
 #include "LibraryListWidgetItem.h"
+#include "MemoryAccounting.h"
 #include "Pattern.h"
 
 
 LibraryPattern::LibraryPattern()
+    :   m_offset(0),
+        m_size(0),
+        m_height(0)
 {
     m_pattern = new Pattern;
 }
@@ -26,6 +31,9 @@ LibraryPattern::LibraryPattern()
 
 LibraryPattern::LibraryPattern(Pattern *pattern, qint32 key, Qt::KeyboardModifiers modifiers, qint16 baseline)
     :   m_pattern(pattern),
+        m_offset(0),
+        m_size(0),
+        m_height(0),
         m_key(key),
         m_modifiers(modifiers),
         m_baseline(baseline),
@@ -35,14 +43,237 @@ LibraryPattern::LibraryPattern(Pattern *pattern, qint32 key, Qt::KeyboardModifie
 }
 
 
+/**
+    Constructor for patterns read from a version 1 library.
+    The data is decoded when the pattern is first required.
+    */
 LibraryPattern::LibraryPattern(QByteArray data, qint32 key, Qt::KeyboardModifiers modifiers, qint16 baseline)
-    :   m_key(key),
+    :   m_pattern(nullptr),
+        m_data(data),
+        m_offset(0),
+        m_size(0),
+        m_height(0),
+        m_key(key),
+        m_modifiers(modifiers),
+        m_baseline(baseline),
+        m_libraryListWidgetItem(nullptr),
+        m_changed(false)
+{
+}
+
+
+/**
+    Constructor for patterns listed in the index of a library file.
+    The pattern is read from the file and decoded when first required.
+    @param path the path of the library file
+    @param offset the position of the encoded pattern in the file
+    @param size the size of the encoded pattern
+    @param height the height of the pattern in cells
+    @param schemeName the name of the floss scheme used by the pattern
+    @param symbolLibrary the name of the symbol library used by the pattern
+    */
+LibraryPattern::LibraryPattern(const QString &path, qint64 offset, qint32 size, qint32 height, const QString &schemeName, const QString &symbolLibrary, qint32 key, Qt::KeyboardModifiers modifiers, qint16 baseline)
+    :   m_pattern(nullptr),
+        m_path(path),
+        m_offset(offset),
+        m_size(size),
+        m_height(height),
+        m_schemeName(schemeName),
+        m_symbolLibrary(symbolLibrary),
+        m_key(key),
         m_modifiers(modifiers),
         m_baseline(baseline),
         m_libraryListWidgetItem(nullptr),
         m_changed(false)
 {
-    QDataStream stream(&data, QIODevice::ReadOnly);
+}
+
+
+qint32 LibraryPattern::key() const
+{
+    return m_key;
+}
+
+
+Qt::KeyboardModifiers LibraryPattern::modifiers() const
+{
+    return m_modifiers;
+}
+
+
+qint16 LibraryPattern::baseline() const
+{
+    return m_baseline;
+}
+
+
+/**
+    Get the height of the pattern.
+    For patterns not yet decoded from an indexed library this is taken from the index without
+    decoding the pattern.
+    @return the height in cells
+    */
+qint32 LibraryPattern::height() const
+{
+    if (m_pattern == nullptr && !m_path.isEmpty()) {
+        return m_height;
+    }
+
+    decode();
+    return m_pattern->stitches().height();
+}
+
+
+/**
+    Get the name of the floss scheme used by the pattern.
+    For patterns not yet decoded from an indexed library this is taken from the index without
+    decoding the pattern.
+    @return a QString containing the scheme name
+    */
+QString LibraryPattern::schemeName() const
+{
+    if (m_pattern == nullptr && !m_path.isEmpty()) {
+        return m_schemeName;
+    }
+
+    decode();
+    return m_pattern->palette().schemeName();
+}
+
+
+/**
+    Get the name of the symbol library used by the pattern.
+    For patterns not yet decoded from an indexed library this is taken from the index without
+    decoding the pattern.
+    @return a QString containing the symbol library name
+    */
+QString LibraryPattern::symbolLibrary() const
+{
+    if (m_pattern == nullptr && !m_path.isEmpty()) {
+        return m_symbolLibrary;
+    }
+
+    decode();
+    return m_pattern->palette().symbolLibrary();
+}
+
+
+Pattern *LibraryPattern::pattern()
+{
+    decode();
+    return m_pattern;
+}
+
+
+/**
+    Get the pattern encoded as it is in a library file.
+    For patterns not yet decoded from an indexed library this is read directly from the file
+    without decoding the pattern.
+    @return a QByteArray containing the encoded pattern
+    */
+QByteArray LibraryPattern::encodedPattern() const
+{
+    QByteArray data;
+
+    if (m_pattern == nullptr && !m_path.isEmpty()) {
+        QFile file(m_path);
+
+        if (file.open(QIODevice::ReadOnly) && file.seek(m_offset)) {
+            data = file.read(m_size);
+        }
+    } else {
+        decode();
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream << *m_pattern;
+    }
+
+    return data;
+}
+
+
+LibraryListWidgetItem *LibraryPattern::libraryListWidgetItem() const
+{
+    return m_libraryListWidgetItem;
+}
+
+
+bool LibraryPattern::hasChanged() const
+{
+    return m_changed;
+}
+
+
+/**
+    Estimate the memory used by the pattern, only patterns that have been
+    decoded hold their stitches.
+    @return the number of bytes used
+    */
+qint64 LibraryPattern::memoryUsage() const
+{
+    qint64 usage = MemoryAccounting::heapBlock(sizeof(LibraryPattern)) + MemoryAccounting::byteArrayUsage(m_data) + MemoryAccounting::stringUsage(m_schemeName) + MemoryAccounting::stringUsage(m_symbolLibrary);
+
+    if (m_pattern) {
+        usage += MemoryAccounting::heapBlock(sizeof(Pattern)) + m_pattern->stitches().memoryUsage();
+    }
+
+    return usage;
+}
+
+
+void LibraryPattern::setKeyModifiers(qint32 key, Qt::KeyboardModifiers modifiers)
+{
+    m_key = key;
+    m_modifiers = modifiers;
+    m_libraryListWidgetItem->setText(KeycodeLineEdit::keyString(key, modifiers));
+    m_changed = true;
+}
+
+
+void LibraryPattern::setBaseline(qint16 baseline)
+{
+    m_baseline = baseline;
+    m_changed = true;
+}
+
+
+void LibraryPattern::setLibraryListWidgetItem(LibraryListWidgetItem *libraryListWidgetItem)
+{
+    m_libraryListWidgetItem = libraryListWidgetItem;
+    libraryListWidgetItem->setText(KeycodeLineEdit::keyString(m_key, m_modifiers));
+}
+
+
+/**
+    Decode the pattern if it has not already been decoded.
+    */
+void LibraryPattern::decode() const
+{
+    if (m_pattern) {
+        return;
+    }
+
+    m_pattern = new Pattern;
+
+    if (!m_path.isEmpty()) {
+        QFile file(m_path);
+
+        if (file.open(QIODevice::ReadOnly) && file.seek(m_offset)) {
+            QByteArray data = file.read(m_size);
+            QDataStream stream(data);
+            stream >> *m_pattern;
+        }
+    } else if (!m_data.isEmpty()) {
+        decodeVersion1();
+    }
+}
+
+
+/**
+    Decode the data read from a version 1 library.
+    */
+void LibraryPattern::decodeVersion1() const
+{
+    QDataStream stream(&m_data, QIODevice::ReadOnly);
     stream.setVersion(QDataStream::Qt_3_3);
     QString scheme;
     qint32 width;
@@ -50,7 +281,6 @@ LibraryPattern::LibraryPattern(QByteArray data, qint32 key, Qt::KeyboardModifier
     stream  >> scheme
             >> width
             >> height;
-    m_pattern = new Pattern;
     m_pattern->palette().setSchemeName(scheme);
     m_pattern->stitches().resize(width, height);
 
@@ -110,70 +340,15 @@ LibraryPattern::LibraryPattern(QByteArray data, qint32 key, Qt::KeyboardModifier
 
         m_pattern->stitches().addFrenchKnot(position, colorIndex);
     }
-}
-
-
-qint32 LibraryPattern::key() const
-{
-    return m_key;
-}
 
-
-Qt::KeyboardModifiers LibraryPattern::modifiers() const
-{
-    return m_modifiers;
-}
-
-
-qint16 LibraryPattern::baseline() const
-{
-    return m_baseline;
-}
-
-
-Pattern *LibraryPattern::pattern()
-{
-    return m_pattern;
-}
-
-
-LibraryListWidgetItem *LibraryPattern::libraryListWidgetItem() const
-{
-    return m_libraryListWidgetItem;
-}
-
-
-bool LibraryPattern::hasChanged() const
-{
-    return m_changed;
-}
-
-
-void LibraryPattern::setKeyModifiers(qint32 key, Qt::KeyboardModifiers modifiers)
-{
-    m_key = key;
-    m_modifiers = modifiers;
-    m_libraryListWidgetItem->setText(KeycodeLineEdit::keyString(key, modifiers));
-    m_changed = true;
-}
-
-
-void LibraryPattern::setBaseline(qint16 baseline)
-{
-    m_baseline = baseline;
-    m_changed = true;
-}
-
-
-void LibraryPattern::setLibraryListWidgetItem(LibraryListWidgetItem *libraryListWidgetItem)
-{
-    m_libraryListWidgetItem = libraryListWidgetItem;
-    libraryListWidgetItem->setText(KeycodeLineEdit::keyString(m_key, m_modifiers));
+    m_data.clear();
 }
 
 
 QDataStream &operator<<(QDataStream &stream, const LibraryPattern &libraryPattern)
 {
+    libraryPattern.decode();
+
     stream << libraryPattern.version;
     stream << libraryPattern.m_key;
     stream << qint32(libraryPattern.m_modifiers);
@@ -28,13 +28,19 @@ public:
     LibraryPattern();
     explicit LibraryPattern(Pattern *, qint32 key = 0, Qt::KeyboardModifiers modifiers = Qt::NoModifier, qint16 baseline = 0);
     explicit LibraryPattern(QByteArray, qint32 key = 0, Qt::KeyboardModifiers modifiers = Qt::NoModifier, qint16 baseline = 0);
+    LibraryPattern(const QString &, qint64, qint32, qint32, const QString &, const QString &, qint32 key = 0, Qt::KeyboardModifiers modifiers = Qt::NoModifier, qint16 baseline = 0);
 
     qint32 key() const;
     Qt::KeyboardModifiers modifiers() const;
     qint16 baseline() const;
+    qint32 height() const;
+    QString schemeName() const;
+    QString symbolLibrary() const;
     Pattern *pattern();
+    QByteArray encodedPattern() const;
     LibraryListWidgetItem *libraryListWidgetItem() const;
     bool hasChanged() const;
+    qint64 memoryUsage() const;
 
     void setKeyModifiers(qint32, Qt::KeyboardModifiers);
     void setBaseline(qint16);
@@ -44,9 +50,19 @@ public:
     friend QDataStream &operator>>(QDataStream &, LibraryPattern &);
 
 private:
+    void decode() const;
+    void decodeVersion1() const;
+
     static const int version = 100;
 
-    Pattern         *m_pattern;
+    mutable Pattern     *m_pattern;     // decoded when first required, null until then
+    mutable QByteArray  m_data;         // version 1 pattern data waiting to be decoded
+    QString         m_path;             // file containing the encoded pattern for indexed libraries
+    qint64          m_offset;
+    qint32          m_size;
+    qint32          m_height;           // from the index, used until the pattern is decoded
+    QString         m_schemeName;
+    QString         m_symbolLibrary;
     qint32          m_key;
     Qt::KeyboardModifiers   m_modifiers;
     qint16          m_baseline;
@@ -102,14 +102,18 @@ struct LIBRARY (new kde4)
 
 
 LibraryTreeWidgetItem::LibraryTreeWidgetItem(QTreeWidget *parent, const QString &name)
-    :   QTreeWidgetItem(parent, QTreeWidgetItem::UserType)
+    :   QTreeWidgetItem(parent, QTreeWidgetItem::UserType),
+        m_indexValid(false),
+        m_maxHeight(0)
 {
     setText(0, name);
 }
 
 
 LibraryTreeWidgetItem::LibraryTreeWidgetItem(LibraryTreeWidgetItem *parent, const QString &name)
-    :   QTreeWidgetItem(parent, QTreeWidgetItem::UserType)
+    :   QTreeWidgetItem(parent, QTreeWidgetItem::UserType),
+        m_indexValid(false),
+        m_maxHeight(0)
 {
     setText(0, name);
 }
@@ -121,29 +125,38 @@ LibraryTreeWidgetItem::~LibraryTreeWidgetItem()
 }
 
 
+/**
+    Get the height of the tallest pattern in the library, used by the alphabet
+    tool to space the lines of text.
+    The value is calculated when the character index is built rather than
+    decoding every pattern each time a new line is started.
+    @return the height in cells
+    */
 int LibraryTreeWidgetItem::maxHeight()
 {
-    int max = 0;
-
-    for (LibraryPattern *libraryPattern = first() ; libraryPattern ; libraryPattern = next()) {
-        max = std::max(max, libraryPattern->pattern()->stitches().height());
+    if (!m_indexValid) {
+        buildIndex();
     }
 
-    return max;
+    return m_maxHeight;
 }
 
 
+/**
+    Find the pattern assigned to a key and modifier combination.
+    The lookup uses the character index so that the alphabet tool does not
+    have to search the library files for every key press.
+    @param key the Qt::Key value
+    @param modifiers the keyboard modifiers
+    @return a pointer to the LibraryPattern, nullptr if there isn't one
+    */
 LibraryPattern *LibraryTreeWidgetItem::findCharacter(int key, Qt::KeyboardModifiers modifiers)
 {
-    LibraryPattern *libraryPattern;
-
-    for (libraryPattern = first() ; libraryPattern ; libraryPattern = next()) {
-        if (libraryPattern->key() == key && libraryPattern->modifiers() == modifiers) {
-            break;
-        }
+    if (!m_indexValid) {
+        buildIndex();
     }
 
-    return libraryPattern;
+    return m_characterIndex.value(characterKey(key, modifiers), nullptr);
 }
 
 
@@ -185,6 +198,7 @@ LibraryPattern *LibraryTreeWidgetItem::next()
 void LibraryTreeWidgetItem::addPath(const QString &path)
 {
     m_libraryFiles.append(new LibraryFile(path));
+    invalidateIndex();
 }
 
 
@@ -232,6 +246,7 @@ LibraryFile *LibraryTreeWidgetItem::writablePath()
 void LibraryTreeWidgetItem::addPattern(LibraryPattern *libraryPattern)
 {
     writablePath()->addPattern(libraryPattern);
+    invalidateIndex();
 }
 
 
@@ -248,4 +263,56 @@ void LibraryTreeWidgetItem::deletePattern(LibraryPattern *libraryPattern)
             }
         }
     }
+
+    invalidateIndex();
+}
+
+
+/**
+    Discard the character index so that it is rebuilt on the next lookup.
+    This needs to be called when the key, modifiers or baseline of a pattern
+    in the library are changed.
+    */
+void LibraryTreeWidgetItem::invalidateIndex()
+{
+    m_indexValid = false;
+    m_characterIndex.clear();
+}
+
+
+/**
+    Build the character index and the maximum height from the patterns in all
+    the library files. The heights are taken from the library index, so the
+    patterns are not decoded.
+    Where more than one pattern has the same key and modifiers, the first one
+    found is used, matching the previous search order.
+    */
+void LibraryTreeWidgetItem::buildIndex()
+{
+    m_characterIndex.clear();
+    m_maxHeight = 0;
+
+    for (LibraryPattern *libraryPattern = first() ; libraryPattern ; libraryPattern = next()) {
+        quint64 key = characterKey(libraryPattern->key(), libraryPattern->modifiers());
+
+        if (!m_characterIndex.contains(key)) {
+            m_characterIndex.insert(key, libraryPattern);
+        }
+
+        m_maxHeight = std::max(m_maxHeight, libraryPattern->height());
+    }
+
+    m_indexValid = true;
+}
+
+
+/**
+    Combine a key and modifiers into a single value for the character index.
+    @param key the Qt::Key value
+    @param modifiers the keyboard modifiers
+    @return the combined value
+    */
+quint64 LibraryTreeWidgetItem::characterKey(int key, Qt::KeyboardModifiers modifiers)
+{
+    return (quint64(quint32(key)) << 32) | quint32(modifiers);
 }
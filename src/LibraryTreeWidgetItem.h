@@ -13,6 +13,7 @@
 #define LibraryTreeWidgetItem_H
 
 
+#include <QHash>
 #include <QList>
 #include <QString>
 #include <QStringList>
@@ -42,12 +43,19 @@ public:
     QStringList paths();
     void addPattern(LibraryPattern *);
     void deletePattern(LibraryPattern *);
+    void invalidateIndex();
 
 private:
     LibraryFile *writablePath();
+    void buildIndex();
+    static quint64 characterKey(int, Qt::KeyboardModifiers);
 
     int         m_libraryFilesIndex;
     QList<LibraryFile *>    m_libraryFiles;
+
+    bool        m_indexValid;
+    int         m_maxHeight;
+    QHash<quint64, LibraryPattern *>    m_characterIndex;
 };
 
 
@@ -60,13 +60,16 @@
 
 #include <QApplication>
 #include <QCommandLineParser>
+#include <QDebug>
 #include <QUrl>
 
 #include <KAboutData>
 #include <KLocalizedString>
 
 #include "configuration.h"
+#include "InputRecorder.h"
 #include "MainWindow.h"
+#include "Trace.h"
 
 
 /**
@@ -120,11 +123,19 @@ int main(int argc, char *argv[])
     parser.addVersionOption();
 
     parser.addPositionalArgument(QStringLiteral("urls"), i18n("Document to open."), QStringLiteral("[urls...]"));
+    parser.addOption(QCommandLineOption(QStringLiteral("trace"), i18n("Write a performance trace to <file>, this can also be set with the KXSTITCH_TRACE environment variable."), QStringLiteral("file")));
+    parser.addOption(QCommandLineOption(QStringLiteral("record"), i18n("Record the editor input to <file> so it can be replayed with kxstitch-replay, this can also be set with the KXSTITCH_RECORD environment variable."), QStringLiteral("file")));
 
     parser.process(app);
 
     aboutData.processCommandLine(&parser);
 
+    QString traceFile = parser.isSet(QStringLiteral("trace")) ? parser.value(QStringLiteral("trace")) : QString::fromLocal8Bit(qgetenv("KXSTITCH_TRACE"));
+
+    if (!traceFile.isEmpty() && !Trace::start(traceFile)) {
+        qWarning() << "Unable to open the trace file" << traceFile;
+    }
+
     MainWindow *mainWindow;
 
     QStringList urls = parser.positionalArguments();
@@ -139,6 +150,13 @@ int main(int argc, char *argv[])
         }
     }
 
+    QString recordFile = parser.isSet(QStringLiteral("record")) ? parser.value(QStringLiteral("record")) : QString::fromLocal8Bit(qgetenv("KXSTITCH_RECORD"));
+
+    if (!recordFile.isEmpty()) {
+        // only the last window opened is recorded
+        new InputRecorder(mainWindow, recordFile);
+    }
+
 #if 0
     if (app.isSessionRestored()) {
         kRestoreMainWindows<MainWindow>();
@@ -161,5 +179,9 @@ int main(int argc, char *argv[])
     }
 #endif
 
-    return app.exec();
+    int result = app.exec();
+
+    Trace::stop();
+
+    return result;
 }
@@ -54,6 +54,7 @@
 #include "Floss.h"
 #include "FlossScheme.h"
 #include "ImportImageDlg.h"
+#include "MemoryUsageView.h"
 #include "Palette.h"
 #include "PaletteManagerDlg.h"
 #include "PaperSizes.h"
@@ -65,6 +66,7 @@
 #include "SchemeManager.h"
 #include "SymbolLibrary.h"
 #include "SymbolManager.h"
+#include "Trace.h"
 
 
 MainWindow::MainWindow()
@@ -550,10 +552,14 @@ void MainWindow::convertImage(const QString &source)
     QPointer<ImportImageDlg> importImageDlg = new ImportImageDlg(this, image);
 
     if (importImageDlg->exec()) {
+        TraceScope trace("import", "MainWindow::convertImage");
+
         Magick::Image convertedImage = importImageDlg->convertedImage();
 
         int imageWidth = convertedImage.columns();
         int imageHeight = convertedImage.rows();
+        trace.addArgument("width", imageWidth);
+        trace.addArgument("height", imageHeight);
         int documentWidth = imageWidth;
         int documentHeight = imageHeight;
 
@@ -1742,4 +1748,12 @@ void MainWindow::setupDockWindows()
     dock->setWidget(m_imageLabel);
     addDockWidget(Qt::LeftDockWidgetArea, dock);
     actionCollection()->addAction(QStringLiteral("showImportedDockWidget"), dock->toggleViewAction());
+
+    dock = new QDockWidget(i18n("Memory Usage"), this);
+    dock->setObjectName(QStringLiteral("MemoryUsageDock#"));
+    dock->setAllowedAreas(Qt::AllDockWidgetAreas);
+    dock->setWidget(new MemoryUsageView(this));
+    addDockWidget(Qt::RightDockWidgetArea, dock);
+    dock->hide();
+    actionCollection()->addAction(QStringLiteral("showMemoryUsageDockWidget"), dock->toggleViewAction());
 }
@@ -0,0 +1,343 @@
+/*
+ * Copyright (C) 2026 by agent
+ * agent@local
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+/**
+    @file
+    Implement the MemoryAccounting class used to report the memory used by
+    the documents, their undo stacks, the view caches and the libraries.
+    Objects that hold significant amounts of data implement the
+    MemoryAccountable interface, and the owners register them, or a function
+    returning their usage, under a group and a name. The usage is only
+    calculated when a sample is taken, so registering has no cost while the
+    memory usage is not being looked at. The high water mark of each entry and
+    of the total is the highest value seen in any sample.
+
+    The figures are estimates of the heap memory used, including the overhead
+    of the allocator for the many small allocations made for stitches. Data
+    that is implicitly shared is counted by each of the owners.
+    */
+
+
+#include "MemoryAccounting.h"
+
+#include <algorithm>
+
+#include <QDateTime>
+#include <QFile>
+#include <QImage>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTextStream>
+#include <QUndoCommand>
+#include <QUndoStack>
+
+#if defined(Q_OS_LINUX)
+#include <unistd.h>
+#endif
+
+
+class MemoryRecord
+{
+public:
+    const void              *owner;
+    QString                 group;
+    QString                 name;
+    std::function<qint64()> usage;
+    qint64                  highWaterMark;
+};
+
+
+class MemoryAccountingData
+{
+public:
+    MemoryAccountingData();
+
+    QMutex              mutex;
+    QList<MemoryRecord> records;
+    qint64              totalHighWaterMark;
+};
+
+
+Q_GLOBAL_STATIC(MemoryAccountingData, memoryAccountingData)
+
+
+/**
+    Constructor.
+    */
+MemoryAccountingData::MemoryAccountingData()
+    :   totalHighWaterMark(0)
+{
+}
+
+
+/**
+    Register a function that calculates the memory used by part of an object.
+    An owner can register several entries.
+    @param owner a pointer to the object owning the memory, used to remove the entries
+    @param group the name of the group the entry is shown in, such as the document name
+    @param name the name of the entry
+    @param usage a function returning the number of bytes used, this is called
+    with the accounting locked so it must not register or remove entries
+    */
+void MemoryAccounting::add(const void *owner, const QString &group, const QString &name, const std::function<qint64()> &usage)
+{
+    MemoryAccountingData *data = memoryAccountingData();
+    QMutexLocker locker(&data->mutex);
+
+    data->records.append({owner, group, name, usage, 0});
+}
+
+
+/**
+    Register a MemoryAccountable object.
+    @param accountable a pointer to the MemoryAccountable, this is also the owner
+    @param group the name of the group the entry is shown in
+    @param name the name of the entry
+    */
+void MemoryAccounting::add(const MemoryAccountable *accountable, const QString &group, const QString &name)
+{
+    add(accountable, group, name, [accountable]() {return accountable->memoryUsage();});
+}
+
+
+/**
+    Change the group of the entries of an owner, for example when a document
+    is renamed.
+    @param owner a pointer to the object owning the entries
+    @param group the name of the new group
+    */
+void MemoryAccounting::setGroup(const void *owner, const QString &group)
+{
+    MemoryAccountingData *data = memoryAccountingData();
+    QMutexLocker locker(&data->mutex);
+
+    for (MemoryRecord &record : data->records) {
+        if (record.owner == owner) {
+            record.group = group;
+        }
+    }
+}
+
+
+/**
+    Remove the entries of an owner, this must be called before the owner is destroyed.
+    @param owner a pointer to the object owning the entries
+    */
+void MemoryAccounting::remove(const void *owner)
+{
+    if (memoryAccountingData.isDestroyed()) {
+        return;     // static owners may be destroyed after the accounting data
+    }
+
+    MemoryAccountingData *data = memoryAccountingData();
+    QMutexLocker locker(&data->mutex);
+
+    for (int i = data->records.count() - 1 ; i >= 0 ; --i) {
+        if (data->records.at(i).owner == owner) {
+            data->records.removeAt(i);
+        }
+    }
+}
+
+
+/**
+    Calculate the memory used by all the registered entries and update the high
+    water marks.
+    @return a QList of the Entry for each registered entry, sorted by group and name
+    */
+QList<MemoryAccounting::Entry> MemoryAccounting::sample()
+{
+    MemoryAccountingData *data = memoryAccountingData();
+    QMutexLocker locker(&data->mutex);
+
+    QList<Entry> entries;
+    qint64 total = 0;
+
+    for (MemoryRecord &record : data->records) {
+        qint64 bytes = record.usage();
+        record.highWaterMark = std::max(record.highWaterMark, bytes);
+        total += bytes;
+
+        entries.append({record.group, record.name, bytes, record.highWaterMark});
+    }
+
+    data->totalHighWaterMark = std::max(data->totalHighWaterMark, total);
+
+    std::stable_sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return (a.group == b.group) ? (a.name < b.name) : (a.group < b.group);
+    });
+
+    return entries;
+}
+
+
+/**
+    Get the highest total of the registered entries seen in any sample.
+    @return the number of bytes
+    */
+qint64 MemoryAccounting::totalHighWaterMark()
+{
+    MemoryAccountingData *data = memoryAccountingData();
+    QMutexLocker locker(&data->mutex);
+
+    return data->totalHighWaterMark;
+}
+
+
+/**
+    Get the resident size of the process to compare with the accounted memory.
+    @return the number of bytes, or -1 if it is not available on this platform
+    */
+qint64 MemoryAccounting::residentSize()
+{
+#if defined(Q_OS_LINUX)
+    QFile statm(QStringLiteral("/proc/self/statm"));
+
+    if (statm.open(QIODevice::ReadOnly)) {
+        QList<QByteArray> fields = statm.readAll().split(' ');
+
+        if (fields.count() > 1) {
+            return fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE);
+        }
+    }
+#endif
+
+    return -1;
+}
+
+
+/**
+    Write a sample to a file as tab separated values.
+    @param fileName the name of the file to write, any existing file will be overwritten
+    @return true if the file was written, false otherwise
+    */
+bool MemoryAccounting::dump(const QString &fileName)
+{
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        return false;
+    }
+
+    QList<Entry> entries = sample();
+    qint64 total = 0;
+
+    QTextStream stream(&file);
+    stream << "# KXStitch memory usage " << QDateTime::currentDateTime().toString(Qt::ISODate) << "\n";
+    stream << "group\tname\tbytes\thigh water mark\n";
+
+    foreach (const Entry &entry, entries) {
+        stream << entry.group << '\t' << entry.name << '\t' << entry.bytes << '\t' << entry.highWaterMark << '\n';
+        total += entry.bytes;
+    }
+
+    stream << "Total\tAccounted\t" << total << '\t' << totalHighWaterMark() << '\n';
+    stream << "Total\tProcess resident\t" << residentSize() << "\t\n";
+
+    stream.flush();
+
+    return (stream.status() == QTextStream::Ok) && (file.error() == QFileDevice::NoError);
+}
+
+
+/**
+    Estimate the memory used by a heap allocation, including the allocator
+    overhead. This follows the 64 bit glibc allocator, which adds 8 bytes to
+    the request, rounds up to a multiple of 16 and allocates at least 32 bytes.
+    @param size the number of bytes requested
+    @return the number of bytes used
+    */
+qint64 MemoryAccounting::heapBlock(qint64 size)
+{
+    if (size <= 0) {
+        return 0;
+    }
+
+    return std::max(qint64(32), (size + 8 + 15) & ~qint64(15));
+}
+
+
+/**
+    Estimate the memory used by a QByteArray.
+    @param array a const reference to the QByteArray
+    @return the number of bytes used
+    */
+qint64 MemoryAccounting::byteArrayUsage(const QByteArray &array)
+{
+    return (array.capacity() == 0) ? 0 : heapBlock(sizeof(QArrayData) + array.capacity() + 1);
+}
+
+
+/**
+    Estimate the memory used by a QString.
+    @param string a const reference to the QString
+    @return the number of bytes used
+    */
+qint64 MemoryAccounting::stringUsage(const QString &string)
+{
+    return (string.capacity() == 0) ? 0 : heapBlock(sizeof(QArrayData) + (string.capacity() + 1) * sizeof(QChar));
+}
+
+
+/**
+    Get the memory used by the pixels of a QImage.
+    @param image a const reference to the QImage
+    @return the number of bytes used
+    */
+qint64 MemoryAccounting::imageUsage(const QImage &image)
+{
+    return image.isNull() ? 0 : qint64(image.bytesPerLine()) * image.height();
+}
+
+
+/**
+    Estimate the memory used by the commands in an undo stack.
+    @param stack a const reference to the QUndoStack
+    @return the number of bytes used
+    */
+qint64 MemoryAccounting::undoStackUsage(const QUndoStack &stack)
+{
+    qint64 usage = 0;
+
+    for (int i = 0 ; i < stack.count() ; ++i) {
+        usage += commandUsage(stack.command(i));
+    }
+
+    return usage;
+}
+
+
+/**
+    Estimate the memory used by a command and its children. Commands holding
+    stitches or saved pattern data implement MemoryAccountable to add it.
+    @param command a const pointer to the QUndoCommand
+    @return the number of bytes used
+    */
+qint64 MemoryAccounting::commandUsage(const QUndoCommand *command)
+{
+    if (command == nullptr) {
+        return 0;
+    }
+
+    qint64 usage = heapBlock(sizeof(QUndoCommand)) + stringUsage(command->text()) + stringUsage(command->actionText());
+
+    const MemoryAccountable *accountable = dynamic_cast<const MemoryAccountable *>(command);
+
+    if (accountable) {
+        usage += accountable->memoryUsage();
+    }
+
+    for (int i = 0 ; i < command->childCount() ; ++i) {
+        usage += commandUsage(command->child(i));
+    }
+
+    return usage;
+}
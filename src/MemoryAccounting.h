@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2026 by agent
+ * agent@local
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+#ifndef MemoryAccounting_H
+#define MemoryAccounting_H
+
+
+#include <functional>
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+
+class QImage;
+class QUndoCommand;
+class QUndoStack;
+
+
+class MemoryAccountable
+{
+public:
+    virtual ~MemoryAccountable() = default;
+
+    virtual qint64 memoryUsage() const = 0;
+};
+
+
+class MemoryAccounting
+{
+public:
+    class Entry
+    {
+    public:
+        QString group;
+        QString name;
+        qint64  bytes;
+        qint64  highWaterMark;
+    };
+
+    static void add(const void *, const QString &, const QString &, const std::function<qint64()> &);
+    static void add(const MemoryAccountable *, const QString &, const QString &);
+    static void setGroup(const void *, const QString &);
+    static void remove(const void *);
+
+    static QList<Entry> sample();
+    static qint64 totalHighWaterMark();
+    static qint64 residentSize();
+    static bool dump(const QString &);
+
+    static qint64 heapBlock(qint64);
+    static qint64 byteArrayUsage(const QByteArray &);
+    static qint64 stringUsage(const QString &);
+    static qint64 imageUsage(const QImage &);
+    static qint64 undoStackUsage(const QUndoStack &);
+    static qint64 commandUsage(const QUndoCommand *);
+};
+
+
+#endif // MemoryAccounting_H
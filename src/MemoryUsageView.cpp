@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2026 by agent
+ * agent@local
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+#include "MemoryUsageView.h"
+
+#include <QDir>
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLocale>
+#include <QPushButton>
+#include <QSet>
+#include <QTreeWidget>
+#include <QTreeWidgetItem>
+#include <QVBoxLayout>
+
+#include <KLocalizedString>
+#include <KMessageBox>
+
+#include "MemoryAccounting.h"
+
+
+MemoryUsageView::MemoryUsageView(QWidget *parent)
+    :   QWidget(parent),
+        m_tree(new QTreeWidget(this)),
+        m_total(new QLabel(this)),
+        m_resident(new QLabel(this))
+{
+    setObjectName(QStringLiteral("MemoryUsageView#"));
+
+    m_tree->setColumnCount(3);
+    m_tree->setHeaderLabels(QStringList() << i18n("Name") << i18n("Size") << i18n("High Water Mark"));
+    m_tree->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+    m_tree->header()->setSectionResizeMode(1, QHeaderView::ResizeToContents);
+    m_tree->header()->setSectionResizeMode(2, QHeaderView::ResizeToContents);
+    m_tree->header()->setStretchLastSection(false);
+    m_tree->setRootIsDecorated(true);
+    m_tree->setSelectionMode(QAbstractItemView::NoSelection);
+
+    QPushButton *dumpButton = new QPushButton(i18n("Dump..."), this);
+    connect(dumpButton, &QPushButton::clicked, this, &MemoryUsageView::dump);
+
+    QHBoxLayout *buttonLayout = new QHBoxLayout;
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(dumpButton);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->addWidget(m_tree);
+    layout->addWidget(m_total);
+    layout->addWidget(m_resident);
+    layout->addLayout(buttonLayout);
+
+    // the usage is only sampled while the view is visible
+    m_refreshTimer.setInterval(2000);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &MemoryUsageView::refresh);
+}
+
+
+void MemoryUsageView::refresh()
+{
+    QSet<QString> collapsedGroups;
+
+    for (int i = 0 ; i < m_tree->topLevelItemCount() ; ++i) {
+        QTreeWidgetItem *groupItem = m_tree->topLevelItem(i);
+
+        if (!groupItem->isExpanded()) {
+            collapsedGroups.insert(groupItem->text(0));
+        }
+    }
+
+    m_tree->clear();
+
+    QList<MemoryAccounting::Entry> entries = MemoryAccounting::sample();
+    QTreeWidgetItem *groupItem = nullptr;
+    qint64 groupBytes = 0;
+    qint64 groupHighWaterMark = 0;
+    qint64 total = 0;
+
+    foreach (const MemoryAccounting::Entry &entry, entries) {
+        if ((groupItem == nullptr) || (groupItem->text(0) != entry.group)) {
+            groupItem = new QTreeWidgetItem(m_tree, QStringList() << entry.group);
+            groupBytes = 0;
+            groupHighWaterMark = 0;
+        }
+
+        QTreeWidgetItem *item = new QTreeWidgetItem(groupItem, QStringList() << entry.name << formatBytes(entry.bytes) << formatBytes(entry.highWaterMark));
+        item->setTextAlignment(1, Qt::AlignRight);
+        item->setTextAlignment(2, Qt::AlignRight);
+
+        groupBytes += entry.bytes;
+        groupHighWaterMark += entry.highWaterMark;
+        total += entry.bytes;
+
+        groupItem->setText(1, formatBytes(groupBytes));
+        groupItem->setText(2, formatBytes(groupHighWaterMark));
+        groupItem->setTextAlignment(1, Qt::AlignRight);
+        groupItem->setTextAlignment(2, Qt::AlignRight);
+        groupItem->setExpanded(!collapsedGroups.contains(entry.group));
+    }
+
+    m_total->setText(i18n("Total: %1, high water mark: %2", formatBytes(total), formatBytes(MemoryAccounting::totalHighWaterMark())));
+
+    qint64 resident = MemoryAccounting::residentSize();
+    m_resident->setText((resident < 0) ? i18n("Process resident size: not available") : i18n("Process resident size: %1", formatBytes(resident)));
+}
+
+
+void MemoryUsageView::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+
+    refresh();
+    m_refreshTimer.start();
+}
+
+
+void MemoryUsageView::hideEvent(QHideEvent *event)
+{
+    m_refreshTimer.stop();
+
+    QWidget::hideEvent(event);
+}
+
+
+void MemoryUsageView::dump()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, i18n("Dump Memory Usage"), QDir::homePath() + QStringLiteral("/kxstitch-memory.tsv"), i18n("Tab Separated Values (*.tsv)"));
+
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    if (!MemoryAccounting::dump(fileName)) {
+        KMessageBox::error(this, i18n("Failed to write the memory usage to %1.", fileName), i18n("Failed to dump memory usage."));
+    }
+
+    refresh();
+}
+
+
+QString MemoryUsageView::formatBytes(qint64 bytes)
+{
+    return i18n("%1 KiB", QLocale().toString(bytes / 1024.0, 'f', 1));
+}
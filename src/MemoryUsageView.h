@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2026 by agent
+ * agent@local
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+#ifndef MemoryUsageView_H
+#define MemoryUsageView_H
+
+
+#include <QTimer>
+#include <QWidget>
+
+
+class QHideEvent;
+class QLabel;
+class QShowEvent;
+class QTreeWidget;
+
+
+class MemoryUsageView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit MemoryUsageView(QWidget *parent = nullptr);
+    virtual ~MemoryUsageView() = default;
+
+public slots:
+    void refresh();
+
+protected:
+    virtual void showEvent(QShowEvent *) Q_DECL_OVERRIDE;
+    virtual void hideEvent(QHideEvent *) Q_DECL_OVERRIDE;
+
+private slots:
+    void dump();
+
+private:
+    static QString formatBytes(qint64);
+
+    QTreeWidget *m_tree;
+    QLabel      *m_total;
+    QLabel      *m_resident;
+    QTimer      m_refreshTimer;
+};
+
+
+#endif // MemoryUsageView_H
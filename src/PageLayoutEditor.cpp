@@ -11,12 +11,14 @@
 
 #include "PageLayoutEditor.h"
 
+#include <QDataStream>
 #include <QMenu>
 #include <QMouseEvent>
 #include <QPainter>
 #include <QPointer>
 #include <QRubberBand>
 #include <QToolTip>
+#include <QUndoStack>
 
 #include <KLocalizedString>
 
@@ -50,6 +52,7 @@ PageLayoutEditor::PageLayoutEditor(QWidget *parent, Document *document)
     setMouseTracking(true);
 
     connect(this, &PageLayoutEditor::customContextMenuRequested, this, &PageLayoutEditor::contextMenuRequestedOn);
+    connect(&m_document->undoStack(), &QUndoStack::indexChanged, this, &PageLayoutEditor::clearElementCache);
 }
 
 
@@ -73,6 +76,8 @@ bool PageLayoutEditor::showGrid() const
 
 void PageLayoutEditor::setPagePreview(PagePreviewListWidgetItem *pagePreview)
 {
+    clearElementCache();
+
     if ((m_pagePreview = pagePreview)) {
         m_boundary.setElement(nullptr);
         show();
@@ -90,6 +95,7 @@ void PageLayoutEditor::updatePagePreview()
         m_paperHeight = m_pagePreview->paperHeight();
         setMinimumSize(scale(m_paperWidth), scale(m_paperHeight));
         resize(minimumSize());
+        clearElementCache();
         update();
     }
 }
@@ -104,6 +110,8 @@ void PageLayoutEditor::setZoomFactor(double zoomFactor)
         resize(minimumSize());
     }
 
+    clearElementCache();
+
     repaint();
 }
 
@@ -219,7 +227,7 @@ void PageLayoutEditor::paintEvent(QPaintEvent *event)
     painter.setRenderHint(QPainter::Antialiasing, true);
     painter.setWindow(0, 0, m_paperWidth, m_paperHeight);
 
-    m_pagePreview->page()->render(m_document, &painter);
+    renderElements(&painter);
 
     // draw snap grid
     if (m_showGrid) {
@@ -274,6 +282,127 @@ void PageLayoutEditor::contextMenuRequestedOn(const QPoint &pos)
 }
 
 
+/**
+    Discard the cached element images, called when the document has changed in a
+    way that may affect the rendering of any element, or when the page or the
+    zoom factor has changed.
+    */
+void PageLayoutEditor::clearElementCache()
+{
+    m_elementCache.clear();
+    update();
+}
+
+
+/**
+    Render the page margins and the elements of the page.
+    Each element is rendered once into an image at the device resolution and
+    the images are reused until the element, the document or the zoom changes,
+    so moving the rubber band or the selection boundary only repaints the
+    overlay and dragging an element only renders that element.
+    The images are rendered to a QImage, which means the elements will not draw
+    the guide lines used when rendering directly to the screen, so these are
+    drawn here.
+    @param painter a pointer to the QPainter with the window set to the paper size
+    */
+void PageLayoutEditor::renderElements(QPainter *painter)
+{
+    Page *page = m_pagePreview->page();
+
+    painter->save();
+
+    painter->setPen(QPen(Qt::red, 0.05));
+    painter->drawRect(painter->window().marginsRemoved(page->margins().toMargins()));
+
+    QPen guidePen(Qt::lightGray);
+    guidePen.setCosmetic(true);
+
+    QList<Element *> elements = page->elements();
+
+    foreach (const Element *element, m_elementCache.keys()) {
+        if (!elements.contains(const_cast<Element *>(element))) {
+            m_elementCache.remove(element);
+        }
+    }
+
+    foreach (const Element *element, elements) {
+        const CachedElement &cached = cachedElement(element);
+
+        painter->setViewTransformEnabled(false);
+        painter->drawImage(cached.deviceRect.topLeft(), cached.image);
+        painter->setViewTransformEnabled(true);
+
+        bool showBorder = true;
+
+        if (element->type() == Element::Key) {
+            showBorder = static_cast<const KeyElement *>(element)->showBorder();
+        } else if (element->type() == Element::Text) {
+            showBorder = static_cast<const TextElement *>(element)->showBorder();
+        }
+
+        if (!showBorder) {
+            painter->setPen(guidePen);
+            painter->setBrush(Qt::NoBrush);
+            painter->drawRect(element->rectangle());
+        }
+    }
+
+    painter->restore();
+}
+
+
+/**
+    Get the cached image of an element, rendering it if the element has not been
+    rendered before or has changed since it was rendered.
+    The element is rendered onto a transparent canvas the size of the widget so
+    that it sees the same device and window as it would when rendering directly
+    to the widget, the area it covers is then copied.
+    @param element a const pointer to the Element
+    @return a const reference to the CachedElement
+    */
+const CachedElement &PageLayoutEditor::cachedElement(const Element *element)
+{
+    QByteArray key;
+    QDataStream stream(&key, QIODevice::WriteOnly);
+    stream << *element;
+
+    CachedElement &cached = m_elementCache[element];
+
+    if (cached.key == key && !cached.image.isNull()) {
+        return cached;
+    }
+
+    if (m_elementCanvas.size() != size()) {
+        m_elementCanvas = QImage(size(), QImage::Format_ARGB32_Premultiplied);
+        m_elementCanvas.setDotsPerMeterX(qRound(logicalDpiX() / 0.0254));    // text elements scale fonts by the device resolution
+        m_elementCanvas.setDotsPerMeterY(qRound(logicalDpiY() / 0.0254));
+    }
+
+    QPainter painter(&m_elementCanvas);
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    painter.setWindow(0, 0, m_paperWidth, m_paperHeight);
+
+    // allow for borders drawn centred on the edges of the rectangle
+    QRect deviceRect = painter.combinedTransform().mapRect(element->rectangle().adjusted(-2, -2, 2, 2)).adjusted(-1, -1, 1, 1) & m_elementCanvas.rect();
+
+    painter.setViewTransformEnabled(false);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.fillRect(deviceRect, Qt::transparent);
+    painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+    painter.setClipRect(deviceRect);
+    painter.setViewTransformEnabled(true);
+
+    element->render(m_document, &painter);
+    painter.end();
+
+    cached.key = key;
+    cached.deviceRect = deviceRect;
+    cached.image = m_elementCanvas.copy(deviceRect);
+
+    return cached;
+}
+
+
 QPoint PageLayoutEditor::toSnap(const QPoint &pos) const
 {
     int scaledGridSize = scale(m_gridSize);
@@ -13,6 +13,9 @@
 #define PageLayoutEditor_H
 
 
+#include <QByteArray>
+#include <QHash>
+#include <QImage>
 #include <QWidget>
 
 #include "Boundary.h"
@@ -21,6 +24,16 @@
 class Document;
 class PagePreviewListWidgetItem;
 class QMouseEvent;
+class QPainter;
+
+
+class CachedElement
+{
+public:
+    QByteArray  key;            // the streamed element, changes if the geometry or any property changes
+    QRect       deviceRect;     // the area of the widget covered by the image
+    QImage      image;
+};
 
 
 class PageLayoutEditor : public QWidget
@@ -61,9 +74,12 @@ protected:
 
 private slots:
     void contextMenuRequestedOn(const QPoint &);
+    void clearElementCache();
 
 private:
     QPoint toSnap(const QPoint &) const;
+    void renderElements(QPainter *);
+    const CachedElement &cachedElement(const Element *);
 
     Document                    *m_document;
     PagePreviewListWidgetItem   *m_pagePreview;
@@ -84,6 +100,9 @@ private:
     bool    m_showGrid;
     int     m_gridSize;
     double  m_zoomFactor;
+
+    QHash<const Element *, CachedElement>   m_elementCache;
+    QImage                                  m_elementCanvas;
 };
 
 
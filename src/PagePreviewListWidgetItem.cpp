@@ -13,24 +13,48 @@
 
 #include <algorithm>
 
+#include <QDataStream>
+#include <QListWidget>
 #include <QPainter>
 #include <QPixmap>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QUndoStack>
+#include <QtConcurrent>
 
 #include <KLocalizedString>
 
+#include "Document.h"
 #include "Page.h"
 #include "PaperSizes.h"
+#include "PatternSnapshot.h"
+#include "SchemeManager.h"
+#include "SymbolManager.h"
+
+
+Q_GLOBAL_STATIC(QThreadPool, previewIconPool)
 
 
 PagePreviewListWidgetItem::PagePreviewListWidgetItem(Document *document, Page *page)
     :   QListWidgetItem(0, QListWidgetItem::UserType),
         m_document(document),
-        m_page(page)
+        m_page(page),
+        m_previewWatcher(new QFutureWatcher<QImage>)
 {
+    QObject::connect(m_previewWatcher, &QFutureWatcher<QImage>::finished, m_previewWatcher, [this]() {
+        setIcon(QPixmap::fromImage(m_previewWatcher->result()));
+    });
+
     generatePreviewIcon();
 }
 
 
+PagePreviewListWidgetItem::~PagePreviewListWidgetItem()
+{
+    delete m_previewWatcher;
+}
+
+
 QPageSize PagePreviewListWidgetItem::pageSize() const
 {
     return m_page->pageSize();
@@ -75,18 +99,82 @@ Page *PagePreviewListWidgetItem::page() const
 }
 
 
+/**
+    Generate the icon for the page list.
+    The icon is rendered at the icon size in a worker thread from copies of the
+    page, the document properties and a snapshot of the pattern, a placeholder
+    is shown until the first icon is available. The request is keyed by the
+    contents of the page and the revision of the document, so calling this
+    when nothing has changed since the last request does nothing.
+    */
 void PagePreviewListWidgetItem::generatePreviewIcon()
 {
     m_paperWidth = PageSizes::width(m_page->pageSize().id(), m_page->orientation());
     m_paperHeight = PageSizes::height(m_page->pageSize().id(), m_page->orientation());
 
-    QPixmap pixmap(m_paperWidth, m_paperHeight);
-    pixmap.fill(Qt::white);
+    // the page list in the PrintSetupDlg uses 140 x 140 icons
+    QSize iconSize = (listWidget()) ? listWidget()->iconSize() : QSize(140, 140);
+    iconSize = QSize(m_paperWidth, m_paperHeight).scaled(iconSize, Qt::KeepAspectRatio);
+
+    QByteArray key;
+    QDataStream stream(&key, QIODevice::WriteOnly);
+    stream << *m_page << qint32(m_document->undoStack().index()) << iconSize;
+
+    if (key == m_previewKey) {
+        return;
+    }
+
+    m_previewKey = key;
+
+    // schemes and symbol libraries are loaded on first use, make sure that happens in this thread
+    SchemeManager::scheme(m_document->pattern()->palette().schemeName());
+    SymbolManager::library(m_document->pattern()->palette().symbolLibrary());
+
+    if (icon().isNull()) {
+        QPixmap placeholder(iconSize);
+        placeholder.fill(Qt::white);
+        setIcon(placeholder);
+    }
+
+    m_previewWatcher->setFuture(QtConcurrent::run(previewIconPool(), &PagePreviewListWidgetItem::renderPreviewIcon, m_document->properties(), m_document->pattern()->snapshot(), QSharedPointer<Page>(new Page(*m_page)), iconSize));
+}
+
+
+/**
+    Wait for any icons being rendered to finish, this should be called before
+    the document is destroyed.
+    */
+void PagePreviewListWidgetItem::waitForPreviewIcons()
+{
+    previewIconPool()->waitForDone();
+}
+
+
+/**
+    Render a page to an image, this is called in a worker thread.
+    The page is rendered with a document created from the copies so that
+    nothing is read from the document being edited. Taking the snapshot only
+    copies the parts of the pattern changed since the previous one, the
+    pattern rendered is built from it here rather than in the GUI thread.
+    @param properties a copy of the document properties
+    @param snapshot a PatternSnapshot of the pattern
+    @param page a shared pointer to a copy of the Page, the original may be changed while this is running
+    @param size the size of the image
+    @return a QImage of the rendered page
+    */
+QImage PagePreviewListWidgetItem::renderPreviewIcon(QMap<QString, QVariant> properties, PatternSnapshot snapshot, QSharedPointer<Page> page, QSize size)
+{
+    Document document(properties, new Pattern(snapshot));
+
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::white);
 
     QPainter painter;
-    painter.begin(&pixmap);
+    painter.begin(&image);
     painter.setRenderHint(QPainter::Antialiasing, true);
-    m_page->render(m_document, &painter);
+    painter.setWindow(0, 0, PageSizes::width(page->pageSize().id(), page->orientation()), PageSizes::height(page->pageSize().id(), page->orientation()));
+    page->render(&document, &painter);
     painter.end();
-    setIcon(pixmap);
+
+    return image;
 }
@@ -13,19 +13,26 @@
 #define PagePreviewListWidgetItem_H
 
 
+#include <QByteArray>
+#include <QFutureWatcher>
+#include <QImage>
 #include <QListWidgetItem>
+#include <QMap>
 #include <QPrinter>
+#include <QSharedPointer>
+#include <QVariant>
 
 
 class Document;
 class Page;
+class PatternSnapshot;
 
 
 class PagePreviewListWidgetItem : public QListWidgetItem
 {
 public:
     PagePreviewListWidgetItem(Document *, Page *);
-    virtual ~PagePreviewListWidgetItem() = default;
+    virtual ~PagePreviewListWidgetItem();
 
     QPageSize pageSize() const;
     QPageLayout::Orientation orientation() const;
@@ -38,12 +45,18 @@ public:
     Page *page() const;
     void generatePreviewIcon();
 
+    static void waitForPreviewIcons();
+
 private:
+    static QImage renderPreviewIcon(QMap<QString, QVariant>, PatternSnapshot, QSharedPointer<Page>, QSize);
 
     Document    *m_document;
     Page        *m_page;
     int         m_paperWidth;
     int         m_paperHeight;
+
+    QByteArray              m_previewKey;       // the page contents and document revision the icon was requested for
+    QFutureWatcher<QImage>  *m_previewWatcher;
 };
 
 
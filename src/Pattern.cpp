@@ -11,9 +11,12 @@
 
 #include "Pattern.h"
 
+#include <QHash>
+
 #include <KLocalizedString>
 
 #include "Exceptions.h"
+#include "PatternSnapshot.h"
 
 
 Pattern::Pattern(Document *document)
@@ -22,6 +25,35 @@ Pattern::Pattern(Document *document)
 }
 
 
+// copy the contents of a snapshot, this can be done in a worker thread while the original pattern is being changed
+Pattern::Pattern(const PatternSnapshot &snapshot)
+    :   m_document(nullptr),
+        m_documentPalette(snapshot.palette())
+{
+    const StitchDataSnapshot &stitches = snapshot.stitches();
+
+    m_stitchData.resize(stitches.width(), stitches.height());
+
+    for (int y = 0 ; y < stitches.height() ; ++y) {
+        for (int x = 0 ; x < stitches.width() ; ++x) {
+            const StitchQueue *stitchQueue = stitches.stitchQueueAt(x, y);
+
+            if (stitchQueue) {
+                m_stitchData.replaceStitchQueueAt(x, y, new StitchQueue(stitchQueue));
+            }
+        }
+    }
+
+    foreach (const Backstitch &backstitch, stitches.backstitches()) {
+        m_stitchData.addBackstitch(backstitch.start, backstitch.end, backstitch.colorIndex);
+    }
+
+    foreach (const Knot &knot, stitches.knots()) {
+        m_stitchData.addFrenchKnot(knot.position, knot.colorIndex);
+    }
+}
+
+
 void Pattern::clear()
 {
     m_documentPalette = DocumentPalette();
@@ -108,33 +140,39 @@ Pattern *Pattern::cut(const QRect &area, int colorMask, const QList<Stitch::Type
 
     QRect snapArea(area.left() * 2, area.top() * 2, area.width() * 2, area.height() * 2);
 
+    // the matching backstitches and knots are found first and then taken, which marks the
+    // areas they covered as changed so that they are removed from the views
     if (!excludeBackstitches) {
-        QMutableListIterator<Backstitch *> mutableListIterator = stitches().mutableBackstitchIterator();
-
-        while (mutableListIterator.hasNext()) {
-            Backstitch *backstitch = mutableListIterator.next();
+        QList<Backstitch *> cutBackstitches;
 
+        foreach (Backstitch *backstitch, stitches().backstitches()) {
             if (((colorMask == -1) || (colorMask == backstitch->colorIndex)) && (snapArea.contains(backstitch->start) && snapArea.contains(backstitch->end))) {
-                mutableListIterator.remove();
-                backstitch->start -= snapArea.topLeft();
-                backstitch->end -= snapArea.topLeft();
-                pattern->stitches().addBackstitch(backstitch);
+                cutBackstitches.append(backstitch);
             }
         }
+
+        foreach (Backstitch *backstitch, cutBackstitches) {
+            stitches().takeBackstitch(backstitch);
+            backstitch->start -= snapArea.topLeft();
+            backstitch->end -= snapArea.topLeft();
+            pattern->stitches().addBackstitch(backstitch);
+        }
     }
 
     if (!excludeKnots) {
-        QMutableListIterator<Knot *> mutableListIterator = stitches().mutableKnotIterator();
-
-        while (mutableListIterator.hasNext()) {
-            Knot *knot = mutableListIterator.next();
+        QList<Knot *> cutKnots;
 
+        foreach (Knot *knot, stitches().knots()) {
             if (((colorMask == -1) || (colorMask == knot->colorIndex)) && (snapArea.contains(knot->position))) {
-                mutableListIterator.remove();
-                knot->position -= snapArea.topLeft();
-                pattern->stitches().addFrenchKnot(knot);
+                cutKnots.append(knot);
             }
         }
+
+        foreach (Knot *knot, cutKnots) {
+            stitches().takeFrenchKnot(knot);
+            knot->position -= snapArea.topLeft();
+            pattern->stitches().addFrenchKnot(knot);
+        }
     }
 
     constructPalette(pattern);
@@ -209,7 +247,22 @@ Pattern *Pattern::copy(const QRect &area,  int colorMask, const QList<Stitch::Ty
 
 void Pattern::paste(Pattern *pattern, const QPoint &cell, bool merge)
 {
-    pattern->palette().setSchemeName(palette().schemeName());
+    // the colors of the pasted pattern are matched to the document palette the
+    // first time each one is used rather than for every stitch, which matters for
+    // repeated pastes such as the characters added by the alphabet tool.
+    // DocumentPalette::add converts colors to the document scheme, so the pasted
+    // pattern, which may be shared with the clipboard, is not modified
+    QMap<int, DocumentFloss *> pasteFlosses = pattern->palette().flosses();
+    QHash<int, int> colorIndexes;
+    auto documentColorIndex = [&](int pasteColorIndex) {
+        QHash<int, int>::const_iterator i = colorIndexes.constFind(pasteColorIndex);
+
+        if (i == colorIndexes.constEnd()) {
+            i = colorIndexes.insert(pasteColorIndex, palette().add(pasteFlosses.value(pasteColorIndex)->flossColor()));
+        }
+
+        return i.value();
+    };
 
     for (int row = 0 ; row < pattern->stitches().height() ; ++row) {
         for (int col = 0 ; col < pattern->stitches().width() ; ++col) {
@@ -233,8 +286,7 @@ void Pattern::paste(Pattern *pattern, const QPoint &cell, bool merge)
 
                 while (stitchIterator.hasNext()) {
                     Stitch *stitch = stitchIterator.next();
-                    int colorIndex = palette().add(pattern->palette().flosses().value(stitch->colorIndex)->flossColor());
-                    dstQ->add(stitch->type, colorIndex);
+                    dstQ->add(stitch->type, documentColorIndex(stitch->colorIndex));
                 }
             }
 
@@ -249,7 +301,7 @@ void Pattern::paste(Pattern *pattern, const QPoint &cell, bool merge)
 
     while (backstitchIterator.hasNext()) {
         Backstitch *backstitch = backstitchIterator.next();
-        int colorIndex = palette().add(pattern->palette().flosses().value(backstitch->colorIndex)->flossColor());
+        int colorIndex = documentColorIndex(backstitch->colorIndex);
 
         if (snapArea.contains(backstitch->start + targetOffset) && snapArea.contains(backstitch->end + targetOffset)) {
             stitches().addBackstitch(backstitch->start + targetOffset, backstitch->end + targetOffset, colorIndex);
@@ -260,7 +312,7 @@ void Pattern::paste(Pattern *pattern, const QPoint &cell, bool merge)
 
     while (knotIterator.hasNext()) {
         Knot *knot = knotIterator.next();
-        int colorIndex = palette().add(pattern->palette().flosses().value(knot->colorIndex)->flossColor());
+        int colorIndex = documentColorIndex(knot->colorIndex);
 
         if (snapArea.contains(knot->position + targetOffset)) {
             stitches().addFrenchKnot(knot->position + targetOffset, colorIndex);
@@ -269,6 +321,16 @@ void Pattern::paste(Pattern *pattern, const QPoint &cell, bool merge)
 }
 
 
+PatternSnapshot Pattern::snapshot()
+{
+    PatternSnapshot snapshot;
+    snapshot.m_documentPalette = m_documentPalette;     // implicitly shared
+    snapshot.m_stitchData = m_stitchData.snapshot();
+
+    return snapshot;
+}
+
+
 QDataStream &operator<<(QDataStream &stream, const Pattern &pattern)
 {
     stream << qint32(pattern.version);
@@ -18,12 +18,14 @@
 
 
 class Document;
+class PatternSnapshot;
 
 
 class Pattern
 {
 public:
     explicit Pattern(Document *document = nullptr);
+    explicit Pattern(const PatternSnapshot &);
 
     void clear();
 
@@ -35,6 +37,8 @@ public:
     Pattern *copy(const QRect &area, int colorMask, const QList<Stitch::Type> &stitchMask, bool excludeBackstitches, bool excludeKnots);
     void paste(Pattern *pattern, const QPoint &cell, bool merge);
 
+    PatternSnapshot snapshot();
+
     friend QDataStream &operator<<(QDataStream &stream, const Pattern &pattern);
     friend QDataStream &operator>>(QDataStream &stream, Pattern &pattern);
 
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2026 by agent
+ * agent@local
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+/**
+    @file
+    Implement the PatternMimeData class used for cut, copy and paste of
+    patterns within the application.
+    The copied pattern is held directly and shared with anything pasting
+    it, it is only serialized to the application/kxstitch format if another
+    application, or a part of this one that needs its own copy, asks for the
+    data. Patterns held by a PatternMimeData are not modified after they
+    have been placed on the clipboard.
+    */
+
+
+#include "PatternMimeData.h"
+
+#include <QDataStream>
+
+#include "Pattern.h"
+
+
+/**
+    Constructor.
+    @param pattern a shared pointer to the Pattern, this should not be changed
+    after the mime data is created
+    */
+PatternMimeData::PatternMimeData(const QSharedPointer<Pattern> &pattern)
+    :   QMimeData(),
+        m_pattern(pattern)
+{
+}
+
+
+/**
+    Get the pattern held by the mime data.
+    @return a shared pointer to the Pattern
+    */
+QSharedPointer<Pattern> PatternMimeData::pattern() const
+{
+    return m_pattern;
+}
+
+
+/**
+    Get the formats available, only the application/kxstitch format is provided.
+    @return a QStringList of mime types
+    */
+QStringList PatternMimeData::formats() const
+{
+    return QStringList(QStringLiteral("application/kxstitch"));
+}
+
+
+/**
+    Get a pattern from mime data, sharing the pattern if the mime data was
+    created by this application or decoding it from the application/kxstitch
+    data otherwise.
+    @param mimeData a pointer to the QMimeData
+    @return a shared pointer to the Pattern, this will be null if there is no
+    pattern in the mime data
+    */
+QSharedPointer<Pattern> PatternMimeData::fromMimeData(const QMimeData *mimeData)
+{
+    QSharedPointer<Pattern> pattern;
+
+    const PatternMimeData *patternMimeData = qobject_cast<const PatternMimeData *>(mimeData);
+
+    if (patternMimeData) {
+        pattern = patternMimeData->pattern();
+    } else if (mimeData && mimeData->hasFormat(QStringLiteral("application/kxstitch"))) {
+        QByteArray data = mimeData->data(QStringLiteral("application/kxstitch"));
+        QDataStream stream(&data, QIODevice::ReadOnly);
+        pattern = QSharedPointer<Pattern>(new Pattern);
+        stream >> *pattern;
+    }
+
+    return pattern;
+}
+
+
+/**
+    Serialize the pattern the first time the data is requested, subsequent
+    requests return the same data.
+    @param mimeType the requested mime type
+    @param type the requested QVariant type
+    @return a QVariant containing a QByteArray of the serialized pattern, an
+    invalid QVariant if the mime type is not supported
+    */
+QVariant PatternMimeData::retrieveData(const QString &mimeType, QVariant::Type type) const
+{
+    if (mimeType != QLatin1String("application/kxstitch") || m_pattern.isNull()) {
+        return QMimeData::retrieveData(mimeType, type);
+    }
+
+    if (m_data.isEmpty()) {
+        QDataStream stream(&m_data, QIODevice::WriteOnly);
+        stream << *m_pattern;
+    }
+
+    return m_data;
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2026 by agent
+ * agent@local
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+#ifndef PatternMimeData_H
+#define PatternMimeData_H
+
+
+#include <QByteArray>
+#include <QMimeData>
+#include <QSharedPointer>
+#include <QStringList>
+
+
+class Pattern;
+
+
+class PatternMimeData : public QMimeData
+{
+    Q_OBJECT
+
+public:
+    explicit PatternMimeData(const QSharedPointer<Pattern> &);
+
+    QSharedPointer<Pattern> pattern() const;
+
+    QStringList formats() const Q_DECL_OVERRIDE;
+
+    static QSharedPointer<Pattern> fromMimeData(const QMimeData *);
+
+protected:
+    QVariant retrieveData(const QString &, QVariant::Type) const Q_DECL_OVERRIDE;
+
+private:
+    QSharedPointer<Pattern> m_pattern;
+    mutable QByteArray      m_data;
+};
+
+
+#endif // PatternMimeData_H
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2026 by agent
+ * agent@local
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+/**
+    @file
+    Implement the PatternSnapshot class and its parts.
+    A snapshot is a read only copy of a pattern that can be kept by a background
+    job, such as saving, exporting or printing, while the pattern continues to be
+    edited. Nothing in a snapshot is modified after it has been created, so it can
+    be read from any thread without locking.
+    The stitches are held in square tiles that are shared between snapshots, only
+    the tiles that have changed since the previous snapshot are copied when a new
+    one is taken, see StitchData::snapshot. The palette is implicitly shared and
+    is only copied when the document palette is next changed.
+    */
+
+
+#include "PatternSnapshot.h"
+
+
+/**
+    Constructor.
+    All the cells of the tile are initially empty.
+    */
+StitchTile::StitchTile()
+    :   stitchQueues(StitchDataSnapshot::tileSize * StitchDataSnapshot::tileSize, nullptr)
+{
+}
+
+
+/**
+    Destructor.
+    The tile owns its StitchQueues which are copies of those in the StitchData.
+    */
+StitchTile::~StitchTile()
+{
+    qDeleteAll(stitchQueues);
+}
+
+
+/**
+    Constructor.
+    Creates an empty snapshot.
+    */
+StitchDataSnapshot::StitchDataSnapshot()
+    :   m_width(0),
+        m_height(0),
+        m_backstitches(new QVector<Backstitch>),
+        m_knots(new QVector<Knot>)
+{
+}
+
+
+/**
+    Get the width of the pattern when the snapshot was taken.
+    @return the width in cells
+    */
+int StitchDataSnapshot::width() const
+{
+    return m_width;
+}
+
+
+/**
+    Get the height of the pattern when the snapshot was taken.
+    @return the height in cells
+    */
+int StitchDataSnapshot::height() const
+{
+    return m_height;
+}
+
+
+/**
+    Get the stitches in a cell.
+    @param x the column of the cell
+    @param y the row of the cell
+    @return a pointer to a const StitchQueue, this will be null if the cell is
+    empty or outside the pattern
+    */
+const StitchQueue *StitchDataSnapshot::stitchQueueAt(int x, int y) const
+{
+    if ((x < 0) || (x >= m_width) || (y < 0) || (y >= m_height)) {
+        return nullptr;
+    }
+
+    int columns = (m_width + tileSize - 1) / tileSize;
+    const QSharedPointer<const StitchTile> &tile = m_tiles.at((y / tileSize) * columns + (x / tileSize));
+
+    return (tile.isNull()) ? nullptr : tile->stitchQueues.at((y % tileSize) * tileSize + (x % tileSize));
+}
+
+
+/**
+    Get the stitches in a cell.
+    @param cell a QPoint representing the cell
+    @return a pointer to a const StitchQueue, this will be null if the cell is
+    empty or outside the pattern
+    */
+const StitchQueue *StitchDataSnapshot::stitchQueueAt(const QPoint &cell) const
+{
+    return stitchQueueAt(cell.x(), cell.y());
+}
+
+
+/**
+    Get the backstitches.
+    @return a const reference to a QVector of Backstitch
+    */
+const QVector<Backstitch> &StitchDataSnapshot::backstitches() const
+{
+    return *m_backstitches;
+}
+
+
+/**
+    Get the french knots.
+    @return a const reference to a QVector of Knot
+    */
+const QVector<Knot> &StitchDataSnapshot::knots() const
+{
+    return *m_knots;
+}
+
+
+/**
+    Constructor.
+    Creates an empty snapshot, use Pattern::snapshot to take a snapshot of a pattern.
+    */
+PatternSnapshot::PatternSnapshot()
+{
+}
+
+
+/**
+    Get the palette of the pattern when the snapshot was taken.
+    @return a const reference to the DocumentPalette
+    */
+const DocumentPalette &PatternSnapshot::palette() const
+{
+    return m_documentPalette;
+}
+
+
+/**
+    Get the stitches of the pattern when the snapshot was taken.
+    @return a const reference to the StitchDataSnapshot
+    */
+const StitchDataSnapshot &PatternSnapshot::stitches() const
+{
+    return m_stitchData;
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2026 by agent
+ * agent@local
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+#ifndef PatternSnapshot_H
+#define PatternSnapshot_H
+
+
+#include <QPoint>
+#include <QSharedPointer>
+#include <QVector>
+
+#include "DocumentPalette.h"
+#include "Stitch.h"
+
+
+class StitchTile
+{
+public:
+    StitchTile();
+    ~StitchTile();
+
+    QVector<StitchQueue *>  stitchQueues;
+
+private:
+    Q_DISABLE_COPY(StitchTile)
+};
+
+
+class StitchDataSnapshot
+{
+public:
+    StitchDataSnapshot();
+
+    int width() const;
+    int height() const;
+
+    const StitchQueue *stitchQueueAt(int, int) const;
+    const StitchQueue *stitchQueueAt(const QPoint &) const;
+
+    const QVector<Backstitch> &backstitches() const;
+    const QVector<Knot> &knots() const;
+
+    static const int tileSize = 64;
+
+private:
+    friend class StitchData;
+
+    int m_width;
+    int m_height;
+
+    QVector<QSharedPointer<const StitchTile> >  m_tiles;
+    QSharedPointer<const QVector<Backstitch> >  m_backstitches;
+    QSharedPointer<const QVector<Knot> >        m_knots;
+};
+
+
+class PatternSnapshot
+{
+public:
+    PatternSnapshot();
+
+    const DocumentPalette &palette() const;
+    const StitchDataSnapshot &stitches() const;
+
+private:
+    friend class Pattern;
+
+    DocumentPalette     m_documentPalette;
+    StitchDataSnapshot  m_stitchData;
+};
+
+
+#endif // PatternSnapshot_H
@@ -16,8 +16,12 @@
 #include <QScrollArea>
 #include <QStyleOptionRubberBand>
 
+#include <KLocalizedString>
+
 #include "configuration.h"
 #include "Document.h"
+#include "MemoryAccounting.h"
+#include "Trace.h"
 
 
 Preview::Preview(QWidget *parent)
@@ -29,6 +33,18 @@ Preview::Preview(QWidget *parent)
     m_renderer.setRenderStitchesAs(Configuration::EnumRenderer_RenderStitchesAs::ColorBlocks);
     m_renderer.setRenderBackstitchesAs(Configuration::EnumRenderer_RenderBackstitchesAs::ColorLines);
     m_renderer.setRenderKnotsAs(Configuration::EnumRenderer_RenderKnotsAs::ColorBlocks);
+    m_renderer.setLevelOfDetail(Configuration::renderer_SimplifiedStitchesCellSize(), Configuration::renderer_SimplifiedGridCellSize());
+    m_renderer.setMultithreaded(Configuration::renderer_Multithreaded());
+
+    MemoryAccounting::add(this, i18n("Views"), i18n("Preview cache"), [this]() {
+        return MemoryAccounting::imageUsage(m_cachedContents);
+    });
+}
+
+
+Preview::~Preview()
+{
+    MemoryAccounting::remove(this);
 }
 
 
@@ -68,6 +84,8 @@ void Preview::setVisibleCells(const QRect &cells)
 
 void Preview::loadSettings()
 {
+    m_renderer.setLevelOfDetail(Configuration::renderer_SimplifiedStitchesCellSize(), Configuration::renderer_SimplifiedGridCellSize());
+    m_renderer.setMultithreaded(Configuration::renderer_Multithreaded());
     drawContents();
 }
 
@@ -113,6 +131,9 @@ void Preview::drawContents()
         return;
     }
 
+    TraceScope trace("preview", "Preview::drawContents");
+    trace.addArgument("cells", m_document->pattern()->stitches().width() * m_document->pattern()->stitches().height());
+
     m_cachedContents.fill(m_document->property(QStringLiteral("fabricColor")).value<QColor>());
 
     QPainter painter(&m_cachedContents);
@@ -126,6 +147,30 @@ void Preview::drawContents()
 }
 
 
+void Preview::drawContents(const QRect &cells)
+{
+    if ((m_document == nullptr) || (m_cachedContents.isNull())) {
+        return;
+    }
+
+    TraceScope trace("preview", "Preview::drawContents");
+    trace.addArgument("cells", cells.width() * cells.height());
+
+    QPainter painter(&m_cachedContents);
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    painter.setWindow(0, 0, m_document->pattern()->stitches().width(), m_document->pattern()->stitches().height());
+    painter.setClipRect(cells);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.fillRect(cells, m_document->property(QStringLiteral("fabricColor")).value<QColor>());
+    painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+
+    m_renderer.render(&painter, m_document->pattern(), cells, false, true, true, true, -1);
+
+    painter.end();
+    update();
+}
+
+
 void Preview::paintEvent(QPaintEvent *)
 {
     if (m_cachedContents.isNull()) {
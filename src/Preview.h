@@ -28,13 +28,14 @@ class Preview : public QWidget
 
 public:
     explicit Preview(QWidget *);
-    virtual ~Preview() = default;
+    virtual ~Preview();
 
     void setDocument(Document *);
     Document *document();
 
     void readDocumentSettings();
     void drawContents();
+    void drawContents(const QRect &);
 
 public slots:
     void setVisibleCells(const QRect &);
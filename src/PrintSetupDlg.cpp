@@ -87,6 +87,7 @@ PrintSetupDlg::PrintSetupDlg(QWidget *parent, Document *document, QPrinter *prin
 PrintSetupDlg::~PrintSetupDlg()
 {
     delete m_pageLayoutEditor;
+    PagePreviewListWidgetItem::waitForPreviewIcons();
 }
 
 
@@ -0,0 +1,385 @@
+/*
+ * Copyright (C) 2026 by agent
+ * agent@local
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+/**
+    @file
+    Implement the Rasterizer class used by the shape and text tools.
+    Shapes are converted directly to horizontal spans of cells rather than
+    being painted onto a document sized bitmap which then has to be scanned,
+    so the work done is proportional to the size of the shape rather than
+    the size of the pattern. Monochrome images, such as rendered text, are
+    converted to the same spans a word at a time.
+    */
+
+
+#include "Rasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include <QtAlgorithms>
+#include <QtEndian>
+
+
+/**
+    Constructor.
+    */
+Span::Span()
+    :   row(0),
+        left(0),
+        right(-1)
+{
+}
+
+
+/**
+    Constructor.
+    @param r the row of the span
+    @param x1 the first set cell of the span
+    @param x2 the last set cell of the span
+    */
+Span::Span(int r, int x1, int x2)
+    :   row(r),
+        left(x1),
+        right(x2)
+{
+}
+
+
+/**
+    Constructor.
+    @param bounds the area that spans will be clipped to, typically the pattern
+    size in cells or half cells.
+    */
+Rasterizer::Rasterizer(const QRect &bounds)
+    :   m_bounds(bounds)
+{
+}
+
+
+/**
+    Draw a line between two points inclusive using Bresenham's algorithm.
+    @param from the start point
+    @param to the end point
+    */
+void Rasterizer::drawLine(const QPoint &from, const QPoint &to)
+{
+    int x = from.x();
+    int y = from.y();
+    int dx = std::abs(to.x() - x);
+    int dy = -std::abs(to.y() - y);
+    int sx = (x < to.x()) ? 1 : -1;
+    int sy = (y < to.y()) ? 1 : -1;
+    int err = dx + dy;
+
+    int runStart = x;   // consecutive points on the same row are emitted as a single span
+
+    forever {
+        if (x == to.x() && y == to.y()) {
+            break;
+        }
+
+        int e2 = 2 * err;
+
+        if (e2 <= dx) {
+            addSpan(y, std::min(runStart, x), std::max(runStart, x));
+            err += dx;
+            y += sy;
+
+            if (e2 >= dy) {
+                err += dy;
+                x += sx;
+            }
+
+            runStart = x;
+        } else {
+            err += dy;
+            x += sx;
+        }
+    }
+
+    addSpan(y, std::min(runStart, x), std::max(runStart, x));
+}
+
+
+/**
+    Draw the outline of an ellipse that fits the rectangle.
+    @param rect the bounding rectangle of the ellipse, all edges inclusive
+    */
+void Rasterizer::drawEllipse(const QRect &rect)
+{
+    traceEllipse(rect.normalized(), false);
+}
+
+
+/**
+    Draw a filled ellipse that fits the rectangle.
+    @param rect the bounding rectangle of the ellipse, all edges inclusive
+    */
+void Rasterizer::fillEllipse(const QRect &rect)
+{
+    traceEllipse(rect.normalized(), true);
+}
+
+
+/**
+    Draw a filled polygon including its outline.
+    The interior is found with an odd even scanline fill sampled through the
+    middle of each row, the outline is then added so that the shape matches
+    what would have been drawn with a pen and brush.
+    @param polygon the polygon points, the polygon is closed automatically
+    */
+void Rasterizer::fillPolygon(const QPolygon &polygon)
+{
+    int points = polygon.count();
+
+    if (points == 0) {
+        return;
+    }
+
+    QRect extents = polygon.boundingRect() & m_bounds;
+    QVector<double> crossings;
+
+    for (int y = extents.top() ; y <= extents.bottom() ; ++y) {
+        double scanline = y + 0.5;
+        crossings.clear();
+
+        for (int i = 0 ; i < points ; ++i) {
+            QPoint p1 = polygon.at(i);
+            QPoint p2 = polygon.at((i + 1) % points);
+
+            if (p1.y() == p2.y()) {
+                continue;
+            }
+
+            if (scanline < std::min(p1.y(), p2.y()) || scanline >= std::max(p1.y(), p2.y())) {
+                continue;
+            }
+
+            crossings.append(p1.x() + (scanline - p1.y()) * (p2.x() - p1.x()) / (p2.y() - p1.y()));
+        }
+
+        std::sort(crossings.begin(), crossings.end());
+
+        for (int i = 0 ; i + 1 < crossings.count() ; i += 2) {
+            addSpan(y, int(std::floor(crossings.at(i) + 0.5)), int(std::floor(crossings.at(i + 1) + 0.5)));
+        }
+    }
+
+    for (int i = 0 ; i < points ; ++i) {
+        drawLine(polygon.at(i), polygon.at((i + 1) % points));
+    }
+}
+
+
+/**
+    Add the set pixels of a monochrome image, such as the text rendered by the
+    TextToolDlg, as spans.
+    The scanlines are read 64 pixels at a time so that empty areas can be
+    skipped a word at a time, runs of set pixels are found by counting the
+    trailing zero and one bits of each word.
+    @param image the image to add, pixels with an index of 1 are treated as set
+    @param offset the position of the top left of the image in the bounds
+    */
+void Rasterizer::addImage(const QImage &image, const QPoint &offset)
+{
+    QImage mono = (image.format() == QImage::Format_MonoLSB) ? image : image.convertToFormat(QImage::Format_MonoLSB);
+    int width = mono.width();
+    int bytesPerLine = (width + 7) / 8;
+
+    for (int y = 0 ; y < mono.height() ; ++y) {
+        const uchar *scanline = mono.constScanLine(y);
+        int row = y + offset.y();
+        int runStart = -1;
+
+        for (int byte = 0 ; byte < bytesPerLine ; byte += 8) {
+            quint64 word;
+
+            if (bytesPerLine - byte >= 8) {
+                word = qFromLittleEndian<quint64>(scanline + byte);
+            } else {
+                word = 0;
+
+                for (int i = 0 ; i < bytesPerLine - byte ; ++i) {
+                    word |= quint64(scanline[byte + i]) << (i * 8);
+                }
+            }
+
+            int base = byte * 8;
+
+            if (width - base < 64) {
+                word &= (Q_UINT64_C(1) << (width - base)) - 1; // discard the padding bits at the end of the scanline
+            }
+
+            if (word == ~Q_UINT64_C(0)) {
+                if (runStart == -1) {
+                    runStart = base;
+                }
+
+                continue;
+            }
+
+            int bit = 0;
+
+            while (bit < 64) {
+                if (runStart == -1) {
+                    quint64 remaining = word >> bit;
+
+                    if (remaining == 0) {
+                        break;
+                    }
+
+                    bit += qCountTrailingZeroBits(remaining);
+                    runStart = base + bit;
+                }
+
+                quint64 remaining = ~(word >> bit);
+
+                if (bit > 0) {
+                    remaining &= (Q_UINT64_C(1) << (64 - bit)) - 1;    // bits shifted in from the top are not part of the run
+                }
+
+                if (remaining == 0) {
+                    break;  // the run continues into the next word
+                }
+
+                bit += qCountTrailingZeroBits(remaining);
+                addSpan(row, runStart + offset.x(), base + bit - 1 + offset.x());
+                runStart = -1;
+            }
+        }
+
+        if (runStart != -1) {
+            addSpan(row, runStart + offset.x(), width - 1 + offset.x());
+        }
+    }
+}
+
+
+/**
+    Get the spans generated so far.
+    The spans are sorted by row and then column with overlapping or adjacent
+    spans merged, so each cell will appear at most once.
+    @return a QVector of Span
+    */
+QVector<Span> Rasterizer::spans() const
+{
+    QVector<Span> sorted = m_spans;
+
+    std::sort(sorted.begin(), sorted.end(), [](const Span &a, const Span &b) {
+        return (a.row < b.row) || ((a.row == b.row) && (a.left < b.left));
+    });
+
+    QVector<Span> merged;
+    merged.reserve(sorted.count());
+
+    foreach (const Span &span, sorted) {
+        if (!merged.isEmpty() && (merged.last().row == span.row) && (span.left <= merged.last().right + 1)) {
+            merged.last().right = std::max(merged.last().right, span.right);
+        } else {
+            merged.append(span);
+        }
+    }
+
+    return merged;
+}
+
+
+/**
+    Add a span clipping it to the bounds.
+    @param row the row of the span
+    @param left the first cell of the span
+    @param right the last cell of the span
+    */
+void Rasterizer::addSpan(int row, int left, int right)
+{
+    if (row < m_bounds.top() || row > m_bounds.bottom()) {
+        return;
+    }
+
+    left = std::max(left, m_bounds.left());
+    right = std::min(right, m_bounds.right());
+
+    if (left <= right) {
+        m_spans.append(Span(row, left, right));
+    }
+}
+
+
+/**
+    Trace an ellipse fitting the rectangle using an integer midpoint algorithm
+    that handles both odd and even diameters.
+    Each step produces the four symmetric points, when filling, the rows are
+    joined between the left and right points.
+    @param rect the normalized bounding rectangle of the ellipse
+    @param fill true if the ellipse should be filled, false for the outline only
+    */
+void Rasterizer::traceEllipse(const QRect &rect, bool fill)
+{
+    qint64 x0 = rect.left();
+    qint64 x1 = rect.right();
+    qint64 y0 = rect.top();
+    qint64 y1 = rect.bottom();
+
+    qint64 a = x1 - x0;
+    qint64 b = y1 - y0;
+    qint64 b1 = b & 1;
+    qint64 dx = 4 * (1 - a) * b * b;
+    qint64 dy = 4 * (b1 + 1) * a * a;
+    qint64 err = dx + dy + b1 * a * a;
+
+    y0 += (b + 1) / 2;
+    y1 = y0 - b1;
+    a = 8 * a * a;
+    b1 = 8 * b * b;
+
+    do {
+        if (fill) {
+            addSpan(y0, x0, x1);
+            addSpan(y1, x0, x1);
+        } else {
+            addSpan(y0, x0, x0);
+            addSpan(y0, x1, x1);
+            addSpan(y1, x0, x0);
+            addSpan(y1, x1, x1);
+        }
+
+        qint64 e2 = 2 * err;
+
+        if (e2 <= dy) {
+            ++y0;
+            --y1;
+            err += dy += a;
+        }
+
+        if (e2 >= dx || 2 * err > dy) {
+            ++x0;
+            --x1;
+            err += dx += b1;
+        }
+    } while (x0 <= x1);
+
+    while (y0 - y1 <= b) {  // finish the tips of very flat ellipses
+        if (fill) {
+            addSpan(y0, x0 - 1, x1 + 1);
+            addSpan(y1, x0 - 1, x1 + 1);
+        } else {
+            addSpan(y0, x0 - 1, x0 - 1);
+            addSpan(y0, x1 + 1, x1 + 1);
+            addSpan(y1, x0 - 1, x0 - 1);
+            addSpan(y1, x1 + 1, x1 + 1);
+        }
+
+        ++y0;
+        --y1;
+    }
+}
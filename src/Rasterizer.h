@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2026 by agent
+ * agent@local
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+#ifndef Rasterizer_H
+#define Rasterizer_H
+
+
+#include <QImage>
+#include <QPolygon>
+#include <QRect>
+#include <QVector>
+
+
+class Span
+{
+public:
+    Span();
+    Span(int, int, int);
+
+    int row;
+    int left;
+    int right;
+};
+
+
+Q_DECLARE_TYPEINFO(Span, Q_PRIMITIVE_TYPE);
+
+
+class Rasterizer
+{
+public:
+    explicit Rasterizer(const QRect &);
+
+    void drawLine(const QPoint &, const QPoint &);
+    void drawEllipse(const QRect &);
+    void fillEllipse(const QRect &);
+    void fillPolygon(const QPolygon &);
+    void addImage(const QImage &, const QPoint &offset = QPoint());
+
+    QVector<Span> spans() const;
+
+private:
+    void addSpan(int, int, int);
+    void traceEllipse(const QRect &, bool);
+
+    QRect           m_bounds;
+    QVector<Span>   m_spans;
+};
+
+
+#endif // Rasterizer_H
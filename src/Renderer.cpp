@@ -11,10 +11,16 @@
 
 #include "Renderer.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include <QPaintEngine>
 #include <QPainter>
 #include <QPen>
+#include <QThread>
 #include <QWidget>
+#include <QtAlgorithms>
+#include <QtConcurrent>
 
 #include "Document.h"
 #include "DocumentFloss.h"
@@ -22,6 +28,31 @@
 #include "Symbol.h"
 #include "SymbolLibrary.h"
 #include "SymbolManager.h"
+#include "Trace.h"
+
+
+/**
+    The pens, brushes and symbol used to render the stitches of one floss,
+    calculated once for each render pass.
+    */
+class RenderFloss
+{
+public:
+    RenderFloss();
+
+    bool    valid;
+    QPen    stitchPen;
+    QBrush  blockBrush;
+    Symbol  symbol;
+    QPen    symbolPen;
+    QBrush  symbolBrush;
+};
+
+
+RenderFloss::RenderFloss()
+    :   valid(false)
+{
+}
 
 
 class RendererData : public QSharedData
@@ -46,6 +77,16 @@ private:
     Configuration::EnumRenderer_RenderBackstitchesAs::type  m_renderBackstitchesAs;
     Configuration::EnumRenderer_RenderKnotsAs::type         m_renderKnotsAs;
 
+    int     m_simplifiedStitchesCellSize;
+    int     m_simplifiedGridCellSize;
+
+    QImage  m_cellColors;
+
+    bool    m_multithreaded;
+
+    QVector<RenderFloss>    m_renderFlosses;
+    bool                    m_renderStitchHints;
+
     QPainter    *m_painter;
 
     Document        *m_document;
@@ -98,6 +139,10 @@ RendererData::RendererData()
         m_renderStitchesAs(Configuration::renderer_RenderStitchesAs()),
         m_renderBackstitchesAs(Configuration::renderer_RenderBackstitchesAs()),
         m_renderKnotsAs(Configuration::renderer_RenderKnotsAs()),
+        m_simplifiedStitchesCellSize(0),
+        m_simplifiedGridCellSize(0),
+        m_multithreaded(false),
+        m_renderStitchHints(false),
         m_painter(nullptr),
         m_document(nullptr),
         m_pattern(nullptr),
@@ -150,14 +195,25 @@ RendererData::RendererData(const RendererData &other)
         m_renderStitchesAs(other.m_renderStitchesAs),
         m_renderBackstitchesAs(other.m_renderBackstitchesAs),
         m_renderKnotsAs(other.m_renderKnotsAs),
+        m_simplifiedStitchesCellSize(other.m_simplifiedStitchesCellSize),
+        m_simplifiedGridCellSize(other.m_simplifiedGridCellSize),
+        m_multithreaded(other.m_multithreaded),
+        m_renderFlosses(other.m_renderFlosses),
+        m_renderStitchHints(other.m_renderStitchHints),
+        m_painter(other.m_painter),
         m_document(other.m_document),
         m_pattern(other.m_pattern),
         m_symbolLibrary(other.m_symbolLibrary),
+        m_highlight(other.m_highlight),
         m_topLeft(other.m_topLeft),
         m_topRight(other.m_topRight),
         m_bottomLeft(other.m_bottomLeft),
         m_bottomRight(other.m_bottomRight),
         m_center(other.m_center),
+        m_centerTop(other.m_centerTop),
+        m_centerLeft(other.m_centerLeft),
+        m_centerRight(other.m_centerRight),
+        m_centerBottom(other.m_centerBottom),
         m_renderCell(other.m_renderCell),
         m_renderTLCell(other.m_renderTLCell),
         m_renderTL3Cell(other.m_renderTL3Cell),
@@ -181,14 +237,17 @@ RendererData::RendererData(const RendererData &other)
 }
 
 
-const Renderer::renderStitchCallPointer Renderer::renderStitchCallPointers[] = {
-    &Renderer::renderStitchesAsStitches,
-    &Renderer::renderStitchesAsBlackWhiteSymbols,
-    &Renderer::renderStitchesAsColorSymbols,
-    &Renderer::renderStitchesAsColorBlocks,
-    &Renderer::renderStitchesAsColorBlocksSymbols,
+/**
+    A horizontal band of the device being rendered to by one thread.
+    */
+class RenderBand
+{
+public:
+    QRect   deviceRect;
+    QImage  image;
 };
 
+
 const Renderer::renderBackstitchCallPointer Renderer::renderBackstitchCallPointers[] = {
     &Renderer::renderBackstitchesAsColorLines,
     &Renderer::renderBackstitchesAsBlackWhiteSymbols,
@@ -270,6 +329,33 @@ void Renderer::setRenderKnotsAs(Configuration::EnumRenderer_RenderKnotsAs::type
 }
 
 
+/**
+    Set the cell sizes, in device pixels, below which a simplified rendering is used.
+    Below stitchesCellSize the stitches are drawn from an image with one pixel
+    per cell, below gridCellSize only the thick grid lines are drawn. A value of
+    0 disables the simplification, which is the default so that printing and
+    exporting are not affected.
+    @param stitchesCellSize the cell size for simplified stitches
+    @param gridCellSize the cell size for the simplified grid
+    */
+void Renderer::setLevelOfDetail(int stitchesCellSize, int gridCellSize)
+{
+    d->m_simplifiedStitchesCellSize = stitchesCellSize;
+    d->m_simplifiedGridCellSize = gridCellSize;
+}
+
+
+/**
+    Enable or disable rendering large areas in concurrent bands.
+    This only has an effect when rendering to a QImage.
+    @param multithreaded true to enable, false to disable
+    */
+void Renderer::setMultithreaded(bool multithreaded)
+{
+    d->m_multithreaded = multithreaded;
+}
+
+
 void Renderer::render(QPainter *painter,
                       Pattern *pattern,
                       QRect updateCells,
@@ -279,8 +365,111 @@ void Renderer::render(QPainter *painter,
                       bool renderKnots,
                       int colorHighlight)
 {
+    const int minimumBandedArea = 512 * 512;  // smaller areas are not worth the overhead of the threads
+
     updateCells &= painter->window();
 
+    TraceScope trace("render", "Renderer::render");
+    trace.addArgument("cells", updateCells.width() * updateCells.height());
+    trace.addArgument("patternWidth", pattern->stitches().width());
+    trace.addArgument("patternHeight", pattern->stitches().height());
+
+    if (d->m_multithreaded && (painter->device()->devType() == QInternal::Image) && (QThread::idealThreadCount() > 1)) {
+        QRect deviceRect = painter->combinedTransform().mapRect(QRectF(updateCells)).toAlignedRect() & QRect(0, 0, painter->device()->width(), painter->device()->height());
+
+        if (deviceRect.width() * deviceRect.height() >= minimumBandedArea) {
+            SymbolManager::library(pattern->palette().symbolLibrary());   // libraries are loaded on first use, make sure that happens in this thread
+            renderBanded(painter, deviceRect, pattern, updateCells, renderGrid, renderStitches, renderBackstitches, renderKnots, colorHighlight);
+            return;
+        }
+    }
+
+    renderCells(painter, pattern, updateCells, renderGrid, renderStitches, renderBackstitches, renderKnots, colorHighlight);
+}
+
+
+/**
+    Render the cells by splitting the device area into horizontal bands, one
+    for each available core. Each band is rendered concurrently into its own
+    image by a copy of this renderer and the images are then drawn onto the
+    original painter.
+    Each band renders the cells overlapping it plus one cell either side so
+    that anything overlapping the edges of the cells is still drawn, the
+    images clip the result to the band so nothing is drawn twice.
+    @param painter a pointer to the QPainter of the QImage being rendered to
+    @param deviceRect the area of the device covered by the update cells
+    @param pattern a pointer to the Pattern to render
+    @param updateCells the cells to render
+    */
+void Renderer::renderBanded(QPainter *painter,
+                            const QRect &deviceRect,
+                            Pattern *pattern,
+                            const QRect &updateCells,
+                            bool renderGrid,
+                            bool renderStitches,
+                            bool renderBackstitches,
+                            bool renderKnots,
+                            int colorHighlight)
+{
+    QTransform transform = painter->combinedTransform();
+    QTransform inverse = transform.inverted();
+    QPainter::RenderHints renderHints = painter->renderHints();
+
+    int bands = std::min(QThread::idealThreadCount(), deviceRect.height());
+    QVector<RenderBand> renderBands(bands);
+
+    for (int i = 0 ; i < bands ; ++i) {
+        int top = deviceRect.top() + deviceRect.height() * i / bands;
+        int bottom = deviceRect.top() + deviceRect.height() * (i + 1) / bands;
+        renderBands[i].deviceRect = QRect(deviceRect.left(), top, deviceRect.width(), bottom - top);
+    }
+
+    QtConcurrent::blockingMap(renderBands, [&](RenderBand &band) {
+        TraceScope trace("render", "Renderer::renderBand");
+
+        QRect bandCells = inverse.mapRect(QRectF(band.deviceRect)).toAlignedRect().adjusted(-1, -1, 1, 1) & updateCells;
+
+        band.image = QImage(band.deviceRect.size(), QImage::Format_ARGB32_Premultiplied);
+        band.image.fill(Qt::transparent);
+
+        if (bandCells.isEmpty()) {
+            return;
+        }
+
+        trace.addArgument("cells", bandCells.width() * bandCells.height());
+
+        QPainter bandPainter(&band.image);
+        bandPainter.setRenderHints(renderHints);
+        bandPainter.setTransform(transform * QTransform::fromTranslate(-band.deviceRect.left(), -band.deviceRect.top()));
+
+        Renderer bandRenderer(*this);
+        bandRenderer.renderCells(&bandPainter, pattern, bandCells, renderGrid, renderStitches, renderBackstitches, renderKnots, colorHighlight);
+
+        bandPainter.end();
+    });
+
+    painter->save();
+    painter->setViewTransformEnabled(false);
+    painter->setWorldTransform(QTransform());
+    painter->setCompositionMode(QPainter::CompositionMode_SourceOver);
+
+    foreach (const RenderBand &band, renderBands) {
+        painter->drawImage(band.deviceRect.topLeft(), band.image);
+    }
+
+    painter->restore();
+}
+
+
+void Renderer::renderCells(QPainter *painter,
+                           Pattern *pattern,
+                           const QRect &updateCells,
+                           bool renderGrid,
+                           bool renderStitches,
+                           bool renderBackstitches,
+                           bool renderKnots,
+                           int colorHighlight)
+{
     painter->save();
 
     d->m_painter = painter;
@@ -288,44 +477,55 @@ void Renderer::render(QPainter *painter,
     d->m_symbolLibrary = SymbolManager::library(pattern->palette().symbolLibrary());
     d->m_highlight = colorHighlight;
 
+    prepareRenderFlosses();
+
     int patternLeft = updateCells.left();
-    int patternRight = updateCells.right();
     int patternTop = updateCells.top();
-    int patternBottom = updateCells.bottom();
     int patternWidth = updateCells.width();
     int patternHeight = updateCells.height();
 
+    QTransform deviceTransform = painter->combinedTransform();
+    double cellSize = std::min(std::abs(deviceTransform.m11()), std::abs(deviceTransform.m22()));
+
     if (renderGrid) {
         QPen thickPen(d->m_thickLineColor);
         QPen thinPen(d->m_thinLineColor);
         thickPen.setWidthF(d->m_thickLineWidth);
         thinPen.setWidthF(d->m_thinLineWidth);
 
-        for (int y = patternTop ; y <= patternTop + patternHeight ; ++y) {
-            painter->setPen((y % d->m_cellVerticalGrouping) ? thinPen : thickPen);
-            painter->drawLine(patternLeft, y, patternLeft + patternWidth, y);
-        }
+        if (cellSize < d->m_simplifiedGridCellSize) {
+            // thin lines would be too close together to be useful, only draw the thick lines
+            painter->setPen(thickPen);
 
-        for (int x = patternLeft ; x <= patternLeft + patternWidth ; ++x) {
-            painter->setPen((x % d->m_cellHorizontalGrouping) ? thinPen : thickPen);
-            painter->drawLine(x, patternTop, x, patternTop + patternHeight);
-        }
-    }
+            int verticalGrouping = d->m_cellVerticalGrouping;
+            int horizontalGrouping = d->m_cellHorizontalGrouping;
 
-    if (renderStitches) {
-        QTransform transform = painter->transform();
+            for (int y = ((patternTop + verticalGrouping - 1) / verticalGrouping) * verticalGrouping ; y <= patternTop + patternHeight ; y += verticalGrouping) {
+                painter->drawLine(patternLeft, y, patternLeft + patternWidth, y);
+            }
 
-        for (int y = patternTop ; y <= patternBottom ; ++y) {
-            for (int x = patternLeft ; x <= patternRight ; ++x) {
-                if (StitchQueue *queue = pattern->stitches().stitchQueueAt(QPoint(x, y))) {
-                    painter->translate(x, y);
-                    (this->*renderStitchCallPointers[d->m_renderStitchesAs])(queue);
-                    painter->setTransform(transform);
-                }
+            for (int x = ((patternLeft + horizontalGrouping - 1) / horizontalGrouping) * horizontalGrouping ; x <= patternLeft + patternWidth ; x += horizontalGrouping) {
+                painter->drawLine(x, patternTop, x, patternTop + patternHeight);
+            }
+        } else {
+            for (int y = patternTop ; y <= patternTop + patternHeight ; ++y) {
+                painter->setPen((y % d->m_cellVerticalGrouping) ? thinPen : thickPen);
+                painter->drawLine(patternLeft, y, patternLeft + patternWidth, y);
+            }
+
+            for (int x = patternLeft ; x <= patternLeft + patternWidth ; ++x) {
+                painter->setPen((x % d->m_cellHorizontalGrouping) ? thinPen : thickPen);
+                painter->drawLine(x, patternTop, x, patternTop + patternHeight);
             }
         }
     }
 
+    if (renderStitches && (cellSize < d->m_simplifiedStitchesCellSize)) {
+        renderCellColors(updateCells);
+    } else if (renderStitches) {
+        renderStitchQueues(updateCells);
+    }
+
     if (renderBackstitches) {
         QList<Backstitch*> backstitches = pattern->stitches().backstitches();
 
@@ -346,416 +546,422 @@ void Renderer::render(QPainter *painter,
 }
 
 
-void Renderer::renderStitchesAsStitches(StitchQueue *stitchQueue)
+/**
+    Render the stitches in the cells as a single color for each cell, this is
+    used when the cells are too small for the individual stitches to be seen.
+    The color used is that of the stitch covering most of the cell. The colors
+    of the cells being updated are recalculated on every pass into a scratch
+    image with one pixel for each cell, which is then scaled to the cells
+    without filtering. Only the allocation of the scratch image is reused
+    between passes, it grows when a larger area is updated.
+    @param updateCells the cells to be rendered
+    */
+void Renderer::renderCellColors(const QRect &updateCells)
 {
-    QPen pen(Qt::lightGray, 0, Qt::SolidLine, Qt::RoundCap);
+    StitchData &stitches = d->m_pattern->stitches();
 
-    int i = stitchQueue->count();
+    if ((d->m_cellColors.width() < updateCells.width()) || (d->m_cellColors.height() < updateCells.height())) {
+        d->m_cellColors = QImage(updateCells.size().expandedTo(d->m_cellColors.size()), QImage::Format_ARGB32_Premultiplied);
+    }
 
-    while (i) {
-        Stitch *stitch = stitchQueue->at(--i);
-        DocumentFloss *documentFloss = d->m_pattern->palette().flosses().value(stitch->colorIndex);
+    int renderFlosses = d->m_renderFlosses.count();
 
-        if ((d->m_highlight == -1) || (stitch->colorIndex == d->m_highlight)) {
-            pen.setColor(documentFloss->flossColor());
-            pen.setWidthF(documentFloss->stitchStrands() / 10.0);
-        } else {
-            pen.setColor(Qt::lightGray);
-            pen.setWidthF(0);
-        }
+    for (int y = updateCells.top() ; y <= updateCells.bottom() ; ++y) {
+        QRgb *pixel = reinterpret_cast<QRgb *>(d->m_cellColors.scanLine(y - updateCells.top()));
 
-        d->m_painter->setPen(pen);
+        for (int x = updateCells.left() ; x <= updateCells.right() ; ++x, ++pixel) {
+            QRgb color = qRgba(0, 0, 0, 0);
 
-        switch (stitch->type) {
-        case Stitch::Delete:
-            break;
+            if (StitchQueue *queue = stitches.stitchQueueAt(x, y)) {
+                int coverage = 0;
 
-        case Stitch::TLQtr:
-            d->m_painter->drawLine(d->m_topLeft, d->m_center);
-            break;
+                for (int i = 0 ; i < queue->count() ; ++i) {
+                    Stitch *stitch = queue->at(i);
+                    int stitchCoverage = (stitch->type == Stitch::FrenchKnot) ? 0 : qPopulationCount(quint32(stitch->type & 15));
 
-        case Stitch::TRQtr:
-            d->m_painter->drawLine(d->m_topRight, d->m_center);
-            break;
+                    if ((stitchCoverage > coverage) && (stitch->colorIndex >= 0) && (stitch->colorIndex < renderFlosses) && d->m_renderFlosses.at(stitch->colorIndex).valid) {
+                        coverage = stitchCoverage;
+                        color = d->m_renderFlosses.at(stitch->colorIndex).blockBrush.color().rgba();
+                    }
+                }
+            }
 
-        case Stitch::BLQtr:
-            d->m_painter->drawLine(d->m_bottomLeft, d->m_center);
-            break;
+            *pixel = color;
+        }
+    }
 
-        case Stitch::BTHalf:
-            d->m_painter->drawLine(d->m_bottomLeft, d->m_topRight);
-            break;
+    d->m_painter->setRenderHint(QPainter::SmoothPixmapTransform, false);
+    d->m_painter->drawImage(QRectF(updateCells), d->m_cellColors, QRectF(QPointF(0, 0), QSizeF(updateCells.size())));
+}
 
-        case Stitch::TL3Qtr:
-            d->m_painter->drawLine(d->m_bottomLeft, d->m_topRight);
-            d->m_painter->drawLine(d->m_topLeft, d->m_center);
-            break;
 
-        case Stitch::BRQtr:
-            d->m_painter->drawLine(d->m_center, d->m_bottomRight);
-            break;
+/**
+    Take a snapshot of the palette for the current render pass.
+    The pens, brushes and symbols needed by the stitch kernels are calculated
+    once for each floss rather than once for each stitch, including the
+    changes required for color highlighting, and are stored in a vector
+    indexed by the color index. The stitch hints setting is also read once.
+    */
+void Renderer::prepareRenderFlosses()
+{
+    QMap<int, DocumentFloss *> flosses = d->m_pattern->palette().flosses();
+    bool needsSymbols = (d->m_renderStitchesAs != Configuration::EnumRenderer_RenderStitchesAs::Stitches) && (d->m_renderStitchesAs != Configuration::EnumRenderer_RenderStitchesAs::ColorBlocks);
 
-        case Stitch::TBHalf:
-            d->m_painter->drawLine(d->m_topLeft, d->m_bottomRight);
-            break;
+    d->m_renderStitchHints = Configuration::renderer_RenderStitchHints();
+    d->m_renderFlosses.clear();
+    d->m_renderFlosses.resize(flosses.isEmpty() ? 0 : flosses.lastKey() + 1);
 
-        case Stitch::TR3Qtr:
-            d->m_painter->drawLine(d->m_topLeft, d->m_bottomRight);
-            d->m_painter->drawLine(d->m_topRight, d->m_center);
-            break;
+    QMapIterator<int, DocumentFloss *> flossIterator(flosses);
 
-        case Stitch::BL3Qtr:
-            d->m_painter->drawLine(d->m_topLeft, d->m_bottomRight);
-            d->m_painter->drawLine(d->m_bottomLeft, d->m_center);
-            break;
+    while (flossIterator.hasNext()) {
+        flossIterator.next();
 
-        case Stitch::BR3Qtr:
-            d->m_painter->drawLine(d->m_bottomLeft, d->m_topRight);
-            d->m_painter->drawLine(d->m_center, d->m_bottomRight);
-            break;
+        if (flossIterator.key() < 0) {
+            continue;
+        }
 
-        case Stitch::Full:
-            d->m_painter->drawLine(d->m_topLeft, d->m_bottomRight);
-            d->m_painter->drawLine(d->m_bottomLeft, d->m_topRight);
-            break;
+        DocumentFloss *documentFloss = flossIterator.value();
+        RenderFloss &renderFloss = d->m_renderFlosses[flossIterator.key()];
+        QColor flossColor = documentFloss->flossColor();
+        bool highlighted = ((d->m_highlight == -1) || (flossIterator.key() == d->m_highlight));
 
-        case Stitch::TLSmallHalf:
-            d->m_painter->drawLine(d->m_centerLeft, d->m_centerTop);
-            break;
+        renderFloss.valid = true;
+        renderFloss.stitchPen = QPen(Qt::lightGray, 0, Qt::SolidLine, Qt::RoundCap);
+        renderFloss.blockBrush = QBrush(Qt::lightGray, Qt::SolidPattern);
 
-        case Stitch::TRSmallHalf:
-            d->m_painter->drawLine(d->m_centerTop, d->m_centerRight);
-            break;
+        if (highlighted) {
+            renderFloss.stitchPen.setColor(flossColor);
+            renderFloss.stitchPen.setWidthF(documentFloss->stitchStrands() / 10.0);
+            renderFloss.blockBrush.setColor(flossColor);
+        }
 
-        case Stitch::BLSmallHalf:
-            d->m_painter->drawLine(d->m_centerLeft, d->m_centerBottom);
-            break;
+        if (!needsSymbols) {
+            continue;
+        }
 
-        case Stitch::BRSmallHalf:
-            d->m_painter->drawLine(d->m_centerBottom, d->m_centerRight);
-            break;
+        renderFloss.symbol = d->m_symbolLibrary->symbol(documentFloss->stitchSymbol());
+        renderFloss.symbolPen = renderFloss.symbol.pen();
+        renderFloss.symbolBrush = renderFloss.symbol.brush();
 
-        case Stitch::TLSmallFull:
-            d->m_painter->drawLine(d->m_topLeft, d->m_center);
-            d->m_painter->drawLine(d->m_centerLeft, d->m_centerTop);
-            break;
+        QColor symbolColor;
 
-        case Stitch::TRSmallFull:
-            d->m_painter->drawLine(d->m_centerTop, d->m_centerRight);
-            d->m_painter->drawLine(d->m_center, d->m_topRight);
+        switch (d->m_renderStitchesAs) {
+        case Configuration::EnumRenderer_RenderStitchesAs::BlackWhiteSymbols:
+            // the symbolPen and symbolBrush are already set up as black
+            symbolColor = highlighted ? QColor() : QColor(Qt::lightGray);
             break;
 
-        case Stitch::BLSmallFull:
-            d->m_painter->drawLine(d->m_bottomLeft, d->m_center);
-            d->m_painter->drawLine(d->m_centerLeft, d->m_centerBottom);
+        case Configuration::EnumRenderer_RenderStitchesAs::ColorSymbols:
+            symbolColor = highlighted ? flossColor : QColor(Qt::lightGray);
             break;
 
-        case Stitch::BRSmallFull:
-            d->m_painter->drawLine(d->m_center, d->m_bottomRight);
-            d->m_painter->drawLine(d->m_centerBottom, d->m_centerRight);
+        case Configuration::EnumRenderer_RenderStitchesAs::ColorBlocksSymbols:
+            symbolColor = highlighted ? ((qGray(flossColor.rgb()) < 128) ? QColor(Qt::white) : QColor(Qt::black)) : QColor(Qt::darkGray);
             break;
 
-        case Stitch::FrenchKnot:
+        default:
             break;
         }
-    }
-}
-
-
-void Renderer::renderStitchesAsBlackWhiteSymbols(StitchQueue *stitchQueue)
-{
-    int i = stitchQueue->count();
-
-    while (i) {
-        Stitch *stitch = stitchQueue->at(--i);
-        DocumentFloss *documentFloss = d->m_pattern->palette().flosses().value(stitch->colorIndex);
-        Symbol symbol = d->m_symbolLibrary->symbol(documentFloss->stitchSymbol());
-
-        QPen symbolPen = symbol.pen();
-        QBrush symbolBrush = symbol.brush();
-
-        if ((d->m_highlight == -1) || (stitch->colorIndex == d->m_highlight)) {
-            // the symbolPen and symbolBrush are already set up as black at this point
-        } else {
-            symbolPen.setColor(Qt::lightGray);
-            symbolBrush.setColor(Qt::lightGray);
-        }
-
-        d->m_painter->setPen(symbolPen);
-        d->m_painter->setBrush(symbolBrush);
-
-        d->m_painter->drawPath(symbol.path(stitch->type));
 
-        if (Configuration::renderer_RenderStitchHints()) {
-            renderStitchHints(stitch);
+        if (symbolColor.isValid()) {
+            renderFloss.symbolPen.setColor(symbolColor);
+            renderFloss.symbolBrush.setColor(symbolColor);
         }
     }
 }
 
 
-void Renderer::renderStitchesAsColorSymbols(StitchQueue *stitchQueue)
+/**
+    Render the stitches in the cells.
+    This is specialized for each way of rendering stitches and for stitch hints
+    being enabled or not, the specialization is selected once for each render
+    pass by renderStitchQueues so that there are no indirect calls or configuration
+    lookups per cell.
+    @param cells the cells to render
+    */
+template <int stitchesAs, bool stitchHints>
+void Renderer::renderStitchCells(const QRect &cells)
 {
-    int i = stitchQueue->count();
+    QPainter *painter = d->m_painter;
+    StitchData &stitches = d->m_pattern->stitches();
+    QTransform transform = painter->transform();
+    RenderFloss *renderFlosses = d->m_renderFlosses.data();
+    int renderFlossCount = d->m_renderFlosses.count();
+
+    for (int y = cells.top() ; y <= cells.bottom() ; ++y) {
+        for (int x = cells.left() ; x <= cells.right() ; ++x) {
+            StitchQueue *stitchQueue = stitches.stitchQueueAt(x, y);
+
+            if (stitchQueue == nullptr) {
+                continue;
+            }
 
-    while (i) {
-        Stitch *stitch = stitchQueue->at(--i);
-        DocumentFloss *documentFloss = d->m_pattern->palette().flosses().value(stitch->colorIndex);
-        Symbol symbol = d->m_symbolLibrary->symbol(documentFloss->stitchSymbol());
+            painter->translate(x, y);
 
-        QPen symbolPen = symbol.pen();
-        QBrush symbolBrush = symbol.brush();
+            int i = stitchQueue->count();
 
-        if ((d->m_highlight == -1) || (stitch->colorIndex == d->m_highlight)) {
-            symbolPen.setColor(documentFloss->flossColor());
-            symbolBrush.setColor(documentFloss->flossColor());
-        } else {
-            symbolPen.setColor(Qt::lightGray);
-            symbolBrush.setColor(Qt::lightGray);
-        }
+            while (i) {
+                Stitch *stitch = stitchQueue->at(--i);
+
+                if ((stitch->colorIndex < 0) || (stitch->colorIndex >= renderFlossCount) || !renderFlosses[stitch->colorIndex].valid) {
+                    continue;
+                }
 
-        d->m_painter->setPen(symbolPen);
-        d->m_painter->setBrush(symbolBrush);
+                RenderFloss &renderFloss = renderFlosses[stitch->colorIndex];
+
+                switch (stitchesAs) {
+                case Configuration::EnumRenderer_RenderStitchesAs::Stitches:
+                    painter->setPen(renderFloss.stitchPen);
+                    renderStitchLines(stitch->type);
+                    break;
+
+                case Configuration::EnumRenderer_RenderStitchesAs::BlackWhiteSymbols:
+                case Configuration::EnumRenderer_RenderStitchesAs::ColorSymbols:
+                    painter->setPen(renderFloss.symbolPen);
+                    painter->setBrush(renderFloss.symbolBrush);
+                    painter->drawPath(renderFloss.symbol.path(stitch->type));
+                    break;
+
+                case Configuration::EnumRenderer_RenderStitchesAs::ColorBlocks:
+                    renderStitchBlock(stitch->type, renderFloss.blockBrush);
+                    break;
+
+                case Configuration::EnumRenderer_RenderStitchesAs::ColorBlocksSymbols:
+                    renderStitchBlock(stitch->type, renderFloss.blockBrush);
+                    painter->setPen(renderFloss.symbolPen);
+                    painter->setBrush(renderFloss.symbolBrush);
+                    painter->drawPath(renderFloss.symbol.path(stitch->type));
+                    break;
+                }
 
-        d->m_painter->drawPath(symbol.path(stitch->type));
+                if (stitchHints && (stitchesAs != Configuration::EnumRenderer_RenderStitchesAs::Stitches)) {
+                    renderStitchHints(stitch);
+                }
+            }
 
-        if (Configuration::renderer_RenderStitchHints()) {
-            renderStitchHints(stitch);
+            painter->setTransform(transform);
         }
     }
 }
 
 
-void Renderer::renderStitchesAsColorBlocks(StitchQueue *stitchQueue)
+/**
+    Render the stitches in the cells using the kernel specialized for the
+    current render settings.
+    @param cells the cells to render
+    */
+void Renderer::renderStitchQueues(const QRect &cells)
 {
-    QBrush blockBrush(Qt::SolidPattern);
-
-    int i = stitchQueue->count();
-
-    while (i) {
-        Stitch *stitch = stitchQueue->at(--i);
-        DocumentFloss *documentFloss = d->m_pattern->palette().flosses().value(stitch->colorIndex);
-
-        if ((d->m_highlight == -1) || (stitch->colorIndex == d->m_highlight)) {
-            blockBrush.setColor(documentFloss->flossColor());
-        } else {
-            blockBrush.setColor(Qt::lightGray);
+    typedef void (Renderer::*renderStitchCellsCallPointer)(const QRect &);
+
+    static const renderStitchCellsCallPointer renderStitchCellsCallPointers[][2] = {
+        {
+            &Renderer::renderStitchCells<Configuration::EnumRenderer_RenderStitchesAs::Stitches, false>,
+            &Renderer::renderStitchCells<Configuration::EnumRenderer_RenderStitchesAs::Stitches, true>
+        },
+        {
+            &Renderer::renderStitchCells<Configuration::EnumRenderer_RenderStitchesAs::BlackWhiteSymbols, false>,
+            &Renderer::renderStitchCells<Configuration::EnumRenderer_RenderStitchesAs::BlackWhiteSymbols, true>
+        },
+        {
+            &Renderer::renderStitchCells<Configuration::EnumRenderer_RenderStitchesAs::ColorSymbols, false>,
+            &Renderer::renderStitchCells<Configuration::EnumRenderer_RenderStitchesAs::ColorSymbols, true>
+        },
+        {
+            &Renderer::renderStitchCells<Configuration::EnumRenderer_RenderStitchesAs::ColorBlocks, false>,
+            &Renderer::renderStitchCells<Configuration::EnumRenderer_RenderStitchesAs::ColorBlocks, true>
+        },
+        {
+            &Renderer::renderStitchCells<Configuration::EnumRenderer_RenderStitchesAs::ColorBlocksSymbols, false>,
+            &Renderer::renderStitchCells<Configuration::EnumRenderer_RenderStitchesAs::ColorBlocksSymbols, true>
         }
+    };
 
-        d->m_painter->setPen(Qt::NoPen);
-        d->m_painter->setBrush(blockBrush);
+    (this->*renderStitchCellsCallPointers[d->m_renderStitchesAs][d->m_renderStitchHints ? 1 : 0])(cells);
+}
 
-        switch (stitch->type) {
-        case Stitch::Delete:
-            break;
 
-        case Stitch::TLQtr:
-            d->m_painter->drawPolygon(d->m_renderTLQ);
-            break;
+/**
+    Draw the lines representing a stitch in the current cell with the current pen.
+    @param type the Stitch::Type to draw
+    */
+void Renderer::renderStitchLines(Stitch::Type type)
+{
+    switch (type) {
+    case Stitch::Delete:
+        break;
 
-        case Stitch::TRQtr:
-            d->m_painter->drawPolygon(d->m_renderTRQ);
-            break;
+    case Stitch::TLQtr:
+        d->m_painter->drawLine(d->m_topLeft, d->m_center);
+        break;
 
-        case Stitch::BLQtr:
-            d->m_painter->drawPolygon(d->m_renderBLQ);
-            break;
+    case Stitch::TRQtr:
+        d->m_painter->drawLine(d->m_topRight, d->m_center);
+        break;
 
-        case Stitch::BTHalf:
-            d->m_painter->drawPolygon(d->m_renderBLTRH);
-            break;
+    case Stitch::BLQtr:
+        d->m_painter->drawLine(d->m_bottomLeft, d->m_center);
+        break;
 
-        case Stitch::TL3Qtr:
-            d->m_painter->drawPolygon(d->m_renderTL3Q);
-            break;
+    case Stitch::BTHalf:
+        d->m_painter->drawLine(d->m_bottomLeft, d->m_topRight);
+        break;
 
-        case Stitch::BRQtr:
-            d->m_painter->drawPolygon(d->m_renderBRQ);
-            break;
+    case Stitch::TL3Qtr:
+        d->m_painter->drawLine(d->m_bottomLeft, d->m_topRight);
+        d->m_painter->drawLine(d->m_topLeft, d->m_center);
+        break;
 
-        case Stitch::TBHalf:
-            d->m_painter->drawPolygon(d->m_renderTLBRH);
-            break;
+    case Stitch::BRQtr:
+        d->m_painter->drawLine(d->m_center, d->m_bottomRight);
+        break;
 
-        case Stitch::TR3Qtr:
-            d->m_painter->drawPolygon(d->m_renderTR3Q);
-            break;
+    case Stitch::TBHalf:
+        d->m_painter->drawLine(d->m_topLeft, d->m_bottomRight);
+        break;
 
-        case Stitch::BL3Qtr:
-            d->m_painter->drawPolygon(d->m_renderBL3Q);
-            break;
+    case Stitch::TR3Qtr:
+        d->m_painter->drawLine(d->m_topLeft, d->m_bottomRight);
+        d->m_painter->drawLine(d->m_topRight, d->m_center);
+        break;
 
-        case Stitch::BR3Qtr:
-            d->m_painter->drawPolygon(d->m_renderBR3Q);
-            break;
+    case Stitch::BL3Qtr:
+        d->m_painter->drawLine(d->m_topLeft, d->m_bottomRight);
+        d->m_painter->drawLine(d->m_bottomLeft, d->m_center);
+        break;
 
-        case Stitch::Full:
-            d->m_painter->fillRect(d->m_renderCell, blockBrush);
-            break;
+    case Stitch::BR3Qtr:
+        d->m_painter->drawLine(d->m_bottomLeft, d->m_topRight);
+        d->m_painter->drawLine(d->m_center, d->m_bottomRight);
+        break;
 
-        case Stitch::TLSmallHalf:
-            d->m_painter->fillRect(d->m_renderTLCell, blockBrush);
-            break;
+    case Stitch::Full:
+        d->m_painter->drawLine(d->m_topLeft, d->m_bottomRight);
+        d->m_painter->drawLine(d->m_bottomLeft, d->m_topRight);
+        break;
 
-        case Stitch::TRSmallHalf:
-            d->m_painter->fillRect(d->m_renderTRCell, blockBrush);
-            break;
+    case Stitch::TLSmallHalf:
+        d->m_painter->drawLine(d->m_centerLeft, d->m_centerTop);
+        break;
 
-        case Stitch::BLSmallHalf:
-            d->m_painter->fillRect(d->m_renderBLCell, blockBrush);
-            break;
+    case Stitch::TRSmallHalf:
+        d->m_painter->drawLine(d->m_centerTop, d->m_centerRight);
+        break;
 
-        case Stitch::BRSmallHalf:
-            d->m_painter->fillRect(d->m_renderBRCell, blockBrush);
-            break;
+    case Stitch::BLSmallHalf:
+        d->m_painter->drawLine(d->m_centerLeft, d->m_centerBottom);
+        break;
 
-        case Stitch::TLSmallFull:
-            d->m_painter->fillRect(d->m_renderTLCell, blockBrush);
-            break;
+    case Stitch::BRSmallHalf:
+        d->m_painter->drawLine(d->m_centerBottom, d->m_centerRight);
+        break;
 
-        case Stitch::TRSmallFull:
-            d->m_painter->fillRect(d->m_renderTRCell, blockBrush);
-            break;
+    case Stitch::TLSmallFull:
+        d->m_painter->drawLine(d->m_topLeft, d->m_center);
+        d->m_painter->drawLine(d->m_centerLeft, d->m_centerTop);
+        break;
 
-        case Stitch::BLSmallFull:
-            d->m_painter->fillRect(d->m_renderBLCell, blockBrush);
-            break;
+    case Stitch::TRSmallFull:
+        d->m_painter->drawLine(d->m_centerTop, d->m_centerRight);
+        d->m_painter->drawLine(d->m_center, d->m_topRight);
+        break;
 
-        case Stitch::BRSmallFull:
-            d->m_painter->fillRect(d->m_renderBRCell, blockBrush);
-            break;
+    case Stitch::BLSmallFull:
+        d->m_painter->drawLine(d->m_bottomLeft, d->m_center);
+        d->m_painter->drawLine(d->m_centerLeft, d->m_centerBottom);
+        break;
 
-        case Stitch::FrenchKnot:
-            break;
-        }
+    case Stitch::BRSmallFull:
+        d->m_painter->drawLine(d->m_center, d->m_bottomRight);
+        d->m_painter->drawLine(d->m_centerBottom, d->m_centerRight);
+        break;
 
-        if (Configuration::renderer_RenderStitchHints()) {
-            renderStitchHints(stitch);
-        }
+    case Stitch::FrenchKnot:
+        break;
     }
 }
 
 
-void Renderer::renderStitchesAsColorBlocksSymbols(StitchQueue *stitchQueue)
+/**
+    Fill the area of the current cell covered by a stitch.
+    @param type the Stitch::Type to fill
+    @param blockBrush the QBrush to fill it with
+    */
+void Renderer::renderStitchBlock(Stitch::Type type, const QBrush &blockBrush)
 {
-    QBrush blockBrush(Qt::SolidPattern);
-
-    int i = stitchQueue->count();
-
-    while (i) {
-        Stitch *stitch = stitchQueue->at(--i);
-        DocumentFloss *documentFloss = d->m_pattern->palette().flosses().value(stitch->colorIndex);
-        Symbol symbol = d->m_symbolLibrary->symbol(documentFloss->stitchSymbol());
-
-        QPen symbolPen = symbol.pen();
-        QBrush symbolBrush = symbol.brush();
-
-        if ((d->m_highlight == -1) || (stitch->colorIndex == d->m_highlight)) {
-            QColor flossColor = documentFloss->flossColor();
-            QColor symbolColor = (qGray(flossColor.rgb()) < 128) ? Qt::white : Qt::black;
-            symbolPen.setColor(symbolColor);
-            symbolBrush.setColor(symbolColor);
-            blockBrush.setColor(flossColor);
-        } else {
-            symbolPen.setColor(Qt::darkGray);
-            symbolBrush.setColor(Qt::darkGray);
-            blockBrush.setColor(Qt::lightGray);
-        }
-
-        d->m_painter->setPen(Qt::NoPen);
-        d->m_painter->setBrush(blockBrush);
-
-        switch (stitch->type) {
-        case Stitch::Delete:
-            break;
-
-        case Stitch::TLQtr:
-            d->m_painter->drawPolygon(d->m_renderTLQ);
-            break;
-
-        case Stitch::TRQtr:
-            d->m_painter->drawPolygon(d->m_renderTRQ);
-            break;
-
-        case Stitch::BLQtr:
-            d->m_painter->drawPolygon(d->m_renderBLQ);
-            break;
-
-        case Stitch::BTHalf:
-            d->m_painter->drawPolygon(d->m_renderBLTRH);
-            break;
-
-        case Stitch::TL3Qtr:
-            d->m_painter->drawPolygon(d->m_renderTL3Q);
-            break;
-
-        case Stitch::BRQtr:
-            d->m_painter->drawPolygon(d->m_renderBRQ);
-            break;
+    d->m_painter->setPen(Qt::NoPen);
+    d->m_painter->setBrush(blockBrush);
 
-        case Stitch::TBHalf:
-            d->m_painter->drawPolygon(d->m_renderTLBRH);
-            break;
+    switch (type) {
+    case Stitch::Delete:
+        break;
 
-        case Stitch::TR3Qtr:
-            d->m_painter->drawPolygon(d->m_renderTR3Q);
-            break;
+    case Stitch::TLQtr:
+        d->m_painter->drawPolygon(d->m_renderTLQ);
+        break;
 
-        case Stitch::BL3Qtr:
-            d->m_painter->drawPolygon(d->m_renderBL3Q);
-            break;
+    case Stitch::TRQtr:
+        d->m_painter->drawPolygon(d->m_renderTRQ);
+        break;
 
-        case Stitch::BR3Qtr:
-            d->m_painter->drawPolygon(d->m_renderBR3Q);
-            break;
+    case Stitch::BLQtr:
+        d->m_painter->drawPolygon(d->m_renderBLQ);
+        break;
 
-        case Stitch::Full:
-            d->m_painter->fillRect(d->m_renderCell, blockBrush);
-            break;
+    case Stitch::BTHalf:
+        d->m_painter->drawPolygon(d->m_renderBLTRH);
+        break;
 
-        case Stitch::TLSmallHalf:
-            d->m_painter->fillRect(d->m_renderTLCell, blockBrush);
-            break;
+    case Stitch::TL3Qtr:
+        d->m_painter->drawPolygon(d->m_renderTL3Q);
+        break;
 
-        case Stitch::TRSmallHalf:
-            d->m_painter->fillRect(d->m_renderTRCell, blockBrush);
-            break;
+    case Stitch::BRQtr:
+        d->m_painter->drawPolygon(d->m_renderBRQ);
+        break;
 
-        case Stitch::BLSmallHalf:
-            d->m_painter->fillRect(d->m_renderBLCell, blockBrush);
-            break;
+    case Stitch::TBHalf:
+        d->m_painter->drawPolygon(d->m_renderTLBRH);
+        break;
 
-        case Stitch::BRSmallHalf:
-            d->m_painter->fillRect(d->m_renderBRCell, blockBrush);
-            break;
+    case Stitch::TR3Qtr:
+        d->m_painter->drawPolygon(d->m_renderTR3Q);
+        break;
 
-        case Stitch::TLSmallFull:
-            d->m_painter->fillRect(d->m_renderTLCell, blockBrush);
-            break;
+    case Stitch::BL3Qtr:
+        d->m_painter->drawPolygon(d->m_renderBL3Q);
+        break;
 
-        case Stitch::TRSmallFull:
-            d->m_painter->fillRect(d->m_renderTRCell, blockBrush);
-            break;
+    case Stitch::BR3Qtr:
+        d->m_painter->drawPolygon(d->m_renderBR3Q);
+        break;
 
-        case Stitch::BLSmallFull:
-            d->m_painter->fillRect(d->m_renderBLCell, blockBrush);
-            break;
+    case Stitch::Full:
+        d->m_painter->fillRect(d->m_renderCell, blockBrush);
+        break;
 
-        case Stitch::BRSmallFull:
-            d->m_painter->fillRect(d->m_renderBRCell, blockBrush);
-            break;
+    case Stitch::TLSmallHalf:
+    case Stitch::TLSmallFull:
+        d->m_painter->fillRect(d->m_renderTLCell, blockBrush);
+        break;
 
-        case Stitch::FrenchKnot:
-            break;
-        }
+    case Stitch::TRSmallHalf:
+    case Stitch::TRSmallFull:
+        d->m_painter->fillRect(d->m_renderTRCell, blockBrush);
+        break;
 
-        d->m_painter->setPen(symbolPen);
-        d->m_painter->setBrush(symbolBrush);
+    case Stitch::BLSmallHalf:
+    case Stitch::BLSmallFull:
+        d->m_painter->fillRect(d->m_renderBLCell, blockBrush);
+        break;
 
-        d->m_painter->drawPath(symbol.path(stitch->type));
+    case Stitch::BRSmallHalf:
+    case Stitch::BRSmallFull:
+        d->m_painter->fillRect(d->m_renderBRCell, blockBrush);
+        break;
 
-        if (Configuration::renderer_RenderStitchHints()) {
-            renderStitchHints(stitch);
-        }
+    case Stitch::FrenchKnot:
+        break;
     }
 }
 
@@ -14,12 +14,15 @@
 
 
 #include <QFont>
+#include <QImage>
 #include <QPolygon>
 #include <QRect>
 
 #include "configuration.h"
+#include "Stitch.h"
 
 
+class QBrush;
 class QPainter;
 
 class Backstitch;
@@ -27,8 +30,6 @@ class Document;
 class Knot;
 class Pattern;
 class RendererData;
-class Stitch;
-class StitchQueue;
 
 
 class Renderer
@@ -45,6 +46,8 @@ public:
     void setRenderStitchesAs(Configuration::EnumRenderer_RenderStitchesAs::type);
     void setRenderBackstitchesAs(Configuration::EnumRenderer_RenderBackstitchesAs::type);
     void setRenderKnotsAs(Configuration::EnumRenderer_RenderKnotsAs::type);
+    void setLevelOfDetail(int, int);
+    void setMultithreaded(bool);
 
     void render(QPainter *,
                 Pattern *,
@@ -58,20 +61,22 @@ public:
     Renderer &operator=(const Renderer &);
 
 private:
-    typedef void (Renderer::*renderStitchCallPointer)(StitchQueue *);
     typedef void (Renderer::*renderBackstitchCallPointer)(Backstitch *);
     typedef void (Renderer::*renderKnotCallPointer)(Knot *);
 
-    static const renderStitchCallPointer renderStitchCallPointers[];
     static const renderBackstitchCallPointer renderBackstitchCallPointers[];
     static const renderKnotCallPointer renderKnotCallPointers[];
 
-    void renderStitchesAsStitches(StitchQueue *);
-    void renderStitchesAsBlackWhiteSymbols(StitchQueue *);
-    void renderStitchesAsColorSymbols(StitchQueue *);
-    void renderStitchesAsColorBlocks(StitchQueue *);
-    void renderStitchesAsColorBlocksSymbols(StitchQueue *);
+    void renderBanded(QPainter *, const QRect &, Pattern *, const QRect &, bool, bool, bool, bool, int);
+    void renderCells(QPainter *, Pattern *, const QRect &, bool, bool, bool, bool, int);
+
+    void prepareRenderFlosses();
+    void renderStitchQueues(const QRect &);
+    template <int stitchesAs, bool stitchHints> void renderStitchCells(const QRect &);
+    void renderStitchLines(Stitch::Type);
+    void renderStitchBlock(Stitch::Type, const QBrush &);
     void renderStitchHints(Stitch *);
+    void renderCellColors(const QRect &);
 
     void renderBackstitchesAsColorLines(Backstitch *);
     void renderBackstitchesAsBlackWhiteSymbols(Backstitch *);
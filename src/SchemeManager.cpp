@@ -11,10 +11,14 @@
 
 #include "SchemeManager.h"
 
+#include <QDataStream>
+#include <QDateTime>
 #include <QDir>
 #include <QDirIterator>
 #include <QFile>
 #include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
 #include <QStandardPaths>
 #include <QUrl>
 #include <QXmlInputSource>
@@ -25,6 +29,7 @@
 
 #include "Floss.h"
 #include "FlossScheme.h"
+#include "MemoryAccounting.h"
 #include "SchemeParser.h"
 
 
@@ -51,6 +56,25 @@ SchemeManager::SchemeManager()
 {
     /** Refresh the list of floss schemes. */
     refresh();
+
+    MemoryAccounting::add(this, i18n("Libraries"), i18n("Floss schemes"), [this]() {
+        QMutexLocker locker(&m_mutex);
+        qint64 usage = 0;
+
+        foreach (const FlossScheme *flossScheme, m_flossSchemes) {
+            usage += MemoryAccounting::heapBlock(sizeof(FlossScheme)) + MemoryAccounting::heapBlock(sizeof(QListData::Data) + flossScheme->flosses().count() * sizeof(Floss *));
+
+            foreach (const Floss *floss, flossScheme->flosses()) {
+                usage += MemoryAccounting::heapBlock(sizeof(Floss)) + MemoryAccounting::stringUsage(floss->name()) + MemoryAccounting::stringUsage(floss->description());
+            }
+        }
+
+        foreach (const QByteArray &flosses, m_undecodedFlosses) {
+            usage += MemoryAccounting::byteArrayUsage(flosses);
+        }
+
+        return usage;
+    });
 }
 
 
@@ -59,6 +83,7 @@ SchemeManager::SchemeManager()
     */
 SchemeManager::~SchemeManager()
 {
+    MemoryAccounting::remove(this);
     qDeleteAll(m_flossSchemes);
 }
 
@@ -76,7 +101,7 @@ FlossScheme *SchemeManager::createScheme(QString schemeName)
     if (scheme(schemeName) == nullptr) {
         if ((flossScheme = new FlossScheme)) {
             flossScheme->setSchemeName(schemeName);
-            self().m_flossSchemes.append(flossScheme);
+            self().addScheme(flossScheme);
         }
     }
 
@@ -103,25 +128,24 @@ QStringList SchemeManager::schemes()
 
 
 /**
-    Get a pointer to a scheme by name
+    Get a pointer to a scheme by name.
+    Schemes read from the cache have their flosses decoded the first time they
+    are requested. This may be called from worker threads, the lookup and
+    decoding are done with the manager locked.
     @param name of the scheme required.
     @return pointer to the FlossScheme instance, returns null if no scheme found.
     */
 FlossScheme *SchemeManager::scheme(QString name)
 {
-    FlossScheme *flossScheme;
-
-    QListIterator<FlossScheme *> i(self().m_flossSchemes);
-
-    while (i.hasNext()) {
-        flossScheme = i.next();
+    SchemeManager &manager = self();
+    QMutexLocker locker(&manager.m_mutex);
+    FlossScheme *flossScheme = manager.m_schemesByName.value(name);
 
-        if (flossScheme->schemeName() == name) {
-            return flossScheme;
-        }
+    if (flossScheme && manager.m_undecodedFlosses.contains(flossScheme)) {
+        decodeFlosses(flossScheme, manager.m_undecodedFlosses.take(flossScheme));
     }
 
-    return nullptr;
+    return flossScheme;
 }
 
 
@@ -218,33 +242,213 @@ bool SchemeManager::writeScheme(QString name)
 
 /**
     Get a list of files that contain xml schemes, iterating each one to create a new FlossScheme instance
-    and read the scheme.  Each path found is added to the KDirWatch instance to allow automatic reload of scheme
-    data if it is changed outside of KXStitch.
+    and read the scheme.
+    Parsing the xml files is slow, so the parsed schemes are kept in a binary cache keyed by the path,
+    modification time and size of each file. Files that have not changed since the cache was written are
+    not parsed, only their names are read and the flosses are decoded when the scheme is first used.
     Assumes that local resources are given before global ones and should take priority.
     */
 void SchemeManager::refresh()
 {
+    QHash<QString, CachedScheme> cache = readCache();
+    QHash<QString, CachedScheme> updatedCache;
+    bool cacheChanged = false;
+
     const QStringList dirs = QStandardPaths::locateAll(QStandardPaths::DataLocation, QStringLiteral("schemes"), QStandardPaths::LocateDirectory);
 
     Q_FOREACH (const QString &dir, dirs) {
         QDirIterator it(dir, QStringList() << QLatin1String("*.xml"));
 
         while (it.hasNext()) {
-            FlossScheme *flossScheme = readScheme(it.next());
-
-            if (flossScheme) {
-                for (int i = 0 ; i < m_flossSchemes.count() ; ++i) {
-                    if (m_flossSchemes.at(i)->schemeName() == flossScheme->schemeName()) {
-                        delete flossScheme;
-                        flossScheme = nullptr;
-                        break;
-                    }
-                }
+            QString path = it.next();
+            QFileInfo fileInfo(path);
+            FlossScheme *flossScheme = nullptr;
+            QByteArray flosses;
+
+            CachedScheme cached = cache.value(path);
+
+            if (cache.contains(path) && cached.modified == fileInfo.lastModified().toMSecsSinceEpoch() && cached.size == fileInfo.size()) {
+                flossScheme = new FlossScheme;
+                flossScheme->setSchemeName(cached.schemeName);
+                flossScheme->setPath(path);
+                flosses = cached.flosses;
+            } else if ((flossScheme = readScheme(path))) {
+                cached.modified = fileInfo.lastModified().toMSecsSinceEpoch();
+                cached.size = fileInfo.size();
+                cached.schemeName = flossScheme->schemeName();
+                cached.flosses = encodeFlosses(flossScheme);
+                cacheChanged = true;
+            } else {
+                continue;
+            }
+
+            updatedCache.insert(path, cached);
 
-                if (flossScheme) {
-                    m_flossSchemes.append(flossScheme);
+            if (m_schemesByName.contains(flossScheme->schemeName())) {
+                delete flossScheme;
+            } else {
+                addScheme(flossScheme);
+
+                if (!flosses.isEmpty()) {
+                    m_undecodedFlosses.insert(flossScheme, flosses);
                 }
             }
         }
     }
+
+    if (cacheChanged || updatedCache.count() != cache.count()) {
+        writeCache(updatedCache);
+    }
+}
+
+
+/**
+    Add a scheme to the list of schemes.
+    @param flossScheme a pointer to the FlossScheme, the SchemeManager takes ownership
+    */
+void SchemeManager::addScheme(FlossScheme *flossScheme)
+{
+    QMutexLocker locker(&m_mutex);
+    m_flossSchemes.append(flossScheme);
+    m_schemesByName.insert(flossScheme->schemeName(), flossScheme);
+}
+
+
+/**
+    Read the scheme cache.
+    The file is read with a single read and parsed from memory, any error results in an empty cache
+    which will cause all the schemes to be parsed from the xml files.
+    @return a QHash of CachedScheme keyed by the path of the xml file
+    */
+QHash<QString, SchemeManager::CachedScheme> SchemeManager::readCache() const
+{
+    QHash<QString, CachedScheme> cache;
+    QFile cacheFile(cachePath());
+
+    if (!cacheFile.open(QIODevice::ReadOnly)) {
+        return cache;
+    }
+
+    QByteArray data = cacheFile.readAll();
+    cacheFile.close();
+
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    QString magic;
+    qint32 version;
+    qint32 count;
+
+    stream >> magic >> version >> count;
+
+    if (stream.status() != QDataStream::Ok || magic != QLatin1String("KXStitchSchemeCache") || version != cacheVersion) {
+        return cache;
+    }
+
+    while (count--) {
+        QString path;
+        CachedScheme cached;
+
+        stream >> path >> cached.modified >> cached.size >> cached.schemeName >> cached.flosses;
+
+        if (stream.status() != QDataStream::Ok) {
+            return QHash<QString, CachedScheme>();
+        }
+
+        cache.insert(path, cached);
+    }
+
+    return cache;
+}
+
+
+/**
+    Write the scheme cache.
+    The cache is an optimisation only, so failing to write it is not reported.
+    @param cache a const reference to a QHash of CachedScheme keyed by the path of the xml file
+    */
+void SchemeManager::writeCache(const QHash<QString, CachedScheme> &cache) const
+{
+    QString path = cachePath();
+
+    if (path.isEmpty() || !QDir().mkpath(QFileInfo(path).path())) {
+        return;
+    }
+
+    QSaveFile cacheFile(path);
+
+    if (!cacheFile.open(QIODevice::WriteOnly)) {
+        return;
+    }
+
+    QDataStream stream(&cacheFile);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    stream << QStringLiteral("KXStitchSchemeCache") << qint32(cacheVersion) << qint32(cache.count());
+
+    for (QHash<QString, CachedScheme>::const_iterator i = cache.constBegin() ; i != cache.constEnd() ; ++i) {
+        stream << i.key() << i.value().modified << i.value().size << i.value().schemeName << i.value().flosses;
+    }
+
+    if (stream.status() == QDataStream::Ok) {
+        cacheFile.commit();
+    } else {
+        cacheFile.cancelWriting();
+    }
+}
+
+
+/**
+    Get the path of the scheme cache.
+    @return a QString of the path, this may be empty if there is no cache location
+    */
+QString SchemeManager::cachePath()
+{
+    QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    return (cacheDir.isEmpty()) ? QString() : cacheDir + QLatin1String("/schemes.cache");
+}
+
+
+/**
+    Encode the flosses of a scheme for the cache.
+    @param flossScheme a const pointer to the FlossScheme
+    @return a QByteArray containing the encoded flosses
+    */
+QByteArray SchemeManager::encodeFlosses(const FlossScheme *flossScheme)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    stream << qint32(flossScheme->flosses().count());
+
+    foreach (const Floss *floss, flossScheme->flosses()) {
+        stream << floss->name() << floss->description() << floss->color();
+    }
+
+    return data;
+}
+
+
+/**
+    Decode the flosses of a scheme read from the cache and add them to the scheme.
+    @param flossScheme a pointer to the FlossScheme
+    @param data a const reference to the QByteArray created by encodeFlosses
+    */
+void SchemeManager::decodeFlosses(FlossScheme *flossScheme, const QByteArray &data)
+{
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    qint32 count;
+    stream >> count;
+
+    while (count-- > 0 && stream.status() == QDataStream::Ok) {
+        QString name;
+        QString description;
+        QColor color;
+
+        stream >> name >> description >> color;
+        flossScheme->addFloss(new Floss(name, description, color));
+    }
 }
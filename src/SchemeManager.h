@@ -13,8 +13,11 @@
 #define SchemeManager_H
 
 
+#include <QByteArray>
 #include <QColor>
+#include <QHash>
 #include <QList>
+#include <QMutex>
 #include <QStringList>
 
 #include <KDirWatch>
@@ -38,14 +41,34 @@ public:
 
 
 private:
+    class CachedScheme
+    {
+    public:
+        qint64      modified;
+        qint64      size;
+        QString     schemeName;
+        QByteArray  flosses;
+    };
+
     static SchemeManager &self();
     SchemeManager();
 
     void refresh();
+    void addScheme(FlossScheme *);
+    QHash<QString, CachedScheme> readCache() const;
+    void writeCache(const QHash<QString, CachedScheme> &) const;
+
+    static QString cachePath();
+    static QByteArray encodeFlosses(const FlossScheme *);
+    static void decodeFlosses(FlossScheme *, const QByteArray &);
 
     static SchemeManager            *schemeManager;
+    static const int                cacheVersion = 100;
     typedef QMap<QString, QColor>   CalibratedColor;
     QList<FlossScheme *>            m_flossSchemes;
+    QHash<QString, FlossScheme *>   m_schemesByName;
+    QHash<FlossScheme *, QByteArray>    m_undecodedFlosses;   // schemes read from the cache whose flosses have not been needed yet
+    mutable QMutex                  m_mutex;    // guards the lookup and decoding, schemes are requested by the render threads
 };
 
 
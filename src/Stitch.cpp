@@ -20,6 +20,7 @@
 #include <KLocalizedString>
 
 #include "Exceptions.h"
+#include "MemoryAccounting.h"
 
 
 /**
@@ -94,7 +95,7 @@ StitchQueue::~StitchQueue()
 }
 
 
-StitchQueue::StitchQueue(StitchQueue *stitchQueue)
+StitchQueue::StitchQueue(const StitchQueue *stitchQueue)
 {
     QListIterator<Stitch *> stitchIterator(*stitchQueue);
 
@@ -105,6 +106,18 @@ StitchQueue::StitchQueue(StitchQueue *stitchQueue)
 }
 
 
+/**
+    Estimate the memory used by a queue allocated on the heap and its stitches.
+    @return the number of bytes used
+    */
+qint64 StitchQueue::memoryUsage() const
+{
+    return MemoryAccounting::heapBlock(sizeof(StitchQueue)) +
+           MemoryAccounting::heapBlock(sizeof(QListData::Data) + count() * sizeof(Stitch *)) +
+           count() * MemoryAccounting::heapBlock(sizeof(Stitch));
+}
+
+
 /**
     Add a stitch to the queue.
     @param type a Stitch::Type value to be added
@@ -62,13 +62,15 @@ class StitchQueue : public QQueue<Stitch *>
 {
 public:
     StitchQueue();
-    explicit StitchQueue(StitchQueue *);
+    explicit StitchQueue(const StitchQueue *);
     ~StitchQueue();
 
     int add(Stitch::Type, int);
     Stitch *find(Stitch::Type, int);
     int remove(Stitch::Type, int);
 
+    qint64 memoryUsage() const;
+
     static const int version = 100;
 };
 
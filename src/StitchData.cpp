@@ -11,9 +11,14 @@
 
 #include "StitchData.h"
 
+#include <algorithm>
+
 #include <KLocalizedString>
 
 #include "Exceptions.h"
+#include "PatternSnapshot.h"
+#include "Rasterizer.h"
+#include "StitchGrid.h"
 
 
 FlossUsage::FlossUsage()
@@ -74,8 +79,10 @@ StitchData::~StitchData()
 
 void StitchData::clear()
 {
-    qDeleteAll(m_stitches);
-    m_stitches.fill(nullptr);
+    m_changedArea = QRect();    // changes to the whole pattern are not recorded
+    invalidateSnapshot();
+
+    m_stitches.deleteAll();
 
     qDeleteAll(m_backstitches);
     m_backstitches.clear();
@@ -99,32 +106,18 @@ int StitchData::height() const
 
 void StitchData::resize(int width, int height)
 {
-    QVector<StitchQueue *> newVector(width * height);
-    QRect extentsRect = extents();
-
-    for (int y = extentsRect.top() ; y <= extentsRect.bottom() ; ++y) {
-        for (int x = extentsRect.left() ; x <= extentsRect.right() ; ++x) {
-            newVector[y * width + x] = takeStitchQueueAt(x, y);
-        }
-    }
-
-    m_stitches = newVector;
+    m_stitches.resize(width, height);
     m_width = width;
     m_height = height;
+    m_changedArea = QRect();
+    invalidateSnapshot();
 }
 
 
 void StitchData::insertColumns(int startColumn, int columns)
 {
-    int originalWidth = m_width;
-
-    resize(originalWidth + columns, m_height);
-
-    for (int y = 0 ; y < m_height ; ++y) {
-        for (int destinationColumn = m_width - 1, sourceColumn = originalWidth - 1 ; sourceColumn >= startColumn ; --destinationColumn, --sourceColumn) {
-            m_stitches[index(destinationColumn, y)] = takeStitchQueueAt(sourceColumn, y);
-        }
-    }
+    m_stitches.insertColumns(startColumn, columns);
+    m_width = m_stitches.width();
 
     startColumn *= 2;
     columns *= 2;
@@ -152,20 +145,16 @@ void StitchData::insertColumns(int startColumn, int columns)
             knot->position.setX(knot->position.x() + columns);
         }
     }
+
+    m_changedArea = QRect();
+    invalidateSnapshot();
 }
 
 
 void StitchData::insertRows(int startRow, int rows)
 {
-    int originalHeight = m_height;
-
-    resize(m_width, originalHeight + rows);
-
-    for (int destinationRow = m_height - 1, sourceRow = originalHeight - 1; sourceRow >= startRow ; --destinationRow, --sourceRow) {
-        for (int x = 0 ; x < m_width ; ++x) {
-            m_stitches[index(x, destinationRow)] = takeStitchQueueAt(x, sourceRow);
-        }
-    }
+    m_stitches.insertRows(startRow, rows);
+    m_height = m_stitches.height();
 
     startRow *= 2;
     rows *= 2;
@@ -193,16 +182,16 @@ void StitchData::insertRows(int startRow, int rows)
             knot->position.setY(knot->position.y() + rows);
         }
     }
+
+    m_changedArea = QRect();
+    invalidateSnapshot();
 }
 
 
 void StitchData::removeColumns(int startColumn, int columns)
 {
-    for (int y = 0 ; y < m_height ; ++y) {
-        for (int destinationColumn = startColumn, sourceColumn = startColumn + columns ; sourceColumn < m_width ; ++destinationColumn, ++sourceColumn) {
-            m_stitches[index(destinationColumn, y)] = takeStitchQueueAt(sourceColumn, y);
-        }
-    }
+    m_stitches.removeColumns(startColumn, columns);
+    m_width = m_stitches.width();
 
     int snapStartColumn = startColumn * 2;
     int snapColumns = columns * 2;
@@ -231,17 +220,15 @@ void StitchData::removeColumns(int startColumn, int columns)
         }
     }
 
-    resize(m_width - columns, m_height);
+    m_changedArea = QRect();
+    invalidateSnapshot();
 }
 
 
 void StitchData::removeRows(int startRow, int rows)
 {
-    for (int destinationRow = startRow, sourceRow = startRow + rows ; sourceRow < m_height ; ++destinationRow, ++sourceRow) {
-        for (int x = 0 ; x < m_width ; ++x) {
-            m_stitches[index(x, destinationRow)] = takeStitchQueueAt(x, sourceRow);
-        }
-    }
+    m_stitches.removeRows(startRow, rows);
+    m_height = m_stitches.height();
 
     int snapStartRow = startRow * 2;
     int snapRows = rows * 2;
@@ -270,7 +257,8 @@ void StitchData::removeRows(int startRow, int rows)
         }
     }
 
-    resize(m_width, m_height - rows);
+    m_changedArea = QRect();
+    invalidateSnapshot();
 }
 
 
@@ -278,13 +266,9 @@ QRect StitchData::extents() const
 {
     QRect extentsRect;
 
-    for (int y = 0 ; y < m_height ; ++y) {
-        for (int x = 0 ; x < m_width ; ++x) {
-            if (m_stitches.at(index(x, y))) {
-                extentsRect |= QRect(x * 2, y * 2, 2, 2);
-            }
-        }
-    }
+    m_stitches.forEach([&extentsRect](int x, int y, StitchQueue *) {
+        extentsRect |= QRect(x * 2, y * 2, 2, 2);
+    });
 
     QListIterator<Backstitch *> backstitchIterator(m_backstitches);
 
@@ -312,17 +296,9 @@ QRect StitchData::extents() const
 
 void StitchData::movePattern(int dx, int dy)
 {
-    QRect extentsRect = extents();
-
-    QVector<StitchQueue *> newVector(m_width * m_height);
-
-    for (int y = extentsRect.top() ; y <= extentsRect.bottom() ; ++y) {
-        for (int x = extentsRect.left() ; x <= extentsRect.right() ; ++x) {
-            newVector[index(x + dx, y + dy)] = takeStitchQueueAt(x, y);
-        }
-    }
-
-    m_stitches = newVector;
+    relocateStitches(m_width, m_height, [dx, dy](int x, int y, StitchQueue *) {
+        return QPoint(x + dx, y + dy);
+    });
 
     dx *= 2;
     dy *= 2;
@@ -338,45 +314,18 @@ void StitchData::movePattern(int dx, int dy)
     while (knotIterator.hasNext()) {
         knotIterator.next()->move(dx, dy);
     }
+
+    m_changedArea = QRect();
+    invalidateSnapshot();
 }
 
 
 void StitchData::mirror(Qt::Orientation orientation)
 {
-    int rows = m_height;
-    int cols = m_width;
-
-    if (orientation == Qt::Vertical) {
-        rows = rows / 2 + rows % 2;
-    } else {
-        cols = cols / 2 + cols % 2;
-    }
-
-    for (int row = 0 ; row < rows ; ++row) {
-        for (int col = 0 ; col < cols ; ++col) {
-            QPoint srcCell(col, row);
-            QPoint dstCell;
-
-            if (orientation == Qt::Vertical) {
-                dstCell = QPoint(col, m_height - row - 1);
-            } else {
-                dstCell = QPoint(m_width - col - 1, row);
-            }
-
-            StitchQueue *src = takeStitchQueueAt(srcCell);
-            StitchQueue *dst = takeStitchQueueAt(dstCell);
-
-            if (src) {
-                invertQueue(orientation, src);
-                replaceStitchQueueAt(dstCell, src);
-            }
-
-            if (dst) {
-                invertQueue(orientation, dst);
-                replaceStitchQueueAt(srcCell, dst);
-            }
-        }
-    }
+    relocateStitches(m_width, m_height, [this, orientation](int x, int y, StitchQueue *stitchQueue) -> QPoint {
+        invertQueue(orientation, stitchQueue);
+        return (orientation == Qt::Vertical) ? QPoint(x, m_height - y - 1) : QPoint(m_width - x - 1, y);
+    });
 
     int maxXSnap = m_width * 2;
     int maxYSnap = m_height * 2;
@@ -405,6 +354,9 @@ void StitchData::mirror(Qt::Orientation orientation)
             knot->position.setY(maxYSnap - knot->position.y());
         }
     }
+
+    m_changedArea = QRect();
+    invalidateSnapshot();
 }
 
 
@@ -412,42 +364,23 @@ void StitchData::rotate(Rotation rotation)
 {
     int rows = m_height;
     int cols = m_width;
+    int width = (rotation == Rotate180) ? cols : rows;
+    int height = (rotation == Rotate180) ? rows : cols;
 
-    QVector<StitchQueue *> rotatedData(m_width * m_height);
+    relocateStitches(width, height, [this, rotation, rows, cols](int x, int y, StitchQueue *stitchQueue) -> QPoint {
+        rotateQueue(rotation, stitchQueue);
 
-    for (int y = 0 ; y < rows ; ++y) {
-        for (int x = 0 ; x < cols ; ++x) {
-            StitchQueue *src = takeStitchQueueAt(x, y);
-            int index = (cols - x - 1) * rows + y; // default to Rotate90
-
-            switch (rotation) {
-            case Rotate90:
-                // index = (cols - x - 1) * rows + y;
-                break;
-
-            case Rotate180:
-                index = (rows - y - 1) * cols + (cols - x - 1);
-                break;
+        switch (rotation) {
+        case Rotate180:
+            return QPoint(cols - x - 1, rows - y - 1);
 
-            case Rotate270:
-                index = x * rows + (rows - y - 1);
-                break;
-            }
+        case Rotate270:
+            return QPoint(rows - y - 1, x);
 
-            if (src) {
-                rotateQueue(rotation, src);
-                rotatedData[index] = src;
-            }
+        default:    // Rotate90
+            return QPoint(y, cols - x - 1);
         }
-    }
-
-    if ((rotation == Rotate90) || (rotation == Rotate270)) {
-        int height = m_height;
-        m_height = m_width;
-        m_width = height;
-    }
-
-    m_stitches = rotatedData;
+    });
 
     int maxXSnap = m_width * 2;
     int maxYSnap = m_height * 2;
@@ -493,6 +426,9 @@ void StitchData::rotate(Rotation rotation)
             break;
         }
     }
+
+    m_changedArea = QRect();
+    invalidateSnapshot();
 }
 
 
@@ -628,15 +564,37 @@ void StitchData::rotateQueue(Rotation rotation, StitchQueue *queue)
 }
 
 
-int StitchData::index(int x, int y) const
+/**
+    Move the stitch queues to a new grid, this is used by the operations that
+    move, mirror or rotate all of the stitches. Only the cells that have
+    stitches are visited, so the time taken depends on the number of stitches
+    rather than the size of the pattern.
+    @param width the new width in cells
+    @param height the new height in cells
+    @param relocate a function taking the column, row and a pointer to the
+    StitchQueue of each cell and returning the new cell, the function may change
+    the StitchQueue. Queues moved outside of the new size are deleted.
+    */
+void StitchData::relocateStitches(int width, int height, const std::function<QPoint(int, int, StitchQueue *)> &relocate)
 {
-    return y * m_width + x;
-}
+    StitchGrid stitches;
+    stitches.reset(width, height);
 
+    m_stitches.forEach([&stitches, &relocate](int x, int y, StitchQueue *stitchQueue) {
+        QPoint cell = relocate(x, y, stitchQueue);
 
-int StitchData::index(const QPoint &cell) const
-{
-    return index(cell.x(), cell.y());
+        if ((cell.x() >= 0) && (cell.x() < stitches.width()) && (cell.y() >= 0) && (cell.y() < stitches.height())) {
+            stitches.set(cell.x(), cell.y(), stitchQueue);
+        } else {
+            delete stitchQueue;
+        }
+    });
+
+    m_stitches.swap(stitches);
+    m_width = width;
+    m_height = height;
+    m_changedArea = QRect();
+    invalidateSnapshot();
 }
 
 
@@ -646,17 +604,119 @@ bool StitchData::isValid(int x, int y) const
 }
 
 
+/**
+    Add an area to the changed area.
+    @param cells a QRect in cells
+    */
+void StitchData::markChanged(const QRect &cells)
+{
+    m_changedArea |= cells;
+
+    if (m_snapshotTilesValid.isEmpty()) {
+        return;
+    }
+
+    QRect area = cells & QRect(0, 0, m_width, m_height);
+
+    if (area.isEmpty()) {
+        return;
+    }
+
+    int tileSize = StitchDataSnapshot::tileSize;
+    int columns = (m_width + tileSize - 1) / tileSize;
+
+    for (int row = area.top() / tileSize ; row <= area.bottom() / tileSize ; ++row) {
+        for (int column = area.left() / tileSize ; column <= area.right() / tileSize ; ++column) {
+            m_snapshotTilesValid.clearBit(row * columns + column);
+        }
+    }
+}
+
+
+/**
+    Add the cells covered by a line between two snap points to the changed
+    area, a one cell margin is included to allow for the width of the lines and
+    the size of knots drawn on cell boundaries.
+    @param start the start snap point
+    @param end the end snap point, this will be the same as start for knots
+    */
+void StitchData::markSnapChanged(const QPoint &start, const QPoint &end)
+{
+    QPoint topLeft(std::min(start.x(), end.x()) / 2, std::min(start.y(), end.y()) / 2);
+    QPoint bottomRight(std::max(start.x(), end.x()) / 2, std::max(start.y(), end.y()) / 2);
+
+    markChanged(QRect(topLeft, bottomRight).adjusted(-1, -1, 1, 1));
+
+    m_snapshotBackstitches.clear();
+    m_snapshotKnots.clear();
+}
+
+
+/**
+    Test if a snap point lies within any of a list of areas.
+    @param snapAreas a QList of QRect in snap coordinates
+    @param snap the snap point to test
+    @return true if the point is in one of the areas, false otherwise
+    */
+bool StitchData::inSnapAreas(const QList<QRect> &snapAreas, const QPoint &snap)
+{
+    foreach (const QRect &snapArea, snapAreas) {
+        if (snapArea.contains(snap)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
 void StitchData::addStitch(const QPoint &position, Stitch::Type type, int colorIndex)
 {
-    int i = index(position);
-    StitchQueue *stitchQueue = m_stitches.at(i);
+    StitchQueue *stitchQueue = m_stitches.at(position.x(), position.y());
 
     if (stitchQueue == nullptr) {
         stitchQueue = new StitchQueue;
-        m_stitches[i] = stitchQueue;
+        m_stitches.set(position.x(), position.y(), stitchQueue);
     }
 
     stitchQueue->add(type, colorIndex);
+    markChanged(QRect(position, QSize(1, 1)));
+}
+
+
+/**
+    Add the same stitch to every cell covered by a set of spans.
+    Each span is a contiguous run of cells in a row, so the changed area is
+    marked once for each span rather than for each cell.
+    @param spans a QVector of Span, cells outside of the pattern are ignored
+    @param type the Stitch::Type to add
+    @param colorIndex the palette index of the stitches
+    */
+void StitchData::addStitches(const QVector<Span> &spans, Stitch::Type type, int colorIndex)
+{
+    foreach (const Span &span, spans) {
+        if (span.row < 0 || span.row >= m_height) {
+            continue;
+        }
+
+        int left = std::max(span.left, 0);
+        int right = std::min(span.right, m_width - 1);
+
+        for (int x = left ; x <= right ; ++x) {
+            StitchQueue *stitchQueue = m_stitches.at(x, span.row);
+
+            if (stitchQueue == nullptr) {
+                stitchQueue = new StitchQueue;
+                m_stitches.set(x, span.row, stitchQueue);
+            }
+
+            stitchQueue->add(type, colorIndex);
+        }
+
+        if (left <= right) {
+            markChanged(QRect(QPoint(left, span.row), QPoint(right, span.row)));
+        }
+    }
 }
 
 
@@ -677,14 +737,15 @@ Stitch *StitchData::findStitch(const QPoint &cell, Stitch::Type type, int colorI
 
 void StitchData::deleteStitch(const QPoint &position, Stitch::Type type, int colorIndex)
 {
-    int i = index(position);
-    StitchQueue *stitchQueue = m_stitches.at(i);
+    StitchQueue *stitchQueue = m_stitches.at(position.x(), position.y());
 
     if (stitchQueue) {
         if (stitchQueue->remove(type, colorIndex) == 0) {
-            m_stitches[i] = nullptr;
+            m_stitches.set(position.x(), position.y(), nullptr);
             delete stitchQueue;
         }
+
+        markChanged(QRect(position, QSize(1, 1)));
     }
 }
 
@@ -694,7 +755,7 @@ StitchQueue *StitchData::stitchQueueAt(int x, int y)
     StitchQueue *stitchQueue = nullptr;
 
     if (isValid(x, y)) {
-        stitchQueue = m_stitches.at(index(x, y));
+        stitchQueue = m_stitches.at(x, y);
     }
 
     return stitchQueue;
@@ -712,7 +773,8 @@ StitchQueue *StitchData::takeStitchQueueAt(int x, int y)
     StitchQueue *stitchQueue = stitchQueueAt(x, y);
 
     if (stitchQueue) {
-        m_stitches[index(x, y)] = nullptr;
+        m_stitches.set(x, y, nullptr);
+        markChanged(QRect(x, y, 1, 1));
     }
 
     return stitchQueue;
@@ -730,7 +792,8 @@ StitchQueue *StitchData::replaceStitchQueueAt(int x, int y, StitchQueue *stitchQ
     StitchQueue *originalQueue = takeStitchQueueAt(x, y);
 
     if (isValid(x, y)) {
-        m_stitches[index(x, y)] = stitchQueue;
+        m_stitches.set(x, y, stitchQueue);
+        markChanged(QRect(x, y, 1, 1));
     }
 
     return originalQueue;
@@ -745,13 +808,14 @@ StitchQueue *StitchData::replaceStitchQueueAt(const QPoint &position, StitchQueu
 
 void StitchData::addBackstitch(const QPoint &start, const QPoint &end, int colorIndex)
 {
-    m_backstitches.append(new Backstitch(start, end, colorIndex));
+    addBackstitch(new Backstitch(start, end, colorIndex));
 }
 
 
 void StitchData::addBackstitch(Backstitch *backstitch)
 {
     m_backstitches.append(backstitch);
+    markSnapChanged(backstitch->start, backstitch->end);
 }
 
 
@@ -773,7 +837,11 @@ Backstitch *StitchData::findBackstitch(const QPoint &start, const QPoint &end, i
 Backstitch *StitchData::takeBackstitch(const QPoint &start, const QPoint &end, int colorIndex)
 {
     Backstitch *removed = findBackstitch(start, end, colorIndex);
-    m_backstitches.removeOne(removed);
+
+    if (removed) {
+        m_backstitches.removeOne(removed);
+        markSnapChanged(removed->start, removed->end);
+    }
 
     return removed;
 }
@@ -785,6 +853,7 @@ Backstitch *StitchData::takeBackstitch(Backstitch *backstitch)
 
     if (m_backstitches.removeOne(backstitch)) {
         removed = backstitch;
+        markSnapChanged(removed->start, removed->end);
     }
 
     return removed;
@@ -793,13 +862,14 @@ Backstitch *StitchData::takeBackstitch(Backstitch *backstitch)
 
 void StitchData::addFrenchKnot(const QPoint &position, int colorIndex)
 {
-    m_knots.append(new Knot(position, colorIndex));
+    addFrenchKnot(new Knot(position, colorIndex));
 }
 
 
 void StitchData::addFrenchKnot(Knot *knot)
 {
     m_knots.append(knot);
+    markSnapChanged(knot->position, knot->position);
 }
 
 
@@ -824,6 +894,7 @@ Knot *StitchData::takeFrenchKnot(const QPoint &position, int colorIndex)
 
     if (removed) {
         m_knots.removeOne(removed);
+        markSnapChanged(removed->position, removed->position);
     }
 
     return removed;
@@ -836,6 +907,7 @@ Knot *StitchData::takeFrenchKnot(Knot *knot)
 
     if (m_knots.removeOne(knot)) {
         removed = knot;
+        markSnapChanged(removed->position, removed->position);
     }
 
     return removed;
@@ -862,6 +934,7 @@ QListIterator<Backstitch *> StitchData::backstitchIterator()
 
 QMutableListIterator<Backstitch *> StitchData::mutableBackstitchIterator()
 {
+    m_snapshotBackstitches.clear();  // the backstitches may be removed or changed
     return QMutableListIterator<Backstitch *>(m_backstitches);
 }
 
@@ -874,10 +947,332 @@ QListIterator<Knot *> StitchData::knotIterator()
 
 QMutableListIterator<Knot *> StitchData::mutableKnotIterator()
 {
+    m_snapshotKnots.clear();  // the knots may be removed or changed
     return QMutableListIterator<Knot *>(m_knots);
 }
 
 
+/**
+    Save the stitches in a set of areas so that they can be restored by restoreArea.
+    This is used by commands that only change part of the pattern, so that the
+    undo data is proportional to the size of the areas rather than the size of
+    the pattern.
+    The cells of each area are saved along with any backstitches and knots that
+    lie entirely within the areas, including their right and bottom edges.
+    @param areas a QList of QRect in cells, these are clipped to the pattern
+    @return a QByteArray containing the saved data
+    */
+QByteArray StitchData::saveArea(const QList<QRect> &areas) const
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    QList<QRect> clippedAreas;
+    QList<QRect> snapAreas;
+
+    foreach (const QRect &area, areas) {
+        QRect clippedArea = area.normalized() & QRect(0, 0, m_width, m_height);
+
+        if (clippedArea.isValid()) {
+            clippedAreas.append(clippedArea);
+            snapAreas.append(QRect(clippedArea.left() * 2, clippedArea.top() * 2, clippedArea.width() * 2 + 1, clippedArea.height() * 2 + 1));
+        }
+    }
+
+    stream << qint32(clippedAreas.count());
+
+    foreach (const QRect &area, clippedAreas) {
+        stream << area;
+
+        for (int row = area.top() ; row <= area.bottom() ; ++row) {
+            for (int column = area.left() ; column <= area.right() ; ++column) {
+                StitchQueue *stitchQueue = m_stitches.at(column, row);
+                stream << qint8(stitchQueue != nullptr);
+
+                if (stitchQueue) {
+                    stream << *stitchQueue;
+                }
+            }
+        }
+    }
+
+    QList<Backstitch *> backstitches;
+
+    foreach (Backstitch *backstitch, m_backstitches) {
+        if (inSnapAreas(snapAreas, backstitch->start) && inSnapAreas(snapAreas, backstitch->end)) {
+            backstitches.append(backstitch);
+        }
+    }
+
+    stream << qint32(backstitches.count());
+
+    foreach (Backstitch *backstitch, backstitches) {
+        stream << *backstitch;
+    }
+
+    QList<Knot *> knots;
+
+    foreach (Knot *knot, m_knots) {
+        if (inSnapAreas(snapAreas, knot->position)) {
+            knots.append(knot);
+        }
+    }
+
+    stream << qint32(knots.count());
+
+    foreach (Knot *knot, knots) {
+        stream << *knot;
+    }
+
+    return data;
+}
+
+
+/**
+    Restore the stitches saved by saveArea.
+    The cells of the saved areas are replaced and any backstitches and knots
+    lying entirely within the areas are replaced by the saved ones, everything
+    outside of the areas is unchanged.
+    @param data a QByteArray returned by saveArea
+    */
+void StitchData::restoreArea(const QByteArray &data)
+{
+    QDataStream stream(data);
+    QList<QRect> snapAreas;
+    qint32 areas;
+    qint32 count;
+    qint8 present;
+
+    stream >> areas;
+
+    while (areas--) {
+        QRect area;
+        stream >> area;
+        snapAreas.append(QRect(area.left() * 2, area.top() * 2, area.width() * 2 + 1, area.height() * 2 + 1));
+
+        for (int row = area.top() ; row <= area.bottom() ; ++row) {
+            for (int column = area.left() ; column <= area.right() ; ++column) {
+                StitchQueue *stitchQueue = nullptr;
+                stream >> present;
+
+                if (present) {
+                    stitchQueue = new StitchQueue;
+                    stream >> *stitchQueue;
+                }
+
+                delete replaceStitchQueueAt(column, row, stitchQueue);
+            }
+        }
+    }
+
+    QMutableListIterator<Backstitch *> backstitchIterator(m_backstitches);
+
+    while (backstitchIterator.hasNext()) {
+        Backstitch *backstitch = backstitchIterator.next();
+
+        if (inSnapAreas(snapAreas, backstitch->start) && inSnapAreas(snapAreas, backstitch->end)) {
+            backstitchIterator.remove();
+            markSnapChanged(backstitch->start, backstitch->end);
+            delete backstitch;
+        }
+    }
+
+    stream >> count;
+
+    while (count--) {
+        Backstitch *backstitch = new Backstitch;
+        stream >> *backstitch;
+        addBackstitch(backstitch);
+    }
+
+    QMutableListIterator<Knot *> knotIterator(m_knots);
+
+    while (knotIterator.hasNext()) {
+        Knot *knot = knotIterator.next();
+
+        if (inSnapAreas(snapAreas, knot->position)) {
+            knotIterator.remove();
+            markSnapChanged(knot->position, knot->position);
+            delete knot;
+        }
+    }
+
+    stream >> count;
+
+    while (count--) {
+        Knot *knot = new Knot;
+        stream >> *knot;
+        addFrenchKnot(knot);
+    }
+}
+
+
+/**
+    Get the area changed since the last call, so that views can update only the
+    cells that have changed.
+    Adding, removing or replacing stitches, backstitches and knots is recorded.
+    Operations that affect the whole pattern, such as clear, resize, inserting
+    or removing rows and columns, are not recorded and discard any area
+    recorded so far, the callers of these redraw everything anyway.
+    @return a QRect in cells, this will be invalid if nothing has changed
+    */
+QRect StitchData::takeChangedArea()
+{
+    QRect changedArea = m_changedArea & QRect(0, 0, m_width, m_height);
+    m_changedArea = QRect();
+
+    return changedArea;
+}
+
+
+/**
+    Take a snapshot of the stitches that can be read from another thread while
+    the StitchData continues to be changed.
+    The cells are copied in square tiles which are kept and shared with later
+    snapshots, so only the tiles that have changed since the previous snapshot
+    are copied again, and empty tiles are not copied at all. The backstitches
+    and knots are copied in the same way if any of them have changed.
+    Changes made through the stitch queues, backstitches or knots returned by
+    the other functions, rather than by the functions that change them, must
+    be followed by a call to invalidateSnapshot.
+    @return a StitchDataSnapshot
+    */
+StitchDataSnapshot StitchData::snapshot()
+{
+    int tileSize = StitchDataSnapshot::tileSize;
+    int columns = (m_width + tileSize - 1) / tileSize;
+    int rows = (m_height + tileSize - 1) / tileSize;
+
+    if (m_snapshotTilesValid.isEmpty()) {
+        m_snapshotTiles.fill(QSharedPointer<const StitchTile>(), columns * rows);
+        m_snapshotTilesValid.resize(columns * rows);
+    }
+
+    for (int tile = 0 ; tile < m_snapshotTiles.count() ; ++tile) {
+        if (!m_snapshotTilesValid.testBit(tile)) {
+            m_snapshotTiles[tile] = copyTile(QRect((tile % columns) * tileSize, (tile / columns) * tileSize, tileSize, tileSize) & QRect(0, 0, m_width, m_height));
+            m_snapshotTilesValid.setBit(tile);
+        }
+    }
+
+    if (m_snapshotBackstitches.isNull()) {
+        QVector<Backstitch> *backstitches = new QVector<Backstitch>;
+        backstitches->reserve(m_backstitches.count());
+
+        foreach (const Backstitch *backstitch, m_backstitches) {
+            backstitches->append(*backstitch);
+        }
+
+        m_snapshotBackstitches = QSharedPointer<const QVector<Backstitch> >(backstitches);
+    }
+
+    if (m_snapshotKnots.isNull()) {
+        QVector<Knot> *knots = new QVector<Knot>;
+        knots->reserve(m_knots.count());
+
+        foreach (const Knot *knot, m_knots) {
+            knots->append(*knot);
+        }
+
+        m_snapshotKnots = QSharedPointer<const QVector<Knot> >(knots);
+    }
+
+    StitchDataSnapshot snapshot;
+    snapshot.m_width = m_width;
+    snapshot.m_height = m_height;
+    snapshot.m_tiles = m_snapshotTiles;
+    snapshot.m_backstitches = m_snapshotBackstitches;
+    snapshot.m_knots = m_snapshotKnots;
+
+    return snapshot;
+}
+
+
+/**
+    Discard the tiles kept for snapshots so that the next snapshot copies
+    everything. This is used by operations that change the whole pattern and
+    after stitches, backstitches or knots have been changed in place, such as
+    when replacing a color.
+    */
+void StitchData::invalidateSnapshot()
+{
+    m_snapshotTiles.clear();
+    m_snapshotTilesValid.clear();
+    m_snapshotBackstitches.clear();
+    m_snapshotKnots.clear();
+}
+
+
+/**
+    Estimate the memory used by the stitches, backstitches and knots, and by
+    the tiles kept for snapshots. Tiles shared with snapshots that are still in
+    use are counted here.
+    @return the number of bytes used
+    */
+qint64 StitchData::memoryUsage() const
+{
+    qint64 usage = m_stitches.memoryUsage();
+
+    usage += MemoryAccounting::heapBlock(sizeof(QListData::Data) + m_backstitches.count() * sizeof(Backstitch *));
+    usage += m_backstitches.count() * MemoryAccounting::heapBlock(sizeof(Backstitch));
+    usage += MemoryAccounting::heapBlock(sizeof(QListData::Data) + m_knots.count() * sizeof(Knot *));
+    usage += m_knots.count() * MemoryAccounting::heapBlock(sizeof(Knot));
+
+    usage += MemoryAccounting::heapBlock(sizeof(QArrayData) + m_snapshotTiles.capacity() * sizeof(QSharedPointer<const StitchTile>));
+
+    foreach (const QSharedPointer<const StitchTile> &tile, m_snapshotTiles) {
+        if (tile) {
+            usage += MemoryAccounting::heapBlock(sizeof(StitchTile)) + MemoryAccounting::heapBlock(sizeof(QArrayData) + tile->stitchQueues.capacity() * sizeof(StitchQueue *));
+
+            foreach (const StitchQueue *stitchQueue, tile->stitchQueues) {
+                if (stitchQueue) {
+                    usage += stitchQueue->memoryUsage();
+                }
+            }
+        }
+    }
+
+    if (m_snapshotBackstitches) {
+        usage += MemoryAccounting::heapBlock(sizeof(QArrayData) + m_snapshotBackstitches->capacity() * sizeof(Backstitch));
+    }
+
+    if (m_snapshotKnots) {
+        usage += MemoryAccounting::heapBlock(sizeof(QArrayData) + m_snapshotKnots->capacity() * sizeof(Knot));
+    }
+
+    return usage;
+}
+
+
+/**
+    Copy the stitch queues in an area to a new tile for a snapshot.
+    @param cells a QRect in cells, this should be within a single tile
+    @return a QSharedPointer to the StitchTile, this will be null if the area is empty
+    */
+QSharedPointer<const StitchTile> StitchData::copyTile(const QRect &cells) const
+{
+    int tileSize = StitchDataSnapshot::tileSize;
+    StitchTile *tile = nullptr;
+
+    if (m_stitches.isEmpty(cells)) {
+        return QSharedPointer<const StitchTile>();
+    }
+
+    for (int y = cells.top() ; y <= cells.bottom() ; ++y) {
+        for (int x = cells.left() ; x <= cells.right() ; ++x) {
+            if (StitchQueue *stitchQueue = m_stitches.at(x, y)) {
+                if (tile == nullptr) {
+                    tile = new StitchTile;
+                }
+
+                tile->stitchQueues[(y % tileSize) * tileSize + (x % tileSize)] = new StitchQueue(stitchQueue);
+            }
+        }
+    }
+
+    return QSharedPointer<const StitchTile>(tile);
+}
+
+
 QMap<int, FlossUsage> StitchData::flossUsage()
 {
     QMap<int, FlossUsage> usage;
@@ -907,21 +1302,15 @@ QMap<int, FlossUsage> StitchData::flossUsage()
         lengths.insert(Stitch::FrenchKnot, 2.0);
     }
 
-    QVectorIterator<StitchQueue *> stitchesIterator(m_stitches);
-
-    while (stitchesIterator.hasNext()) {
-        StitchQueue *stitchQueue = stitchesIterator.next();
+    m_stitches.forEach([&usage](int, int, StitchQueue *stitchQueue) {
+        QListIterator<Stitch *> stitchIterator(*stitchQueue);
 
-        if (stitchQueue) {
-            QListIterator<Stitch *> stitchIterator(*stitchQueue);
-
-            while (stitchIterator.hasNext()) {
-                Stitch *stitch = stitchIterator.next();
-                usage[stitch->colorIndex].stitchCounts[stitch->type]++;
-                usage[stitch->colorIndex].stitchLengths[stitch->type] += lengths[stitch->type];
-            }
+        while (stitchIterator.hasNext()) {
+            Stitch *stitch = stitchIterator.next();
+            usage[stitch->colorIndex].stitchCounts[stitch->type]++;
+            usage[stitch->colorIndex].stitchLengths[stitch->type] += lengths[stitch->type];
         }
-    }
+    });
 
 
     QListIterator<Backstitch *> backstitchIterator(m_backstitches);
@@ -950,26 +1339,13 @@ QDataStream &operator<<(QDataStream &stream, const StitchData &stitchData)
     stream << qint32(stitchData.m_width);
     stream << qint32(stitchData.m_height);
 
-    QVectorIterator<StitchQueue *> stitchesIterator(stitchData.m_stitches);
-    int queues = 0;
+    stream << qint32(stitchData.m_stitches.count());
 
-    while (stitchesIterator.hasNext()) {
-        if (stitchesIterator.next()) {
-            ++queues;
-        }
-    }
-
-    stream << qint32(queues);
-
-    for (int row = 0 ; row < stitchData.m_height ; ++row) {
-        for (int column = 0 ; column < stitchData.m_width ; ++column) {
-            if (StitchQueue *stitchQueue = stitchData.m_stitches[stitchData.index(column, row)]) {
-                stream << qint32(column);
-                stream << qint32(row);
-                stream << *stitchQueue;
-            }
-        }
-    }
+    stitchData.m_stitches.forEach([&stream](int column, int row, StitchQueue *stitchQueue) {
+        stream << qint32(column);
+        stream << qint32(row);
+        stream << *stitchQueue;
+    });
 
     QListIterator<Backstitch *> backstitchIterator(stitchData.m_backstitches);
     stream << qint32(stitchData.m_backstitches.count());
@@ -1180,5 +1556,8 @@ QDataStream &operator>>(QDataStream &stream, StitchData &stitchData)
         throw FailedReadFile(QString(i18n("Failed reading stitch data")));
     }
 
+    stitchData.m_changedArea = QRect();   // the caller redraws everything
+    stitchData.invalidateSnapshot();
+
     return stream;
 }
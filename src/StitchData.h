@@ -13,15 +13,27 @@
 #define StitchData_H
 
 
+#include <functional>
+
+#include <QBitArray>
+#include <QByteArray>
 #include <QList>
 #include <QListIterator>
 #include <QMap>
 #include <QPoint>
 #include <QRect>
 #include <QSharedDataPointer>
+#include <QSharedPointer>
 #include <QVector>
 
+#include "MemoryAccounting.h"
 #include "Stitch.h"
+#include "StitchGrid.h"
+
+
+class Span;
+class StitchDataSnapshot;
+class StitchTile;
 
 
 class FlossUsage
@@ -41,7 +53,7 @@ public:
 };
 
 
-class StitchData
+class StitchData : public MemoryAccountable
 {
 public:
     enum Rotation {
@@ -70,6 +82,7 @@ public:
     void rotate(Rotation);
 
     void addStitch(const QPoint &, Stitch::Type, int);
+    void addStitches(const QVector<Span> &, Stitch::Type, int);
     Stitch *findStitch(const QPoint &, Stitch::Type, int);
     void deleteStitch(const QPoint &, Stitch::Type, int);
 
@@ -102,6 +115,16 @@ public:
 
     QMap<int, FlossUsage> flossUsage();
 
+    QByteArray saveArea(const QList<QRect> &) const;
+    void restoreArea(const QByteArray &);
+
+    QRect takeChangedArea();
+
+    StitchDataSnapshot snapshot();
+    void invalidateSnapshot();
+
+    virtual qint64 memoryUsage() const Q_DECL_OVERRIDE;
+
     friend QDataStream &operator<<(QDataStream &, const StitchData &);
     friend QDataStream &operator>>(QDataStream &, StitchData &);
 
@@ -109,18 +132,30 @@ private:
     void    deleteStitches();
     void    invertQueue(Qt::Orientation, StitchQueue *);
     void    rotateQueue(Rotation, StitchQueue *);
-    int     index(int, int) const;
-    int     index(const QPoint &) const;
+    void    relocateStitches(int, int, const std::function<QPoint(int, int, StitchQueue *)> &);
     bool    isValid(int x, int y) const;
 
+    void    markChanged(const QRect &);
+    void    markSnapChanged(const QPoint &, const QPoint &);
+    QSharedPointer<const StitchTile> copyTile(const QRect &) const;
+
+    static bool inSnapAreas(const QList<QRect> &, const QPoint &);
+
     static const int version = 103;
 
     int m_width;
     int m_height;
 
-    QVector<StitchQueue *>                  m_stitches;
+    StitchGrid                              m_stitches;
     QList<Backstitch *>                     m_backstitches;
     QList<Knot *>                           m_knots;
+
+    QRect                                   m_changedArea;
+
+    QVector<QSharedPointer<const StitchTile> >  m_snapshotTiles;
+    QBitArray                                   m_snapshotTilesValid;
+    QSharedPointer<const QVector<Backstitch> >  m_snapshotBackstitches;
+    QSharedPointer<const QVector<Knot> >        m_snapshotKnots;
 };
 
 
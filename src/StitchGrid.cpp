@@ -0,0 +1,624 @@
+/*
+ * Copyright (C) 2026 by agent
+ * agent@local
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+/**
+    @file
+    Implement the StitchGrid class that holds the StitchQueue pointers for the
+    cells of a StitchData.
+    The cells are held in square chunks so that a large canvas that is mostly
+    empty, such as a mural or a banner, does not need a pointer for every cell.
+    Grids of up to denseCells cells have all their chunks allocated when they are
+    created and kept, so painting and erasing never allocate. Larger grids are
+    sparse, a chunk is only allocated when a cell in it is first set and is freed
+    again when its last cell is cleared, so the memory used is proportional to
+    the stitched area.
+
+    The rows and columns of the grid are mapped to physical rows and columns of
+    the chunks, so inserting or removing rows and columns only changes the maps
+    rather than moving the cells. Inserting rows or columns takes physical ones
+    that are free or adds new ones at the end, removing them deletes their
+    stitches and frees them for reuse. The time taken is proportional to the
+    number of rows or columns after the change for the maps, plus the number of
+    rows for each column inserted or removed, rather than the number of cells.
+    While no rows or columns have been inserted or removed the chunks are
+    aligned with the snapshot tiles.
+    */
+
+
+#include "StitchGrid.h"
+
+#include <algorithm>
+
+#include "MemoryAccounting.h"
+#include "Stitch.h"
+
+
+/**
+    Constructor.
+    All the cells of the chunk are initially empty.
+    */
+StitchChunk::StitchChunk()
+    :   count(0)
+{
+    std::fill(cells, cells + StitchGrid::chunkSize * StitchGrid::chunkSize, nullptr);
+}
+
+
+/**
+    Constructor.
+    Creates an empty grid with no cells.
+    */
+StitchGrid::StitchGrid()
+    :   m_width(0),
+        m_height(0),
+        m_sparse(false),
+        m_chunkColumns(0)
+{
+}
+
+
+/**
+    Destructor.
+    The chunks are deleted, the StitchQueues are owned by the StitchData and
+    should have been deleted or taken before the grid is destroyed.
+    */
+StitchGrid::~StitchGrid()
+{
+    foreach (const QVector<StitchChunk *> &chunks, m_chunks) {
+        qDeleteAll(chunks);
+    }
+}
+
+
+/**
+    Get the width of the grid.
+    @return the width in cells
+    */
+int StitchGrid::width() const
+{
+    return m_width;
+}
+
+
+/**
+    Get the height of the grid.
+    @return the height in cells
+    */
+int StitchGrid::height() const
+{
+    return m_height;
+}
+
+
+/**
+    Test if the chunks of the grid are allocated when they are first needed.
+    @return true if the grid is sparse, false if all the chunks are allocated
+    */
+bool StitchGrid::isSparse() const
+{
+    return m_sparse;
+}
+
+
+/**
+    Change the size of the grid, leaving all the cells empty and the rows and
+    columns mapped in order. Any StitchQueues still in the grid are not deleted,
+    they should have been taken beforehand.
+    The grid is sparse if it has more than denseCells cells.
+    @param width the new width in cells
+    @param height the new height in cells
+    */
+void StitchGrid::reset(int width, int height)
+{
+    foreach (const QVector<StitchChunk *> &chunks, m_chunks) {
+        qDeleteAll(chunks);
+    }
+
+    m_width = width;
+    m_height = height;
+    m_sparse = (qint64(width) * height > denseCells);
+
+    m_columns.resize(width);
+    m_columnIndex.resize(width);
+
+    for (int column = 0 ; column < width ; ++column) {
+        m_columns[column] = column;
+        m_columnIndex[column] = column;
+    }
+
+    m_rows.resize(height);
+    m_rowIndex.resize(height);
+
+    for (int row = 0 ; row < height ; ++row) {
+        m_rows[row] = row;
+        m_rowIndex[row] = row;
+    }
+
+    m_rowCounts.fill(0, height);
+    m_freeColumns.clear();
+    m_freeRows.clear();
+
+    m_chunkColumns = (width + chunkMask) >> chunkShift;
+    m_chunks.fill(QVector<StitchChunk *>(m_chunkColumns, nullptr), (height + chunkMask) >> chunkShift);
+
+    if (!m_sparse) {
+        for (int chunkRow = 0 ; chunkRow < m_chunks.count() ; ++chunkRow) {
+            for (int chunkColumn = 0 ; chunkColumn < m_chunkColumns ; ++chunkColumn) {
+                m_chunks[chunkRow][chunkColumn] = new StitchChunk;
+            }
+        }
+    }
+}
+
+
+/**
+    Change the size of the grid keeping the stitches. Growing the grid adds
+    rows and columns to the right and bottom. Shrinking it deletes the stitches
+    outside of the new size and rebuilds the grid, so that the memory used by
+    a grid that has been made much smaller is released.
+    @param width the new width in cells
+    @param height the new height in cells
+    */
+void StitchGrid::resize(int width, int height)
+{
+    if ((width < m_width) || (height < m_height)) {
+        StitchGrid stitches;
+        stitches.reset(width, height);
+
+        forEach([&stitches](int x, int y, StitchQueue *stitchQueue) {
+            if ((x < stitches.width()) && (y < stitches.height())) {
+                stitches.set(x, y, stitchQueue);
+            } else {
+                delete stitchQueue;
+            }
+        });
+
+        swap(stitches);
+    } else {
+        insertColumns(m_width, width - m_width);
+        insertRows(m_height, height - m_height);
+    }
+}
+
+
+/**
+    Delete all the StitchQueues in the grid, leaving the size unchanged.
+    The chunks of a sparse grid are freed.
+    */
+void StitchGrid::deleteAll()
+{
+    for (int chunkRow = 0 ; chunkRow < m_chunks.count() ; ++chunkRow) {
+        for (int chunkColumn = 0 ; chunkColumn < m_chunkColumns ; ++chunkColumn) {
+            StitchChunk *&chunk = m_chunks[chunkRow][chunkColumn];
+
+            if (chunk && chunk->count) {
+                qDeleteAll(chunk->cells, chunk->cells + chunkSize * chunkSize);
+                std::fill(chunk->cells, chunk->cells + chunkSize * chunkSize, nullptr);
+                chunk->count = 0;
+            }
+
+            if (chunk && m_sparse) {
+                delete chunk;
+                chunk = nullptr;
+            }
+        }
+    }
+
+    m_rowCounts.fill(0);
+}
+
+
+/**
+    Exchange the contents of two grids.
+    @param other a reference to the StitchGrid to exchange with
+    */
+void StitchGrid::swap(StitchGrid &other)
+{
+    std::swap(m_width, other.m_width);
+    std::swap(m_height, other.m_height);
+    std::swap(m_sparse, other.m_sparse);
+    m_columns.swap(other.m_columns);
+    m_rows.swap(other.m_rows);
+    m_columnIndex.swap(other.m_columnIndex);
+    m_rowIndex.swap(other.m_rowIndex);
+    m_rowCounts.swap(other.m_rowCounts);
+    m_freeColumns.swap(other.m_freeColumns);
+    m_freeRows.swap(other.m_freeRows);
+    std::swap(m_chunkColumns, other.m_chunkColumns);
+    m_chunks.swap(other.m_chunks);
+}
+
+
+/**
+    Insert empty columns.
+    @param startColumn the column to insert before, this may be the width of
+    the grid to add columns to the right
+    @param columns the number of columns to insert
+    */
+void StitchGrid::insertColumns(int startColumn, int columns)
+{
+    if (columns <= 0) {
+        return;
+    }
+
+    m_width += columns;
+    updateSparse();
+
+    m_columns.insert(startColumn, columns, -1);
+
+    for (int column = startColumn ; column < startColumn + columns ; ++column) {
+        m_columns[column] = allocateColumn();
+    }
+
+    for (int column = startColumn ; column < m_width ; ++column) {
+        m_columnIndex[m_columns.at(column)] = column;
+    }
+}
+
+
+/**
+    Insert empty rows.
+    @param startRow the row to insert before, this may be the height of the
+    grid to add rows to the bottom
+    @param rows the number of rows to insert
+    */
+void StitchGrid::insertRows(int startRow, int rows)
+{
+    if (rows <= 0) {
+        return;
+    }
+
+    m_height += rows;
+    updateSparse();
+
+    m_rows.insert(startRow, rows, -1);
+
+    for (int row = startRow ; row < startRow + rows ; ++row) {
+        m_rows[row] = allocateRow();
+    }
+
+    for (int row = startRow ; row < m_height ; ++row) {
+        m_rowIndex[m_rows.at(row)] = row;
+    }
+}
+
+
+/**
+    Remove columns, any stitches in them are deleted.
+    @param startColumn the first column to remove
+    @param columns the number of columns to remove
+    */
+void StitchGrid::removeColumns(int startColumn, int columns)
+{
+    if (columns <= 0) {
+        return;
+    }
+
+    for (int column = startColumn ; column < startColumn + columns ; ++column) {
+        int physicalColumn = m_columns.at(column);
+        clearColumn(physicalColumn);
+        m_columnIndex[physicalColumn] = -1;
+        m_freeColumns.append(physicalColumn);
+    }
+
+    m_columns.remove(startColumn, columns);
+    m_width -= columns;
+
+    for (int column = startColumn ; column < m_width ; ++column) {
+        m_columnIndex[m_columns.at(column)] = column;
+    }
+}
+
+
+/**
+    Remove rows, any stitches in them are deleted.
+    @param startRow the first row to remove
+    @param rows the number of rows to remove
+    */
+void StitchGrid::removeRows(int startRow, int rows)
+{
+    if (rows <= 0) {
+        return;
+    }
+
+    for (int row = startRow ; row < startRow + rows ; ++row) {
+        int physicalRow = m_rows.at(row);
+        clearRow(physicalRow);
+        m_rowIndex[physicalRow] = -1;
+        m_freeRows.append(physicalRow);
+    }
+
+    m_rows.remove(startRow, rows);
+    m_height -= rows;
+
+    for (int row = startRow ; row < m_height ; ++row) {
+        m_rowIndex[m_rows.at(row)] = row;
+    }
+}
+
+
+/**
+    Set the stitches in a cell, the chunk containing the cell is allocated if
+    required. Any StitchQueue already in the cell is not deleted.
+    @param x the column of the cell, this must be within the grid
+    @param y the row of the cell, this must be within the grid
+    @param stitchQueue a pointer to the StitchQueue, this may be null to clear the cell
+    */
+void StitchGrid::set(int x, int y, StitchQueue *stitchQueue)
+{
+    int column = m_columns.at(x);
+    int row = m_rows.at(y);
+    StitchChunk *&chunk = m_chunks[row >> chunkShift][column >> chunkShift];
+
+    if (chunk == nullptr) {
+        if (stitchQueue == nullptr) {
+            return;
+        }
+
+        chunk = new StitchChunk;
+    }
+
+    StitchQueue *&cell = chunk->cells[((row & chunkMask) << chunkShift) + (column & chunkMask)];
+    int change = int(stitchQueue != nullptr) - int(cell != nullptr);
+    chunk->count += change;
+    m_rowCounts[row] += change;
+    cell = stitchQueue;
+
+    if (m_sparse && (chunk->count == 0)) {
+        delete chunk;
+        chunk = nullptr;
+    }
+}
+
+
+/**
+    Take the stitches from a cell, leaving it empty.
+    @param x the column of the cell, this must be within the grid
+    @param y the row of the cell, this must be within the grid
+    @return a pointer to the StitchQueue, this will be null if the cell was empty
+    */
+StitchQueue *StitchGrid::take(int x, int y)
+{
+    StitchQueue *stitchQueue = at(x, y);
+
+    if (stitchQueue) {
+        set(x, y, nullptr);
+    }
+
+    return stitchQueue;
+}
+
+
+/**
+    Get the number of cells that have stitches.
+    @return the number of cells
+    */
+int StitchGrid::count() const
+{
+    int cells = 0;
+
+    foreach (int rowCount, m_rowCounts) {
+        cells += rowCount;
+    }
+
+    return cells;
+}
+
+
+/**
+    Test if an area of the grid has no stitches, rows without stitches are
+    skipped without looking at their cells.
+    @param cells a QRect in cells, this is clipped to the grid
+    @return true if none of the cells have stitches, false otherwise
+    */
+bool StitchGrid::isEmpty(const QRect &cells) const
+{
+    QRect area = cells & QRect(0, 0, m_width, m_height);
+
+    for (int y = area.top() ; y <= area.bottom() ; ++y) {
+        if (m_rowCounts.at(m_rows.at(y)) == 0) {
+            continue;
+        }
+
+        for (int x = area.left() ; x <= area.right() ; ++x) {
+            if (at(x, y)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+/**
+    Estimate the memory used by the grid and the StitchQueues in it.
+    @return the number of bytes used
+    */
+qint64 StitchGrid::memoryUsage() const
+{
+    qint64 usage = 0;
+
+    for (const QVector<int> *vector : {&m_columns, &m_rows, &m_columnIndex, &m_rowIndex, &m_rowCounts, &m_freeColumns, &m_freeRows}) {
+        usage += MemoryAccounting::heapBlock(sizeof(QArrayData) + vector->capacity() * sizeof(int));
+    }
+
+    usage += MemoryAccounting::heapBlock(sizeof(QArrayData) + m_chunks.capacity() * sizeof(QVector<StitchChunk *>));
+
+    foreach (const QVector<StitchChunk *> &chunks, m_chunks) {
+        usage += MemoryAccounting::heapBlock(sizeof(QArrayData) + chunks.capacity() * sizeof(StitchChunk *));
+
+        foreach (const StitchChunk *chunk, chunks) {
+            if (chunk) {
+                usage += MemoryAccounting::heapBlock(sizeof(StitchChunk));
+            }
+        }
+    }
+
+    forEach([&usage](int, int, const StitchQueue *stitchQueue) {
+        usage += stitchQueue->memoryUsage();
+    });
+
+    return usage;
+}
+
+
+/**
+    Get a physical column for an inserted column, a free one is reused if
+    there is one, otherwise one is added to the right of the chunks.
+    @return the index of the physical column
+    */
+int StitchGrid::allocateColumn()
+{
+    if (!m_freeColumns.isEmpty()) {
+        return m_freeColumns.takeLast();
+    }
+
+    int column = m_columnIndex.count();
+    m_columnIndex.append(-1);
+
+    if ((column >> chunkShift) >= m_chunkColumns) {
+        ++m_chunkColumns;
+
+        for (int chunkRow = 0 ; chunkRow < m_chunks.count() ; ++chunkRow) {
+            m_chunks[chunkRow].append((m_sparse) ? nullptr : new StitchChunk);
+        }
+    }
+
+    return column;
+}
+
+
+/**
+    Get a physical row for an inserted row, a free one is reused if there is
+    one, otherwise one is added below the chunks.
+    @return the index of the physical row
+    */
+int StitchGrid::allocateRow()
+{
+    if (!m_freeRows.isEmpty()) {
+        return m_freeRows.takeLast();
+    }
+
+    int row = m_rowIndex.count();
+    m_rowIndex.append(-1);
+    m_rowCounts.append(0);
+
+    if ((row >> chunkShift) >= m_chunks.count()) {
+        QVector<StitchChunk *> chunks(m_chunkColumns, nullptr);
+
+        if (!m_sparse) {
+            for (int chunkColumn = 0 ; chunkColumn < m_chunkColumns ; ++chunkColumn) {
+                chunks[chunkColumn] = new StitchChunk;
+            }
+        }
+
+        m_chunks.append(chunks);
+    }
+
+    return row;
+}
+
+
+/**
+    Delete the stitches in a physical column.
+    @param column the index of the physical column
+    */
+void StitchGrid::clearColumn(int column)
+{
+    int chunkColumn = column >> chunkShift;
+
+    for (int chunkRow = 0 ; chunkRow < m_chunks.count() ; ++chunkRow) {
+        StitchChunk *chunk = m_chunks.at(chunkRow).at(chunkColumn);
+
+        if ((chunk == nullptr) || (chunk->count == 0)) {
+            continue;
+        }
+
+        for (int row = 0 ; row < chunkSize ; ++row) {
+            StitchQueue *&cell = chunk->cells[(row << chunkShift) + (column & chunkMask)];
+
+            if (cell) {
+                delete cell;
+                cell = nullptr;
+                --chunk->count;
+                --m_rowCounts[(chunkRow << chunkShift) + row];
+            }
+        }
+
+        releaseChunk(chunkRow, chunkColumn);
+    }
+}
+
+
+/**
+    Delete the stitches in a physical row.
+    @param row the index of the physical row
+    */
+void StitchGrid::clearRow(int row)
+{
+    if (m_rowCounts.at(row) == 0) {
+        return;
+    }
+
+    int chunkRow = row >> chunkShift;
+
+    for (int chunkColumn = 0 ; chunkColumn < m_chunkColumns ; ++chunkColumn) {
+        StitchChunk *chunk = m_chunks.at(chunkRow).at(chunkColumn);
+
+        if ((chunk == nullptr) || (chunk->count == 0)) {
+            continue;
+        }
+
+        for (int column = 0 ; column < chunkSize ; ++column) {
+            StitchQueue *&cell = chunk->cells[((row & chunkMask) << chunkShift) + column];
+
+            if (cell) {
+                delete cell;
+                cell = nullptr;
+                --chunk->count;
+            }
+        }
+
+        releaseChunk(chunkRow, chunkColumn);
+    }
+
+    m_rowCounts[row] = 0;
+}
+
+
+/**
+    Free a chunk of a sparse grid if it has become empty.
+    @param chunkRow the physical chunk row
+    @param chunkColumn the physical chunk column
+    */
+void StitchGrid::releaseChunk(int chunkRow, int chunkColumn)
+{
+    StitchChunk *&chunk = m_chunks[chunkRow][chunkColumn];
+
+    if (m_sparse && chunk && (chunk->count == 0)) {
+        delete chunk;
+        chunk = nullptr;
+    }
+}
+
+
+/**
+    Make the grid sparse if it has grown to more than denseCells cells. Chunks
+    already allocated are kept until they become empty, a grid does not become
+    dense again until it is reset.
+    */
+void StitchGrid::updateSparse()
+{
+    if (!m_sparse && (qint64(m_width) * m_height > denseCells)) {
+        m_sparse = true;
+    }
+}
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2026 by agent
+ * agent@local
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+#ifndef StitchGrid_H
+#define StitchGrid_H
+
+
+#include <QRect>
+#include <QVector>
+
+
+class StitchChunk;
+class StitchQueue;
+
+
+class StitchGrid
+{
+public:
+    StitchGrid();
+    ~StitchGrid();
+
+    int width() const;
+    int height() const;
+    bool isSparse() const;
+
+    void reset(int, int);
+    void resize(int, int);
+    void deleteAll();
+    void swap(StitchGrid &);
+
+    void insertColumns(int, int);
+    void insertRows(int, int);
+    void removeColumns(int, int);
+    void removeRows(int, int);
+
+    StitchQueue *at(int, int) const;
+    void set(int, int, StitchQueue *);
+    StitchQueue *take(int, int);
+
+    int count() const;
+    bool isEmpty(const QRect &) const;
+
+    template <typename Function> void forEach(Function) const;
+
+    qint64 memoryUsage() const;
+
+    static const int chunkSize = 64;
+    static const int chunkShift = 6;
+    static const int chunkMask = chunkSize - 1;
+    static const int denseCells = 1024 * 1024;
+
+private:
+    Q_DISABLE_COPY(StitchGrid)
+
+    int allocateColumn();
+    int allocateRow();
+    void clearColumn(int);
+    void clearRow(int);
+    void releaseChunk(int, int);
+    void updateSparse();
+
+    int m_width;
+    int m_height;
+    bool m_sparse;
+
+    QVector<int>    m_columns;      // physical column of each column
+    QVector<int>    m_rows;         // physical row of each row
+    QVector<int>    m_columnIndex;  // column of each physical column, -1 if it is free
+    QVector<int>    m_rowIndex;     // row of each physical row, -1 if it is free
+    QVector<int>    m_rowCounts;    // number of cells with stitches in each physical row
+    QVector<int>    m_freeColumns;  // physical columns that are empty and not in use
+    QVector<int>    m_freeRows;     // physical rows that are empty and not in use
+
+    int                                 m_chunkColumns;
+    QVector<QVector<StitchChunk *> >    m_chunks;   // chunks indexed by physical chunk row then physical chunk column
+};
+
+
+class StitchChunk
+{
+public:
+    StitchChunk();
+
+    StitchQueue *cells[StitchGrid::chunkSize * StitchGrid::chunkSize];
+    int         count;
+};
+
+
+/**
+    Get the stitches in a cell.
+    @param x the column of the cell, this must be within the grid
+    @param y the row of the cell, this must be within the grid
+    @return a pointer to the StitchQueue, this will be null if the cell is empty
+    */
+inline StitchQueue *StitchGrid::at(int x, int y) const
+{
+    int column = m_columns.at(x);
+    int row = m_rows.at(y);
+    StitchChunk *chunk = m_chunks.at(row >> chunkShift).at(column >> chunkShift);
+
+    return (chunk) ? chunk->cells[((row & chunkMask) << chunkShift) + (column & chunkMask)] : nullptr;
+}
+
+
+/**
+    Call a function for each cell that has stitches. Chunks that have not been
+    allocated or are empty are skipped, so the cost is proportional to the
+    stitched area rather than the size of the grid. The cells are visited a
+    chunk at a time, not in row order. The function must not change the grid.
+    @param function a function taking the column, row and a pointer to the
+    StitchQueue of each cell
+    */
+template <typename Function>
+void StitchGrid::forEach(Function function) const
+{
+    for (int chunkRow = 0 ; chunkRow < m_chunks.count() ; ++chunkRow) {
+        const QVector<StitchChunk *> &chunks = m_chunks.at(chunkRow);
+
+        for (int chunkColumn = 0 ; chunkColumn < chunks.count() ; ++chunkColumn) {
+            const StitchChunk *chunk = chunks.at(chunkColumn);
+
+            if ((chunk == nullptr) || (chunk->count == 0)) {
+                continue;
+            }
+
+            for (int cell = 0 ; cell < chunkSize * chunkSize ; ++cell) {
+                if (StitchQueue *stitchQueue = chunk->cells[cell]) {
+                    int column = (chunkColumn << chunkShift) + (cell & chunkMask);
+                    int row = (chunkRow << chunkShift) + (cell >> chunkShift);
+                    function(m_columnIndex.at(column), m_rowIndex.at(row), stitchQueue);
+                }
+            }
+        }
+    }
+}
+
+
+#endif // StitchGrid_H
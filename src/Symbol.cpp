@@ -33,6 +33,7 @@
 #include <KLocalizedString>
 
 #include "Exceptions.h"
+#include "MemoryAccounting.h"
 
 
 /**
@@ -238,6 +239,25 @@ void Symbol::setJoinStyle(Qt::PenJoinStyle joinStyle)
 }
 
 
+/**
+ * Estimate the memory used by the paths of the symbol, including the versions
+ * cached for each stitch type.
+ *
+ * @return the number of bytes used
+ */
+qint64 Symbol::memoryUsage() const
+{
+    qint64 usage = 0;
+
+    for (const QPainterPath &path : m_paths) {
+        usage += MemoryAccounting::heapBlock(sizeof(QMapNode<Stitch::Type, QPainterPath>));
+        usage += MemoryAccounting::heapBlock(sizeof(QArrayData) + path.elementCount() * sizeof(QPainterPath::Element));
+    }
+
+    return usage;
+}
+
+
 /**
  * Get a pen based on the parameters of the symbol.
  *
@@ -54,6 +54,8 @@ public:
     QPen pen() const;
     QBrush brush() const;
 
+    qint64 memoryUsage() const;
+
     friend QDataStream &operator<<(QDataStream &stream, const Symbol &symbol);
     friend QDataStream &operator>>(QDataStream &stream, Symbol &symbol);
 
@@ -55,6 +55,7 @@
 #include <KLocalizedString>
 
 #include "Exceptions.h"
+#include "MemoryAccounting.h"
 #include "SymbolListWidget.h"
 
 
@@ -226,6 +227,23 @@ QList<qint16> SymbolLibrary::indexes() const
 }
 
 
+/**
+ * Estimate the memory used by the symbols and the undo stack of the library.
+ *
+ * @return the number of bytes used
+ */
+qint64 SymbolLibrary::memoryUsage() const
+{
+    qint64 usage = MemoryAccounting::undoStackUsage(m_undoStack);
+
+    for (const Symbol &symbol : m_symbols) {
+        usage += MemoryAccounting::heapBlock(sizeof(QMapNode<qint16, Symbol>)) + symbol.memoryUsage();
+    }
+
+    return usage;
+}
+
+
 /**
  * Get a pointer to the symbol library undo stack.
  *
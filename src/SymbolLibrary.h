@@ -64,6 +64,8 @@ public:
 
     QUndoStack *undoStack();
 
+    qint64 memoryUsage() const;
+
     friend QDataStream &operator<<(QDataStream &stream, const SymbolLibrary &library);
     friend QDataStream &operator>>(QDataStream &stream, SymbolLibrary &library);
 
@@ -32,6 +32,7 @@
 #include "SymbolListWidget.h"
 
 #include <QApplication>
+#include <QPaintEvent>
 #include <QPainter>
 #include <QPalette>
 #include <QPen>
@@ -73,7 +74,7 @@ void SymbolListWidget::setIconSize(int size)
 
 /**
  * Populate the QListWidget with the QListWidgetItems for each Symbol in the SymbolLibrary.
- * An icon is created for each Symbol.
+ * An icon is created for each Symbol when it is first shown.
  *
  * @param library a pointer to the SymbolLibrary containing the Symbols
  */
@@ -94,6 +95,8 @@ void SymbolListWidget::loadFromLibrary(SymbolLibrary *library)
 
 /**
  * Add an individual Symbol to the view.
+ * Creating the icons for a large library is slow, so the icon is created when the item
+ * is first painted.
  *
  * @param index the index of the Symbol
  * @param symbol a const reference to the Symbol to add
@@ -102,7 +105,8 @@ void SymbolListWidget::loadFromLibrary(SymbolLibrary *library)
 QListWidgetItem *SymbolListWidget::addSymbol(qint16 index, const Symbol &symbol)
 {
     QListWidgetItem *item = createItem(index);
-    item->setIcon(createIcon(symbol, m_size));
+    m_pendingIcons.insert(index, symbol);
+    viewport()->update();
 
     return item;
 }
@@ -147,6 +151,8 @@ void SymbolListWidget::removeSymbol(qint16 index)
     if (m_items.contains(index)) {
         delete m_items.take(index);
     }
+
+    m_pendingIcons.remove(index);
 }
 
 
@@ -255,8 +261,44 @@ bool SymbolListWidget::event(QEvent *e)
 }
 
 
+/**
+ * Create the icons for any items about to be painted before painting the view.
+ *
+ * @param e a pointer to the QPaintEvent
+ */
+void SymbolListWidget::paintEvent(QPaintEvent *e)
+{
+    createVisibleIcons();
+    QListWidget::paintEvent(e);
+}
+
+
+/**
+ * Create the icons for the items that have not had them created yet and are within the
+ * visible area of the view.
+ */
+void SymbolListWidget::createVisibleIcons()
+{
+    QRect visibleRect = viewport()->rect();
+    QMap<qint16, Symbol>::iterator i = m_pendingIcons.begin();
+
+    while (i != m_pendingIcons.end()) {
+        QListWidgetItem *item = m_items.value(i.key());
+
+        if (item && visualItemRect(item).intersects(visibleRect)) {
+            item->setIcon(createIcon(i.value(), m_size));
+            i = m_pendingIcons.erase(i);
+        } else {
+            ++i;
+        }
+    }
+}
+
+
 /**
  * Generate the icons for all the QListWidgetItems stored in m_items.
+ * Items waiting for their icons to be created are skipped, they will use the new palette
+ * when they are created.
  */
 void SymbolListWidget::updateIcons()
 {
@@ -264,7 +306,10 @@ void SymbolListWidget::updateIcons()
 
     while (i.hasNext()) {
         i.next();
-        i.value()->setIcon(createIcon(m_library->symbol(i.key()), m_size));
+
+        if (!m_pendingIcons.contains(i.key())) {
+            i.value()->setIcon(createIcon(m_library->symbol(i.key()), m_size));
+        }
     }
 }
 
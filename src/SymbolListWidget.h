@@ -20,10 +20,14 @@
 
 
 #include <QListWidget>
+#include <QMap>
 
+#include "Symbol.h"
+
+
+class QPaintEvent;
 
 class SymbolLibrary;
-class Symbol;
 
 
 /**
@@ -56,9 +60,11 @@ public:
 
 protected:
     virtual bool event(QEvent *e) Q_DECL_OVERRIDE;
+    virtual void paintEvent(QPaintEvent *e) Q_DECL_OVERRIDE;
 
 private:
     QListWidgetItem *createItem(qint16 index);
+    void createVisibleIcons();
     void updateIcons();
 
     int             m_size;                     /**< size of icons generated in the view */
@@ -67,6 +73,7 @@ private:
     qint16          m_lastIndex;                /**< the last index in the list */
 
     QMap<qint16, QListWidgetItem*>  m_items;    /**< map of index to QListWidgetItem */
+    QMap<qint16, Symbol>    m_pendingIcons;     /**< map of index to Symbol for items whose icons have not been created yet */
 };
 
 
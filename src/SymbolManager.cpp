@@ -11,8 +11,8 @@
 
 /**
  * @file
- * Implement the SymbolManager class. This loads all symbol libraries from the kxstitch application
- * data folders and allows the selection of a library by name. The manager is implemented as a
+ * Implement the SymbolManager class. This finds all symbol libraries in the kxstitch application
+ * data folders and allows the selection of a library by name, loading it when first selected. The manager is implemented as a
  * singleton class accessible from anywhere in the application. Symbols need to be available to the
  * palette manager and from the renderer.
  */
@@ -28,9 +28,12 @@
 
 #include "SymbolManager.h"
 
+#include <QDataStream>
 #include <QDir>
 #include <QDirIterator>
 #include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
 #include <QStandardPaths>
 #include <QUrl>
 
@@ -38,6 +41,7 @@
 #include <KMessageBox>
 
 #include "Exceptions.h"
+#include "MemoryAccounting.h"
 #include "Symbol.h"
 #include "SymbolLibrary.h"
 
@@ -64,6 +68,17 @@ SymbolManager &SymbolManager::self()
 SymbolManager::SymbolManager()
 {
     refresh();
+
+    MemoryAccounting::add(this, i18n("Libraries"), i18n("Symbol libraries"), [this]() {
+        QMutexLocker locker(&m_mutex);
+        qint64 usage = 0;
+
+        foreach (const SymbolLibrary *symbolLibrary, m_symbolLibraries) {
+            usage += MemoryAccounting::heapBlock(sizeof(SymbolLibrary)) + symbolLibrary->memoryUsage();
+        }
+
+        return usage;
+    });
 }
 
 
@@ -72,6 +87,7 @@ SymbolManager::SymbolManager()
  */
 SymbolManager::~SymbolManager()
 {
+    MemoryAccounting::remove(this);
     qDeleteAll(m_symbolLibraries);
 }
 
@@ -83,20 +99,17 @@ SymbolManager::~SymbolManager()
  */
 QStringList SymbolManager::libraries()
 {
-    QStringList libraryNames;
+    SymbolManager &manager = self();
+    QMutexLocker locker(&manager.m_mutex);
 
-    QListIterator<SymbolLibrary *> i(self().m_symbolLibraries);
-
-    while (i.hasNext()) {
-        libraryNames.append(i.next()->name());
-    }
-
-    return libraryNames;
+    return manager.m_libraryNames;
 }
 
 
 /**
- * Get a pointer to a symbol library by name
+ * Get a pointer to a symbol library by name, the library will be read if it has
+ * not been requested before. This may be called from worker threads, the lookup and
+ * reading are done with the manager locked.
  *
  * @param name of the library required.
  *
@@ -104,21 +117,27 @@ QStringList SymbolManager::libraries()
  */
 SymbolLibrary *SymbolManager::library(const QString &name)
 {
-    for (int i = 0 ; i < self().m_symbolLibraries.count() ; ++i) {
-        SymbolLibrary *symbolLibrary = self().m_symbolLibraries.at(i);
+    SymbolManager &manager = self();
+    QMutexLocker locker(&manager.m_mutex);
+    SymbolLibrary *symbolLibrary = manager.m_symbolLibraries.value(name);
+
+    if (symbolLibrary == nullptr && manager.m_libraryPaths.contains(name)) {
+        symbolLibrary = manager.readLibrary(manager.m_libraryPaths.take(name));
 
-        if (symbolLibrary->name() == name) {
-            return symbolLibrary;
+        if (symbolLibrary) {
+            manager.m_symbolLibraries.insert(name, symbolLibrary);
+        } else {
+            manager.m_libraryNames.removeOne(name);
         }
     }
 
-    return nullptr;
+    return symbolLibrary;
 }
 
 
 /**
- * Get a list of files stored in the symbols path, iterating each one to create a new SymbolLibrary instance
- * and read the library.
+ * Get a list of files stored in the symbols path, checking each one is a symbol file and
+ * recording its name and path. The libraries themselves are read when first requested.
  * Assumes that local resources are given before global ones and should take priority.
  */
 void SymbolManager::refresh()
@@ -129,16 +148,56 @@ void SymbolManager::refresh()
         QDirIterator it(dir, QStringList() << QStringLiteral("*.sym"));
 
         while (it.hasNext()) {
-            SymbolLibrary *symbolLibrary = readLibrary(it.next());
+            QString path = it.next();
+            QString name = QFileInfo(path).baseName();
 
-            if (symbolLibrary) {
-                m_symbolLibraries.append(symbolLibrary);
+            if (!m_libraryPaths.contains(name) && checkLibrary(path)) {
+                m_libraryNames.append(name);
+                m_libraryPaths.insert(name, path);
             }
         }
     }
 }
 
 
+/**
+ * Check that a file is a symbol library of a known version by reading the header.
+ *
+ * @param name path to the symbol file to be checked.
+ *
+ * @return true if the file appears to be a valid symbol library, false otherwise.
+ */
+bool SymbolManager::checkLibrary(const QString &name) const
+{
+    QFile file(name);
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        KMessageBox::sorry(nullptr, i18n("Failed to open the file %1", name));
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_0);
+
+    char magic[15];
+    qint32 version;
+
+    if (stream.readRawData(magic, 15) != 15 || strncmp(magic, "KXStitchSymbols", 15) != 0) {
+        KMessageBox::sorry(nullptr, i18n("This does not appear to be a valid symbol file"));
+        return false;
+    }
+
+    stream >> version;
+
+    if (version != 100 && version != 101) {
+        KMessageBox::sorry(nullptr, i18n("Symbol file version %1", version));
+        return false;
+    }
+
+    return true;
+}
+
+
 /**
  * Read a symbol library.
  *
@@ -19,7 +19,8 @@
 #define SymbolManager_H
 
 
-#include <QList>
+#include <QHash>
+#include <QMutex>
 #include <QStringList>
 
 
@@ -30,7 +31,8 @@ class SymbolLibrary;
  * @brief Manages the collection of symbol libraries.
  *
  * The symbol manager manages the set of symbol libraries. It allows retrieval of the names
- * of the libraries and retrieval of a specific library by name.
+ * of the libraries and retrieval of a specific library by name. Only the names and paths of
+ * the libraries are found at startup, each library is read the first time it is requested.
  *
  * The manager is implemented as a singleton class accessible via static functions from all
  * parts of the application.
@@ -48,10 +50,14 @@ private:
     SymbolManager();
 
     void refresh();
+    bool checkLibrary(const QString &name) const;
     SymbolLibrary *readLibrary(const QString &name);
 
-    static SymbolManager    *symbolManager;         /**< pointer to the static symbol manager */
-    QList<SymbolLibrary *>  m_symbolLibraries;      /**< list of the symbol libraries loaded */
+    static SymbolManager            *symbolManager;     /**< pointer to the static symbol manager */
+    QStringList                     m_libraryNames;     /**< names of the symbol libraries available in the order found */
+    QHash<QString, QString>         m_libraryPaths;     /**< map of library names to the paths of the files */
+    QHash<QString, SymbolLibrary *> m_symbolLibraries;  /**< map of library names to the symbol libraries loaded */
+    mutable QMutex                  m_mutex;            /**< guards the maps, libraries are requested by the render threads */
 };
 
 
@@ -0,0 +1,306 @@
+/*
+ * Copyright (C) 2026 by agent
+ * agent@local
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+/**
+    @file
+    Implement the Trace and TraceScope classes used to record where the time
+    is spent in the application.
+    When tracing is started, with the --trace command line option or the
+    KXSTITCH_TRACE environment variable, each TraceScope records the time
+    between its construction and destruction as a complete event in the
+    trace event JSON format, which can be loaded into chrome://tracing or
+    the Perfetto UI. When tracing is not enabled a TraceScope only tests a
+    flag, so trace points can be left in frequently called functions.
+    */
+
+
+#include "Trace.h"
+
+#include <QAtomicInt>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+
+
+class TraceData
+{
+public:
+    TraceData();
+
+    void writeEvent(const QByteArray &);
+    int threadId();
+
+    QAtomicInt      enabled;
+    QElapsedTimer   timer;
+    QMutex          mutex;
+    QFile           file;
+    bool            firstEvent;
+    qint64          processId;
+
+    QHash<Qt::HANDLE, int>  threadIds;
+};
+
+
+Q_GLOBAL_STATIC(TraceData, traceData)
+
+
+/**
+    Escape a string for use as a JSON string value.
+    @param value the string to escape
+    @return a QByteArray of the escaped UTF-8 string without the enclosing quotes
+    */
+static QByteArray jsonEscape(const QString &value)
+{
+    QByteArray utf8 = value.toUtf8();
+    QByteArray escaped;
+    escaped.reserve(utf8.size());
+
+    foreach (char c, utf8) {
+        if ((c == '"') || (c == '\\')) {
+            escaped.append('\\').append(c);
+        } else if ((c >= 0) && (c < 0x20)) {
+            escaped.append("\\u00").append(QByteArray::number(c, 16).rightJustified(2, '0'));
+        } else {
+            escaped.append(c);
+        }
+    }
+
+    return escaped;
+}
+
+
+/**
+    Constructor.
+    */
+TraceData::TraceData()
+    :   enabled(0),
+        firstEvent(true),
+        processId(QCoreApplication::applicationPid())
+{
+}
+
+
+/**
+    Write an event to the trace file separating it from the previous one.
+    The mutex must be locked by the caller.
+    @param event the JSON object for the event
+    */
+void TraceData::writeEvent(const QByteArray &event)
+{
+    if (!firstEvent) {
+        file.write(",\n");
+    }
+
+    file.write(event);
+    firstEvent = false;
+}
+
+
+/**
+    Get a small id for the current thread, the first time a thread is seen
+    a metadata event is written to name it in the trace.
+    The mutex must be locked by the caller.
+    @return the id of the thread
+    */
+int TraceData::threadId()
+{
+    Qt::HANDLE handle = QThread::currentThreadId();
+    QHash<Qt::HANDLE, int>::const_iterator i = threadIds.constFind(handle);
+
+    if (i != threadIds.constEnd()) {
+        return i.value();
+    }
+
+    int id = threadIds.count() + 1;
+    threadIds.insert(handle, id);
+
+    QString name = QThread::currentThread()->objectName();
+
+    if (name.isEmpty()) {
+        name = (QThread::currentThread() == QCoreApplication::instance()->thread()) ? QStringLiteral("Main") : QStringLiteral("Worker %1").arg(id);
+    }
+
+    writeEvent("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + QByteArray::number(processId) +
+               ",\"tid\":" + QByteArray::number(id) +
+               ",\"args\":{\"name\":\"" + jsonEscape(name) + "\"}}");
+
+    return id;
+}
+
+
+/**
+    Start writing a trace.
+    @param fileName the name of the file to write the trace to, any existing
+    file will be overwritten
+    @return true if the file could be opened, false otherwise
+    */
+bool Trace::start(const QString &fileName)
+{
+    TraceData *data = traceData();
+    QMutexLocker locker(&data->mutex);
+
+    if (data->enabled.load()) {
+        return true;
+    }
+
+    data->file.setFileName(fileName);
+
+    if (!data->file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+
+    data->file.write("[\n");
+    data->firstEvent = true;
+    data->threadIds.clear();
+    data->writeEvent("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" + QByteArray::number(data->processId) +
+                     ",\"args\":{\"name\":\"" + jsonEscape(QCoreApplication::applicationName()) + "\"}}");
+    data->timer.start();
+    data->enabled.store(1);
+
+    return true;
+}
+
+
+/**
+    Stop writing the trace and close the file.
+    Scopes that are still active when the trace is stopped are not recorded.
+    */
+void Trace::stop()
+{
+    TraceData *data = traceData();
+    QMutexLocker locker(&data->mutex);
+
+    if (!data->enabled.load()) {
+        return;
+    }
+
+    data->enabled.store(0);
+    data->file.write("\n]\n");
+    data->file.close();
+}
+
+
+/**
+    Test if a trace is being written.
+    @return true if tracing is enabled, false otherwise
+    */
+bool Trace::isEnabled()
+{
+    return traceData()->enabled.load();
+}
+
+
+/**
+    Get the time since the trace was started.
+    @return the time in nanoseconds
+    */
+qint64 Trace::timestamp()
+{
+    return traceData()->timer.nsecsElapsed();
+}
+
+
+/**
+    Add a complete event to the trace for the current thread.
+    @param category the category of the event, such as render or command
+    @param name the name of the event, typically the function being traced
+    @param start the time the event started in nanoseconds from timestamp
+    @param duration the duration of the event in nanoseconds
+    @param arguments the comma separated JSON members of the events args object
+    */
+void Trace::addEvent(const char *category, const char *name, qint64 start, qint64 duration, const QByteArray &arguments)
+{
+    TraceData *data = traceData();
+    QMutexLocker locker(&data->mutex);
+
+    if (!data->enabled.load()) {
+        return;
+    }
+
+    int tid = data->threadId();
+
+    data->writeEvent(QByteArray("{\"name\":\"") + name +
+                     "\",\"cat\":\"" + category +
+                     "\",\"ph\":\"X\",\"ts\":" + QByteArray::number(start / 1000.0, 'f', 3) +
+                     ",\"dur\":" + QByteArray::number(duration / 1000.0, 'f', 3) +
+                     ",\"pid\":" + QByteArray::number(data->processId) +
+                     ",\"tid\":" + QByteArray::number(tid) +
+                     ",\"args\":{" + arguments + "}}");
+}
+
+
+/**
+    Constructor.
+    Starts timing the scope if tracing is enabled.
+    @param category the category of the event, this must be a string literal
+    @param name the name of the event, this must be a string literal
+    */
+TraceScope::TraceScope(const char *category, const char *name)
+    :   m_enabled(Trace::isEnabled()),
+        m_category(category),
+        m_name(name),
+        m_start(m_enabled ? Trace::timestamp() : 0)
+{
+}
+
+
+/**
+    Destructor.
+    Adds the event for the scope to the trace.
+    */
+TraceScope::~TraceScope()
+{
+    if (m_enabled) {
+        Trace::addEvent(m_category, m_name, m_start, Trace::timestamp() - m_start, m_arguments);
+    }
+}
+
+
+/**
+    Add a numeric argument to the event, such as a count of cells.
+    @param name the name of the argument, this must be a valid JSON string
+    @param value the value of the argument
+    */
+void TraceScope::addArgument(const char *name, qint64 value)
+{
+    if (!m_enabled) {
+        return;
+    }
+
+    if (!m_arguments.isEmpty()) {
+        m_arguments.append(',');
+    }
+
+    m_arguments.append('"').append(name).append("\":").append(QByteArray::number(value));
+}
+
+
+/**
+    Add a string argument to the event, such as a file name.
+    @param name the name of the argument, this must be a valid JSON string
+    @param value the value of the argument
+    */
+void TraceScope::addArgument(const char *name, const QString &value)
+{
+    if (!m_enabled) {
+        return;
+    }
+
+    if (!m_arguments.isEmpty()) {
+        m_arguments.append(',');
+    }
+
+    m_arguments.append('"').append(name).append("\":\"").append(jsonEscape(value)).append('"');
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2026 by agent
+ * agent@local
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+#ifndef Trace_H
+#define Trace_H
+
+
+#include <QByteArray>
+#include <QString>
+
+
+class Trace
+{
+public:
+    static bool start(const QString &);
+    static void stop();
+    static bool isEnabled();
+
+    static qint64 timestamp();
+    static void addEvent(const char *, const char *, qint64, qint64, const QByteArray &);
+};
+
+
+class TraceScope
+{
+public:
+    TraceScope(const char *, const char *);
+    ~TraceScope();
+
+    void addArgument(const char *, qint64);
+    void addArgument(const char *, const QString &);
+
+private:
+    Q_DISABLE_COPY(TraceScope)
+
+    bool        m_enabled;
+    const char  *m_category;
+    const char  *m_name;
+    qint64      m_start;
+    QByteArray  m_arguments;
+};
+
+
+#endif // Trace_H